@@ -19,15 +19,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Atom.h"
 
 Atom::Atom() {
-	double zPos[DIM] = {0.,0.,0.};
-	init(zPos, NO_ORIENTATION, NO_GRAIN);
+	init(NO_ORIENTATION, NO_GRAIN);
 }
 
-double * Atom::getPos(){
-	return pos;
-}
-
-void Atom::setOrientationId(long inOriID){
+void Atom::setOrientationId(oID inOriID){
 	orientID = inOriID;
 };
 
@@ -35,10 +30,7 @@ oID Atom::getOrientationId() const{
 	return orientID;
 }
 
-void Atom::init(double * inPos, oID inOriID, gID inGrainID){
-	pos[0] = inPos[0];
-	pos[1] = inPos[1];
-	pos[2] = inPos[2];
+void Atom::init(oID inOriID, gID inGrainID){
 	orientID = inOriID;
 	grainID = inGrainID;
 }
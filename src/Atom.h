@@ -21,18 +21,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "GradeA_Defs.h"
 #include "Orientation.h"
 
+//!\brief Orientation and grain of an atom.
+//! The position is not stored here but in the cell list of the container, which holds the atoms in the same order.
 class Atom {
 public:
 	Atom();
-	void init(double * pos, oID oriID, gID inGrainID);
-	double * getPos();
+	void init(oID oriID, gID inGrainID);
 	void setOrientationId(oID oriID);
 	void setGrainId(gID inGrainID);
 	gID getGrainId() const ;
 	oID getOrientationId() const;
-	virtual ~Atom();
+	~Atom();
 private:
-	double pos[DIM];
 	oID orientID = 0;
 	gID grainID = 0;
 };
@@ -17,9 +17,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "AtomBox.h"
+#include "GhostHalo.h"
 AtomBox::AtomBox() {
 	nAtoms = 0;
-	atomArrSize = 0;
 	nNeighbors = 0;
 	atoms = nullptr;
 	neighbors = nullptr;
@@ -28,22 +28,27 @@ AtomBox::AtomBox() {
 }
 
 void AtomBox::init(const double * inOrigin, const double * inSize, const ABoxNeighbor * inNeighbors, long inNumNeighbors, bool inSizeLinked){
-	sizeLinked = inSizeLinked;
-	if (sizeLinked){
+	//a box may be initialized again (e.g. for the next frame), the memory of the previous initialization is reused
+	if (inSizeLinked){
+		if (!sizeLinked) delete [] size;
 		size = (double*) inSize;
 	} else {
-		size = new double [DIM];
+		if (sizeLinked || size == nullptr) size = new double [DIM];
 		for (long i = 0; i < DIM; i++){
 		size[i] = inSize[i];
 		}
 	}
+	sizeLinked = inSizeLinked;
 
 	for (long i = 0; i < DIM; i++){
 		origin[i] = inOrigin[i];
 	}
 
+	if (neighbors == nullptr || nNeighbors != inNumNeighbors) {
+		delete [] neighbors;
+		neighbors = new ABoxNeighbor[inNumNeighbors];
+	}
 	nNeighbors = inNumNeighbors;
-	neighbors = new ABoxNeighbor[nNeighbors];
 	for(long iNbor = 0; iNbor < nNeighbors; iNbor ++){
 		neighbors[iNbor] = inNeighbors[iNbor];
 	}
@@ -52,61 +57,28 @@ void AtomBox::init(const double * inOrigin, const double * inSize, const ABoxNei
 AtomBox::~AtomBox() {
 	if (!sizeLinked) delete [] size;
 	delete [] neighbors;
-	delete [] atoms;
 }
 
-void AtomBox::addAtom(double * inPos ){
-	if(0 == nAtoms){
-		atomArrSize = ATOMALLOC;
-		atoms = new Atom[atomArrSize];
-	} else  if ( nAtoms == atomArrSize){
-		long i;
-		Atom * oldAtoms = new Atom[nAtoms];
-
-		for (i = 0; i < nAtoms; i ++){
-			oldAtoms[i] = atoms[i];
-		}
-
-		delete [] atoms;
-		atomArrSize += ATOMALLOC;
-		atoms = new Atom[atomArrSize];
-
-		for (i = 0; i < nAtoms; i ++){
-			atoms[i] = oldAtoms[i];
-		}
-
-		delete [] oldAtoms;
-	}
-	atoms[nAtoms].init(inPos, NO_ORIENTATION, NO_GRAIN);
-	nAtoms ++;
+void AtomBox::setAtoms(Atom * inAtoms, const posType * inPosX, const posType * inPosY, const posType * inPosZ, long inNumAtoms){
+	atoms = inAtoms;
+	posX = inPosX;
+	posY = inPosY;
+	posZ = inPosZ;
+	nAtoms = inNumAtoms;
+	halo = nullptr;
 }
 
 void AtomBox::obtainGlobalAtomPos(long atomId, double * outPos) const{
-	double * relPos = atoms[atomId].getPos();
-	outPos[0] = origin[0] + relPos[0];
-	outPos[1] = origin[1] + relPos[1];
-	outPos[2] = origin[2] + relPos[2];
-}
-
-void AtomBox::calculateAtomOrientationsFCC(double angleThreshold, Orientator * orient, const double rSqrMin, const double rSqrMax){
-	unsigned char nAtomNeighbors;
-	double atomNborPositions[12*DIM];
-	Atom * atom;
-	for (long iA = 0; iA < nAtoms; iA++){
-		atom = atoms + iA;
-#ifndef NEAREST_ATOMNEIGHBORHOOD
-		nAtomNeighbors = atomNeighbors(iA, rSqrMin , rSqrMax , 12, atomNborPositions);
-#else
-		nAtomNeighbors = nearestAtomNeighbors(iA, 12, atomNborPositions);
-#endif
-		long n = orient->orientateFCC(atomNborPositions, nAtomNeighbors);
-		atom->setOrientationId(n);
-	}
+	outPos[0] = origin[0] + posX[atomId];
+	outPos[1] = origin[1] + posY[atomId];
+	outPos[2] = origin[2] + posZ[atomId];
 }
 
 unsigned char AtomBox::atomNeighbors(const long atomId, const double rSqrMin, const double rSqrMax, const unsigned char nMaxAtomNeighbors, double * outNborPositions){
-	double * atomPos = atoms[atomId].getPos();
-	double * nborAtomPos = nullptr;
+	if (halo != nullptr) return haloAtomNeighbors(atomId, rSqrMin, rSqrMax, nMaxAtomNeighbors, outNborPositions);
+	double atomPos[DIM];
+	getAtomPos(atomId, atomPos);
+	double nborAtomPos[DIM];
 	unsigned char nFoundNeighbors = 0;
 	double sqrDistance; //distance atom-atom squared
 	int pos;
@@ -114,7 +86,7 @@ unsigned char AtomBox::atomNeighbors(const long atomId, const double rSqrMin, co
 	long iA;
 	for ( iA = 0; iA < nAtoms; iA++){
 		if( iA != atomId){
-			nborAtomPos = atoms[iA].getPos();
+			getAtomPos(iA, nborAtomPos);
 			sqrDistance = sqrDist(atomPos, nborAtomPos);
 			if( sqrDistance < rSqrMax && sqrDistance > rSqrMin){
 				if(nFoundNeighbors == nMaxAtomNeighbors) return 0;
@@ -129,7 +101,6 @@ unsigned char AtomBox::atomNeighbors(const long atomId, const double rSqrMin, co
 	//check neighboring AtomBoxes next
 	if(nFoundNeighbors < nMaxAtomNeighbors){
 	AtomBoxP nborBox = nullptr;
-	Atom * nborAtom;
 	double relAtomPos [DIM];//relative Position of the atom in neighbor's box perspective
 	for (long iBoxes = 0; iBoxes < nNeighbors; iBoxes ++ ){
 		nborBox = neighbors[iBoxes].box;
@@ -137,8 +108,7 @@ unsigned char AtomBox::atomNeighbors(const long atomId, const double rSqrMin, co
 		relAtomPos[1] = atomPos[1] - neighbors[iBoxes].coord[1] * size[1];
 		relAtomPos[2] = atomPos[2] - neighbors[iBoxes].coord[2] * size[2];
 		for(iA = 0; iA < nborBox->getNumAtoms(); iA++){
-			nborAtom = nborBox->getAtom(iA);
-			nborAtomPos = nborAtom->getPos();
+			nborBox->getAtomPos(iA, nborAtomPos);
 			sqrDistance = sqrDist(relAtomPos, nborAtomPos);
 			if(sqrDistance < rSqrMax && sqrDistance > rSqrMin){
 				if(nFoundNeighbors == nMaxAtomNeighbors) return 0;
@@ -156,8 +126,9 @@ unsigned char AtomBox::atomNeighbors(const long atomId, const double rSqrMin, co
 
 unsigned char AtomBox::atomNeighbors(const long  atomId, const double rSqrMin, const double rSqrMax, const unsigned char nMaxAtomNeighbors, AtomBoxP *outNborBoxesList, long * outNborAtomIdList, double * outNborPosList)
 {
-	double * atomPos = atoms[atomId].getPos();//relative position of the atom in the box
-	double * nborAtomPos = nullptr;
+	double atomPos[DIM];//relative position of the atom in the box
+	getAtomPos(atomId, atomPos);
+	double nborAtomPos[DIM];
 	unsigned char nFoundNeighbors = 0;
 	double sqrDistance; //distance atom-atom squared
 	int pos;
@@ -165,7 +136,7 @@ unsigned char AtomBox::atomNeighbors(const long  atomId, const double rSqrMin, c
 		long iA;
 		for ( iA = 0; iA < nAtoms; iA++){
 			if( iA != atomId){
-				nborAtomPos = atoms[iA].getPos();//relative position of the neighbor atom in the box
+				getAtomPos(iA, nborAtomPos);//relative position of the neighbor atom in the box
 				sqrDistance = sqrDist(atomPos, nborAtomPos);
 				if( sqrDistance < rSqrMax && sqrDistance > rSqrMin){
 					if(nFoundNeighbors == nMaxAtomNeighbors) return 0;
@@ -183,7 +154,6 @@ unsigned char AtomBox::atomNeighbors(const long  atomId, const double rSqrMin, c
 		//check neighboring AtomBoxes next
 		if(nFoundNeighbors < nMaxAtomNeighbors){
 		AtomBoxP nborBox = nullptr;
-		Atom * nborAtom;
 		double relAtomPos [DIM];//relative Position of the atom in neighbor's box perspective
 		for (long iBoxes = 0; iBoxes < nNeighbors; iBoxes ++ ){
 			nborBox = neighbors[iBoxes].box;
@@ -191,8 +161,7 @@ unsigned char AtomBox::atomNeighbors(const long  atomId, const double rSqrMin, c
 			relAtomPos[1] = atomPos[1] - neighbors[iBoxes].coord[1] * size[1];
 			relAtomPos[2] = atomPos[2] - neighbors[iBoxes].coord[2] * size[2];
 			for(iA = 0; iA < nborBox->getNumAtoms(); iA++){
-				nborAtom = nborBox->getAtom(iA);
-				nborAtomPos = nborAtom->getPos();
+				nborBox->getAtomPos(iA, nborAtomPos);
 				sqrDistance = sqrDist(relAtomPos, nborAtomPos);
 				if(sqrDistance < rSqrMax && sqrDistance > rSqrMin){
 					if(nFoundNeighbors == nMaxAtomNeighbors) return 0;
@@ -211,25 +180,73 @@ unsigned char AtomBox::atomNeighbors(const long  atomId, const double rSqrMin, c
 	return nFoundNeighbors;
 }
 
-bool sortLengthAscending(double * vA, double * vB) { return SQR(vA[0])+SQR(vA[1])+SQR(vA[2]) < SQR(vB[0])+SQR(vB[1])+SQR(vB[2]); }
+unsigned char AtomBox::haloAtomNeighbors(const long atomId, const double rSqrMin, const double rSqrMax, const unsigned char nMaxAtomNeighbors, double * outNborPositions){
+	const double * haloX = halo->getPosX();
+	const double * haloY = halo->getPosY();
+	const double * haloZ = halo->getPosZ();
+	long self = halo->getCellBegin(haloCell) + atomId;
+	double atomPos[DIM] = {haloX[self], haloY[self], haloZ[self]};
+	double vect[DIM];
+	double sqrDistance;
+	unsigned char nFoundNeighbors = 0;
+	//own box first, then the cells at the places of the neighbor boxes, all in the frame of the container
+	for (long iBoxes = -1; iBoxes < nNeighbors; iBoxes ++){
+		//the neighbor boxes are skipped if the own box already holds enough neighbors (like the box-wise search)
+		if (iBoxes == 0 && nFoundNeighbors == nMaxAtomNeighbors) break;
+		long cell = iBoxes < 0 ? haloCell : halo->getNeighborCell(haloCell, iBoxes);
+		for (long iE = halo->getCellBegin(cell); iE < halo->getCellEnd(cell); iE++){
+			if (iE == self) continue;
+			vect[0] = haloX[iE] - atomPos[0];
+			vect[1] = haloY[iE] - atomPos[1];
+			vect[2] = haloZ[iE] - atomPos[2];
+			sqrDistance = SQR(vect[0]) + SQR(vect[1]) + SQR(vect[2]);
+			if (sqrDistance < rSqrMax && sqrDistance > rSqrMin){
+				if (nFoundNeighbors == nMaxAtomNeighbors) return 0;
+				outNborPositions[nFoundNeighbors * DIM] = vect[0];
+				outNborPositions[nFoundNeighbors * DIM + 1] = vect[1];
+				outNborPositions[nFoundNeighbors * DIM + 2] = vect[2];
+				nFoundNeighbors ++;
+			}
+		}
+	}
+	return nFoundNeighbors;
+}
 
-unsigned char AtomBox::nearestAtomNeighbors(const long atomId, const unsigned char nAtomNeighbors, double * outNborPositions){
-	//finds the nAtomNeighbors next neighbors of a given atom
-	double * atomPos = atoms[atomId].getPos();
-	double * nborAtomPos = nullptr;
-	//list to sort afterwards
-	std::vector<double> nborAtomPosList;
+void AtomBox::selectHaloNeighbors(const long atomId, NearestNeighborSelection<Atom *> & selection){
+	NeighborCandidateChunk<Atom *> candidates;
+	const double * haloX = halo->getPosX();
+	const double * haloY = halo->getPosY();
+	const double * haloZ = halo->getPosZ();
+	long self = halo->getCellBegin(haloCell) + atomId;
+	double atomPos[DIM] = {haloX[self], haloY[self], haloZ[self]};
+	for (long iBoxes = -1; iBoxes < nNeighbors; iBoxes ++){
+		long cell = iBoxes < 0 ? haloCell : halo->getNeighborCell(haloCell, iBoxes);
+		for (long iE = halo->getCellBegin(cell); iE < halo->getCellEnd(cell); iE++){
+			if (iE == self) continue;
+			candidates.add(haloX[iE] - atomPos[0], haloY[iE] - atomPos[1], haloZ[iE] - atomPos[2], halo->getAtom(iE));
+			if (candidates.isFull()) candidates.flush(selection);
+		}
+	}
+	candidates.flush(selection);
+}
 
-	double sqrDistance; //distance atom-atom squared
-	int pos;
+void AtomBox::selectNearestAtomNeighbors(const long atomId, NearestNeighborSelection<Atom *> & selection){
+	if (halo != nullptr) {
+		selectHaloNeighbors(atomId, selection);
+		return;
+	}
+	//the vectors to all atoms in the box neighborhood are buffered and their lengths calculated chunk-wise
+	NeighborCandidateChunk<Atom *> candidates;
+	double atomPos[DIM];
+	getAtomPos(atomId, atomPos);
+	double nborAtomPos[DIM];
 	//check own AtomBox first
 	long iA;
 	for ( iA = 0; iA < nAtoms; iA++){
 		if( iA != atomId){
-			nborAtomPos = atoms[iA].getPos();
-			nborAtomPosList.push_back(nborAtomPos[0] - atomPos[0]);
-			nborAtomPosList.push_back(nborAtomPos[1] - atomPos[1]);
-			nborAtomPosList.push_back(nborAtomPos[2] - atomPos[2]);
+			getAtomPos(iA, nborAtomPos);
+			candidates.add(nborAtomPos[0] - atomPos[0], nborAtomPos[1] - atomPos[1], nborAtomPos[2] - atomPos[2], atoms + iA);
+			if (candidates.isFull()) candidates.flush(selection);
 		}
 	}
 	AtomBoxP nborBox = nullptr;
@@ -242,94 +259,44 @@ unsigned char AtomBox::nearestAtomNeighbors(const long atomId, const unsigned ch
 		relAtomPos[2] = atomPos[2] - neighbors[iBoxes].coord[2] * size[2];
 		for(iA = 0; iA < nborBox->getNumAtoms(); iA++){
 			nborAtom = nborBox->getAtom(iA);
-			nborAtomPos = nborAtom->getPos();
-			nborAtomPosList.push_back( nborAtomPos[0] - relAtomPos[0]);
-			nborAtomPosList.push_back( nborAtomPos[1] - relAtomPos[1]);
-			nborAtomPosList.push_back( nborAtomPos[2] - relAtomPos[2]);
+			nborBox->getAtomPos(iA, nborAtomPos);
+			candidates.add(nborAtomPos[0] - relAtomPos[0], nborAtomPos[1] - relAtomPos[1], nborAtomPos[2] - relAtomPos[2], nborAtom);
+			if (candidates.isFull()) candidates.flush(selection);
 		}
 	}
-	long nFoundNeighbors = nborAtomPosList.size()/DIM;
-	double ** nborAtomList = new double * [nFoundNeighbors];
-	double * listBegin = &nborAtomPosList.front();
-	//save pointer to vectors in list
-	for(long iN = 0; iN < nFoundNeighbors; iN++){
-		nborAtomList[iN] = listBegin + iN * DIM;
-	}
-	//sort neighbor list (neighbors by distance)
-	std::sort(nborAtomList, nborAtomList+nFoundNeighbors, sortLengthAscending);
+	candidates.flush(selection);
+}
 
-	if (nFoundNeighbors > nAtomNeighbors) nFoundNeighbors = nAtomNeighbors;
+unsigned char AtomBox::nearestAtomNeighbors(const long atomId, const unsigned char nAtomNeighbors, double * outNborPositions){
+	//finds the nAtomNeighbors next neighbors of a given atom
+	NearestNeighborSelection<Atom *> selection(nAtomNeighbors);
+	selectNearestAtomNeighbors(atomId, selection);
 	//copy position data in outputarray
-	for(unsigned char iN = 0; iN < nFoundNeighbors; iN++){
-		pos = iN*DIM;
-		outNborPositions[pos++] = nborAtomList[iN][0];
-		outNborPositions[pos++] = nborAtomList[iN][1];
-		outNborPositions[pos] = nborAtomList[iN][2];
+	const double * vect;
+	for(unsigned char iN = 0; iN < selection.size(); iN++){
+		vect = selection.getVect(iN);
+		outNborPositions[iN * DIM] = vect[0];
+		outNborPositions[iN * DIM + 1] = vect[1];
+		outNborPositions[iN * DIM + 2] = vect[2];
 	}
-	delete [] nborAtomList;
-	return nFoundNeighbors;
-}
-
-typedef struct{
-	double position[DIM];
-	Atom * atom;
-} AtomNeighbor;
-bool sortLengthAscending2(AtomNeighbor nA, AtomNeighbor nB) { return SQR(nA.position[0])+SQR(nA.position[1])+SQR(nA.position[2]) <
-		SQR(nB.position[0])+SQR(nB.position[1])+SQR(nB.position[2]);
+	return selection.size();
 }
 
 unsigned char AtomBox::nearestAtomNeighbors(const long atomId, const unsigned char nAtomNeighbors, Atom ** outAtoms){
 	//finds the nAtomNeighbors next neighbors of a given atom
-	double * atomPos = atoms[atomId].getPos();
-	double * nborAtomPos = nullptr;
-	//list to sort afterwards
-	std::vector<AtomNeighbor> nborAtomList;
-	//check own AtomBox first
-	long iA;
-	AtomNeighbor curNbor;
-	for ( iA = 0; iA < nAtoms; iA++){
-		if( iA != atomId){
-			nborAtomPos = atoms[iA].getPos();
-			curNbor.atom = atoms +iA;
-			curNbor.position[0] = nborAtomPos[0] - atomPos[0];
-			curNbor.position[1] = nborAtomPos[1] - atomPos[1];
-			curNbor.position[2] = nborAtomPos[2] - atomPos[2];
-			nborAtomList.push_back(curNbor);
-		}
+	NearestNeighborSelection<Atom *> selection(nAtomNeighbors);
+	selectNearestAtomNeighbors(atomId, selection);
+	for(unsigned char iN = 0; iN < selection.size(); iN++){
+		outAtoms[iN] = selection.getPayload(iN);
 	}
-	AtomBoxP nborBox = nullptr;
-	Atom * nborAtom;
-	double relAtomPos [DIM];//relative position of the atom in neighbor's box perspective
-	for (long iBoxes = 0; iBoxes < nNeighbors; iBoxes ++ ){
-		nborBox = neighbors[iBoxes].box;
-		relAtomPos[0] = atomPos[0] - neighbors[iBoxes].coord[0] * size[0];
-		relAtomPos[1] = atomPos[1] - neighbors[iBoxes].coord[1] * size[1];
-		relAtomPos[2] = atomPos[2] - neighbors[iBoxes].coord[2] * size[2];
-		for(iA = 0; iA < nborBox->getNumAtoms(); iA++){
-			nborAtom = nborBox->getAtom(iA);
-			curNbor.atom = nborAtom;
-			nborAtomPos = nborAtom->getPos();
-			curNbor.position[0] = nborAtomPos[0] - relAtomPos[0];
-			curNbor.position[1] = nborAtomPos[1] - relAtomPos[1];
-			curNbor.position[2] = nborAtomPos[2] - relAtomPos[2];
-			nborAtomList.push_back(curNbor);
-		}
-	}
-	long nFoundNeighbors = nborAtomList.size();
-	//sort neighbor list (neighbors by distance)
-	std::sort(nborAtomList.begin(), nborAtomList.end(), sortLengthAscending2);
-	if (nFoundNeighbors > nAtomNeighbors) nFoundNeighbors = nAtomNeighbors;
-	for(unsigned char iN = 0; iN < nFoundNeighbors; iN++){
-		outAtoms[iN] = nborAtomList[iN].atom;
-	}
-	return nFoundNeighbors;
+	return selection.size();
 }
 
 void AtomBox::printAtoms(){
-	double * p;
+	double p[DIM];
 	std::cout << "AtomPrint:: " << std::endl;
 	for ( long i = 0; i < nAtoms ; i ++){
-		p = atoms[i].getPos();
+		getAtomPos(i, p);
 	std::cout <<  " atom " << i << " : Pos(x,y,z) " << p[0]/size[0] << " " << p[1]/size[1] << " " << p[2]/size[2] << std::endl;
 
 	}
@@ -21,7 +21,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Atom.h"
 #include "GradeA_Defs.h"
 #include "Orientator.h"
+#include "NearestNeighborKernel.h"
 struct ABoxNeighbor;
+class GhostHalo;
 //!\brief A class, which allows to store atoms directly.
 //!The box is a cuboid cell described by its origin and size.
 //!For each box a neighborhood is defined, which is used for the underlying nearest-neighbor search functions.
@@ -32,6 +34,7 @@ public:
 	virtual ~AtomBox();
 
 	//!\brief Initializes the AtomBox object utilizing the given parameters.
+	//! May be called again to reinitialize the box, the memory of the neighbor list is reused if possible.
 	//!\param[in] origin Origin of the box. Must contain at least three accessible elements.
 	//!\param[in] size Size of the box. Must contain at least three accessible elements.
 	//!\param[in] neighbors List containing the neighbors of the box. Must contain at least nNeighbors elements.
@@ -44,16 +47,26 @@ public:
  	//!\brief Sorts the neighbors by distance so that the nearest neighbors are listed first.
 	void srtNeighbors();
 
-	//!\brief Adds an atom to the box.
-	//!\param[in] The position of the atom. At least three elements must be accessible.
-	void addAtom(double * pos);
-
-	//!\brief Calculates the orientations of the stored atoms.
-	//!\param[in] angleThreshold
-	//!\param[in,out] orient Orientator-object used to calculate and store the orientations.
-	//!\param[in] rSqrMin Minimum squared radius used for nearest-neighbor search
-	//!\param[in] rSqrMax Maximum squared radius used for nearest-neighbor search.
-	void calculateAtomOrientationsFCC(double angleThreshold, Orientator  * orient, const double rSqrMin, const double rSqrMax);
+	//!\brief Sets the atoms of the box.
+	//! The box does not take ownership, the atoms and the positions of all boxes are stored contiguously by the container.
+	//!\param[in] inAtoms The atoms of the box. At least \c inNumAtoms elements must be accessible during existence.
+	//!\param[in] inPosX,inPosY,inPosZ Positions of the atoms relative to the origin of the box, one column for each coordinate.
+	//!\param[in] inNumAtoms The number of atoms.
+	void setAtoms(Atom * inAtoms, const posType * inPosX, const posType * inPosY, const posType * inPosZ, long inNumAtoms);
+
+	//!\brief Lets the neighbor searches read the positions of the box neighborhood from a ghost halo instead of the neighbor boxes.
+	//! The halo is dropped by the next \c setAtoms().
+	//!\param[in] inHalo Halo built from the current atoms of all boxes. Must stay valid as long as it is used.
+	//!\param[in] inHaloCell Number of the cell of the box in the halo (the number of the box).
+	void setHalo(const GhostHalo * inHalo, long inHaloCell) { halo = inHalo; haloCell = inHaloCell;};
+
+	//!\brief Obtains the position of an atom relative to the origin of the box.
+	//!\param[out] outPos At least three elements must be accessible.
+	void getAtomPos(long atomId, double * outPos) const {
+		outPos[0] = posX[atomId];
+		outPos[1] = posY[atomId];
+		outPos[2] = posZ[atomId];
+	};
 
 	//!\brief Calculates the nearest neighbors to an atom that lay in the sphere-segment defined by an inner and outer radius.
 	unsigned char atomNeighbors(const long atomId, const double rSqrMin, const double rSqrMax, const unsigned char nMaxAtomNeighbors, double * nborPositions);
@@ -62,6 +75,7 @@ public:
 	unsigned char atomNeighbors(const long atomId, const double rSqrMin, const double rSqrMax, const unsigned char nMaxAtomNeighbors, AtomBox ** outNborBoxesList, long * outNborAtomIdList, double * outNborPosList);
 
 	//!\brief Tries to find \c nAtomNeighbors nearest neighbors to an atom that are closest to that atom.
+	//! At most \c NN_MAXSELECTION neighbors are found. Neighbors with equal distance are sorted in the order they are found.
 	unsigned char nearestAtomNeighbors(const long atomId, const unsigned char nAtomNeighbors, double * nborPositions);
 
 	//!\brief Tries to find \c nAtomNeighbors nearest neighbors to an atom that are closest to that atom.
@@ -96,16 +110,26 @@ public:
 	//!\return The neighbors of the box.
 	ABoxNeighbor * getNeighbors();
 private:
+	//!\brief Inserts all atoms of the box neighborhood into \c selection, which keeps the closest ones.
+	void selectNearestAtomNeighbors(const long atomId, NearestNeighborSelection<Atom *> & selection);
+	//!\brief Variant of \c atomNeighbors() reading the ghost halo.
+	unsigned char haloAtomNeighbors(const long atomId, const double rSqrMin, const double rSqrMax, const unsigned char nMaxAtomNeighbors, double * nborPositions);
+	//!\brief Variant of \c selectNearestAtomNeighbors() reading the ghost halo.
+	void selectHaloNeighbors(const long atomId, NearestNeighborSelection<Atom *> & selection);
 	//!\return The distance between two points.
 	inline double sqrDist(const double * p1, const double * p2) const;
 	bool sizeLinked;
 	double origin[DIM];
 	double * size;
 	Atom * atoms = nullptr;
+	const posType * posX = nullptr;
+	const posType * posY = nullptr;
+	const posType * posZ = nullptr;
 	long nAtoms;
-	long atomArrSize;
 	ABoxNeighbor * neighbors = nullptr;
 	long nNeighbors;
+	const GhostHalo * halo = nullptr;
+	long haloCell = 0;
 };
 typedef AtomBox* AtomBoxP;
 
@@ -17,6 +17,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "AtomContainer.h"
+#include "OrientationKernel.h"
+#include "MortonOrder.h"
 #define DEFAULT_ANGULARTHRESHOLD 0.5e-2//1degree
 #define DEFAULT_ORICAPACITY 10000 //320KB reserved as default for orientations to reduce the frequency of reallocations - critical, slow operation
 #define DEFAULT_MEANORILEAFSIZE 10
@@ -52,63 +54,56 @@ void AtomContainer::init(double * inCenter, double * inSize, unsigned long * inF
 	}
 	capacity = initOriCapacity;
 	boxes = new AtomBox[nBoxes];
-	initBoxes();
-	orient = new Orientator(boxes, capacity);
+	boxCapacity = nBoxes;
+	orient = new Orientator(boxes);
 	grains = new GrainIdentificator(orient,boxes,nBoxes,DEFAULT_ANGULARTHRESHOLD,12);
-	atomInputOrder.reserve(capacity, nBoxes);
+	cellList.reserve(capacity);
 }
 
 AtomContainer::~AtomContainer() {
 	delete orient;
 	delete grains;
-	if ( nBoxes > 0) delete [] boxes;
+	delete [] boxes;
+	delete [] atoms;
+	delete [] atomValid;
 }
 
-void AtomContainer::initBoxes(){
-	ABoxNeighbor * neighbors;
-	long ixyz, nxyz;
-	long nid;
-	long nx, ny, nz;
-	boxSize[0] = size[0]/nX;
-	boxSize[1] = size[1]/nY;
-	boxSize[2] = size[2]/nZ;
-	neighbors = new ABoxNeighbor[MOORE];
-	double boxOrigin[DIM];
-	for(long iz = 0; iz < nZ; iz ++){
-		for(long iy = 0; iy < nY; iy ++){
-			for(long ix = 0; ix < nX; ix ++){
-			ixyz = id(ix,iy,iz);
-			nid = 0;
-			//moore-neighborhood
-			for (long nz = iz-1; nz <= iz+1; nz ++){
-			for (long ny = iy-1; ny <= iy+1; ny ++){
-			for (long nx = ix-1; nx <= ix+1; nx ++){
-				//the box itself is not considered in moore-neighborhood
-				if (nx != ix || ny != iy || nz != iz){
-					//proof that neighbor lays inside the container
-					if( valid(nx, ny, nz) ) {
-					nxyz = id(nx, ny, nz);
-					neighbors[nid].box = boxes + nxyz ;
-					neighbors[nid].coord[0] = nx - ix;
-					neighbors[nid].coord[1] = ny - iy;
-					neighbors[nid].coord[2] = nz - iz;
-					nid ++;
-					}
-				}
-			}}}
-
-			//all neighbors defined
-			boxOrigin[0] = origin[0] + boxSize[0] * ix;
-			boxOrigin[1] = origin[1] + boxSize[1] * iy;
-			boxOrigin[2] = origin[2] + boxSize[2] * iz;
-			boxes[ixyz].init(boxOrigin, boxSize, neighbors, nid);
-			boxes[ixyz].srtNeighbors();
+void AtomContainer::reset(){
+	numberAtoms = 0;
+	cellList.reset();
+	neighborList.reset();
+	halo.reset();
+	atomPropertyList.clear();
+	for (long iBox = 0; iBox < nBoxes; iBox ++){
+		boxes[iBox].setAtoms(nullptr, nullptr, nullptr, nullptr, 0);
+	}
+	if (orient != nullptr) orient->reset(boxes);
+	if (grains != nullptr) grains->reset(boxes, nBoxes);
+}
+
+void AtomContainer::rankCells(){
+	if (rankGrid[0] == nX && rankGrid[1] == nY && rankGrid[2] == nZ) return;
+	std::vector<std::pair<uint64_t, long>> codes(nXY * nZ);
+#pragma omp parallel for schedule(static)
+	for (long iz = 0; iz < nZ; iz++){
+		for (long iy = 0; iy < nY; iy++){
+			for (long ix = 0; ix < nX; ix++){
+				long gridKey = iz * nXY + iy * nX + ix;
+				codes[gridKey].first = morton::encode(ix, iy, iz);
+				codes[gridKey].second = gridKey;
 			}
 		}
 	}
-
-	delete [] neighbors;
+	std::sort(codes.begin(), codes.end());
+	cellRanks.resize(codes.size());
+	for (long iC = 0; iC < codes.size(); iC++){
+		cellRanks[codes[iC].second] = iC;
+	}
+	rankGrid[0] = nX;
+	rankGrid[1] = nY;
+	rankGrid[2] = nZ;
 }
+
 void AtomContainer::setSize(const double * inSize){
 	size[0] = inSize[0];
 	size[1] = inSize[1];
@@ -141,18 +136,106 @@ double AtomContainer::reducedCoordinate(double pos, unsigned char dimension) con
 }
 
 void AtomContainer::calculateAtomOrientations(const double rSqrMin, const double rSqrMax){
-	AtomBoxP box;
-	long tenPercentNum = nBoxes/10;
-	for (long iBox = 0; iBox < nBoxes; iBox ++){
-		box = boxes + iBox;
-		box->calculateAtomOrientationsFCC(DEFAULT_ANGULARTHRESHOLD,orient, rSqrMin, rSqrMax);
-		if(iBox % tenPercentNum == 0){
+	//The orientations are calculated in two passes, so that threads never write into shared lists:
+	//1. each chunk of atoms writes their quaternions into its own slice of a per-atom list (parallel)
+	//2. the found orientations are numbered in box order and copied into the orientator (parallel)
+	//The numbering is independent of the number of threads and equal to the serial box-by-box run.
+	sortAtoms();
+	const std::vector<long> & atomOffsets = cellList.getInputOrder().getBoxOffsets();
+	atomQuats.resize(4 * atomOffsets[nBoxes]);
+	std::vector<long> oriOffsets(nBoxes + 1, 0);
+	if (useNeighborList) {
+		neighborList.build(boxes, nBoxes, rSqrMin, rSqrMax, &cellList, halo.isBuilt() ? &halo : nullptr);
+	}
+	//the atoms are passed in chunks across the boxes to the batched kernel (a box holds only a few atoms)
+	long nAtomsTotal = atomOffsets[nBoxes];
+	long nChunks = (nAtomsTotal + ORK_CHUNKSIZE - 1) / ORK_CHUNKSIZE;
+	long tenPercentNum = nChunks/10;
+	if (tenPercentNum == 0) tenPercentNum = 1;
+	long nFinishedChunks = 0;
+	int parentThreadNum = omp_get_thread_num();
+#pragma omp parallel
+{
+	//each thread counts the methods of the quaternion extraction separately
+	QuaternionTierCounter threadTierCounter;
+	std::vector<double> chunkNborVects(ORK_CHUNKSIZE * FCC_NUMNEIGHBORS * DIM);
+	const double * chunkNborPtrs[ORK_CHUNKSIZE];
+	unsigned char chunkNumNbors[ORK_CHUNKSIZE];
+#pragma omp for schedule(dynamic,4)
+	for (long iChunk = 0; iChunk < nChunks; iChunk ++){
+		long firstAtomNum = iChunk * ORK_CHUNKSIZE;
+		long nChunkAtoms = std::min<long>(ORK_CHUNKSIZE, nAtomsTotal - firstAtomNum);
+		if (neighborList.isBuilt()) {
+			for (long i = 0; i < nChunkAtoms; i++) {
+#ifndef NEAREST_ATOMNEIGHBORHOOD
+				long nborNums[12];
+				chunkNumNbors[i] = neighborList.getShellNeighbors(firstAtomNum + i, 12, nborNums, chunkNborVects.data() + i * FCC_NUMNEIGHBORS * DIM);
+				chunkNborPtrs[i] = chunkNborVects.data() + i * FCC_NUMNEIGHBORS * DIM;
+#else
+				chunkNumNbors[i] = neighborList.getNumNeighbors(firstAtomNum + i, 12);
+				chunkNborPtrs[i] = neighborList.getNeighborVectors(firstAtomNum + i);
+#endif
+			}
+		} else {
+			//box of the first atom of the chunk
+			long iBox = std::upper_bound(atomOffsets.begin(), atomOffsets.end(), firstAtomNum) - atomOffsets.begin() - 1;
+			long iA = firstAtomNum - atomOffsets[iBox];
+			for (long i = 0; i < nChunkAtoms; i++, iA++) {
+				while (iA >= boxes[iBox].getNumAtoms()) {
+					iBox++;
+					iA = 0;
+				}
+				double * atomNborPositions = chunkNborVects.data() + i * FCC_NUMNEIGHBORS * DIM;
+#ifndef NEAREST_ATOMNEIGHBORHOOD
+				chunkNumNbors[i] = boxes[iBox].atomNeighbors(iA, rSqrMin, rSqrMax, 12, atomNborPositions);
+#else
+				chunkNumNbors[i] = boxes[iBox].nearestAtomNeighbors(iA, 12, atomNborPositions);
+#endif
+				chunkNborPtrs[i] = atomNborPositions;
+			}
+		}
+		ork::fccQuaternions(*orient, chunkNborPtrs, chunkNumNbors, nChunkAtoms,
+				atomQuats.data() + 4 * firstAtomNum, atomValid + firstAtomNum, &threadTierCounter);
+		long curFinishedChunks;
+#pragma omp atomic capture
+		curFinishedChunks = ++nFinishedChunks;
+		if(curFinishedChunks % tenPercentNum == 0){
 #pragma omp critical
 {
-	std::cout << "Thread " << omp_get_thread_num() << ": Orientation Calculation finished " << iBox/tenPercentNum *10 << " % " << std::endl;
+	std::cout << "Thread " << parentThreadNum << ": Orientation Calculation finished " << curFinishedChunks/tenPercentNum *10 << " % " << std::endl;
 }
 		}
 	}
+#pragma omp critical
+	orient->addTierCounts(threadTierCounter);
+}
+#pragma omp parallel for schedule(static)
+	for (long iBox = 0; iBox < nBoxes; iBox ++){
+		long nValid = 0;
+		for (long atomNum = atomOffsets[iBox]; atomNum < atomOffsets[iBox + 1]; atomNum++) {
+			if (atomValid[atomNum]) nValid++;
+		}
+		oriOffsets[iBox + 1] = nValid;
+	}
+	for (long iBox = 0; iBox < nBoxes; iBox ++){
+		oriOffsets[iBox + 1] += oriOffsets[iBox];
+	}
+	orient->setOrientations(atoms, nAtomsTotal, atomQuats.data(), atomValid);
+	//the orientation ids are only used for the output
+#pragma omp parallel for schedule(dynamic,16)
+	for (long iBox = 0; iBox < nBoxes; iBox ++){
+		AtomBoxP box = boxes + iBox;
+		oID oriId = oriOffsets[iBox];
+		long atomNum = atomOffsets[iBox];
+		for (long iA = 0; iA < box->getNumAtoms(); iA++, atomNum++){
+			if (atomValid[atomNum]) {
+				box->getAtom(iA)->setOrientationId(oriId);
+				oriId++;
+			} else {
+				box->getAtom(iA)->setOrientationId(NO_ORIENTATION);
+			}
+		}
+	}
 }
 
 const AtomBox * AtomContainer::getBoxes() const{
@@ -168,6 +251,47 @@ bool isFloat(const std::string & value){
 	return (value.find_last_of(".eE") != std::string::npos);
 }
 
+void AtomContainer::sortAtoms() {
+	if (!cellList.hasUnsortedAtoms()) {
+		return;
+	}
+	const double * mortonCellSize = mortonOrder ? boxSize : nullptr;
+	if (sparseCells) {
+		cellList.build(nXY * nZ, true, mortonCellSize);
+		initSparseBoxes();
+	} else {
+		cellList.build(nBoxes, false, mortonCellSize);
+	}
+	//the atoms are created in one block in the order of the cell list, each box refers to its part
+	//the block is only allocated again if it is too small (e.g. for a larger frame)
+	if (cellList.getNumAtoms() > atomCapacity || atoms == nullptr) {
+		delete [] atoms;
+		delete [] atomValid;
+		atomCapacity = cellList.getNumAtoms();
+		atoms = new Atom[atomCapacity];
+		atomValid = new bool [atomCapacity + 1];
+	}
+	//the positions stay in the columns of the cell list, the atoms only hold their orientation and grain
+	const posType * posX = cellList.getPosX();
+	const posType * posY = cellList.getPosY();
+	const posType * posZ = cellList.getPosZ();
+#pragma omp parallel for schedule(dynamic,16)
+	for (long iBox = 0; iBox < nBoxes; iBox ++){
+		long offset = cellList.getCellOffset(iBox);
+		for (long atomNum = offset; atomNum < cellList.getCellOffset(iBox + 1); atomNum++){
+			atoms[atomNum].init(NO_ORIENTATION, NO_GRAIN);
+		}
+		boxes[iBox].setAtoms(atoms + offset, posX + offset, posY + offset, posZ + offset, cellList.getNumAtomsInCell(iBox));
+	}
+	if (useGhostHalo) {
+		halo.build(boxes, nBoxes, cellList, atoms, origin, size);
+#pragma omp parallel for schedule(dynamic,64)
+		for (long iBox = 0; iBox < nBoxes; iBox ++){
+			boxes[iBox].setHalo(&halo, iBox);
+		}
+	}
+}
+
 void AtomContainer::addAtomProperty(const std::string& name) {
 	atomPropertyList.addProperty(name, capacity);
 }
@@ -197,6 +321,45 @@ void AtomContainer::addAtom(const double * pos, const std::vector<std::string>&
 	}
 }
 
+void AtomContainer::addAtom(const double * pos, const double * propertyValues, const std::vector<bool> & propertyIsFloat){
+	if(addAtom(pos)) {
+		for (int iProperty = 0; iProperty < propertyIsFloat.size(); iProperty++){
+			if (!atomPropertyList.isPropertyInt(iProperty)) {
+				atomPropertyList.addFloatPropertyValue(iProperty, propertyValues[iProperty]);
+			} else if (propertyIsFloat[iProperty]) {
+				//value of float type -> conversion
+				atomPropertyList.convertPropertyToFloat(iProperty);
+				atomPropertyList.addFloatPropertyValue(iProperty, propertyValues[iProperty]);
+			} else {
+				atomPropertyList.addIntPropertyValue(iProperty, static_cast<int>(propertyValues[iProperty]));
+			}
+		}
+	} else {
+		std::cout << "WARNING: Adding atom " << getNumAtoms() <<" failed (placed outside container)" << std::endl;
+	}
+}
+
+void AtomContainer::addAtoms(const double * atomPos, long nAtoms, const double * propertyValues, const std::vector<bool> & propertyIsFloat){
+	long firstNum = cellList.append(nAtoms);
+	long nOutside = locateAtoms(atomPos, nAtoms, firstNum);
+	if (nOutside > 0) {
+		//rare case: the atoms are added one by one, so that the atoms outside are skipped in input order
+		cellList.truncate(firstNum);
+		std::vector<double> atomProperties(propertyIsFloat.size());
+		for (long i = 0; i < nAtoms; i++){
+			for (int iP = 0; iP < propertyIsFloat.size(); iP++){
+				atomProperties[iP] = propertyValues[iP * nAtoms + i];
+			}
+			addAtom(atomPos + DIM * i, atomProperties.data(), propertyIsFloat);
+		}
+		return;
+	}
+	numberAtoms += nAtoms;
+	for (int iP = 0; iP < propertyIsFloat.size(); iP++){
+		atomPropertyList.addPropertyValues(iP, propertyValues + iP * nAtoms, nAtoms, propertyIsFloat[iP]);
+	}
+}
+
 void AtomContainer::addAtoms(double * inPos, long nAtoms){
 	double * iPos;
 	for (long i  = 0; i < nAtoms; i++){
@@ -212,7 +375,7 @@ long AtomContainer::getBoxId(const AtomBox* box) const {
 }
 
 double AtomContainer::getAtomsProperty(int propertyNum, const AtomID& atomId) {
-	long atomNum = atomInputOrder.getAtomNum(atomId);
+	long atomNum = cellList.getInputOrder().getAtomNum(atomId);
 	if (atomNum >= 0) {
 		if (atomPropertyList.isPropertyInt(propertyNum)) {
 			//is int
@@ -260,35 +423,18 @@ void AtomContainer::calculateGrainProperties() {
 }
 
 bool AtomContainer::addAtom(const double * inPos){
-	long ix, iy, iz;
-	AtomID atomId;
-	if(inPos[0] < origin[0] ) return false;
-	if(inPos[1] < origin[1] ) return false;
-	if(inPos[2] < origin[2] ) return false;
-	ix = (inPos[0]-origin[0])/boxSize[0];
-	iy = (inPos[1]-origin[1])/boxSize[1];
-	iz = (inPos[2]-origin[2])/boxSize[2];
-	if (!valid(ix,iy,iz)) return false;
-	//retrieve and save the box-id
-	atomId.iB = id(ix,iy,iz);
-	//get the pointer to the box
-	AtomBoxP box = boxes + atomId.iB;
-	//obtain read access to the box's origin
-	const double * boxOrigin = box->getOrigin();
-	//calculate the position relative to the box's origin
-	double boxPos[DIM] =	{ inPos[0] - boxOrigin[0], inPos[1] - boxOrigin[1], inPos[2] - boxOrigin[2] };
-	//the corresponding atom-id is equal to the number of atoms
-	//before adding the atom to the box
-	atomId.iA = box->getNumAtoms();
-	box->addAtom(boxPos);
-	//remember the order the atoms were put into the container
-	atomInputOrder.add(atomId);
+	long boxId;
+	double boxPos[DIM];
+	if(!locateAtom(inPos, boxId, boxPos)) return false;
+	//the atom is put into its box by sortAtoms(), the cell list remembers the input order
+	cellList.add(boxId, boxPos);
 	numberAtoms ++;
 	return true;
 }
 
 
 
+
 void AtomContainer::outBox(long id){
 	std::cout << "BOX " << id << " with address = " << &boxes[id] << std::endl;
 	std::cout << " has " << boxes[id].getNumNeighbors() << " Neighbors and " << boxes[id].getNumAtoms() << " Atoms" << std::endl;
@@ -323,35 +469,29 @@ void AtomContainer::getGrainAvgPropertyNames(std::vector<std::string> & outPrope
 }
 
 void AtomContainer::getAtomsPosition(long atomNum, double * outPos) const{
-	const AtomID * id;
-	AtomBox * box;
-	Atom * a;
+	const AtomIdList & inputOrder = cellList.getInputOrder();
+	long sortedNum;
 	const double * boxPos;
-	const double * curPos;
-	if(atomNum >=  0 && atomNum < numberAtoms){
-		id = atomInputOrder.getAtomId(atomNum);
-		box = boxes + id->iB;
-		a =  box->getAtom( id->iA );
-		boxPos = box->getOrigin();
-		curPos = a->getPos();
+	if(atomNum >=  0 && atomNum < inputOrder.size()){
+		sortedNum = inputOrder.getSortedNum(atomNum);
+		boxPos = boxes[inputOrder.getAtomId(atomNum).iB].getOrigin();
 		//calculate global coordinates from local coordinates and origin
-		outPos[0] = boxPos[0] + curPos[0];
-		outPos[1] = boxPos[1] + curPos[1];
-		outPos[2] = boxPos[2] + curPos[2];
+		outPos[0] = boxPos[0] + cellList.getPosX()[sortedNum];
+		outPos[1] = boxPos[1] + cellList.getPosY()[sortedNum];
+		outPos[2] = boxPos[2] + cellList.getPosZ()[sortedNum];
 	}
 }
 
 void AtomContainer::getAtomsProperties(long atomNum, std::vector<std::string>& outProperties, bool withDefaults, bool withGrainAvg) const{
 	outProperties.clear();
-	const AtomID * id = atomInputOrder.getAtomId(atomNum);
-	AtomBox * box = boxes + id->iB;
-	Atom * a =  box->getAtom( id->iA );
-	if(atomNum >=  0 && atomNum < numberAtoms){
+	if(atomNum >=  0 && atomNum < cellList.getInputOrder().size()){
+		AtomID id = cellList.getInputOrder().getAtomId(atomNum);
+		Atom * a = atoms + cellList.getInputOrder().getSortedNum(atomNum);
 		if (withDefaults){
 			//add default properties
 			outProperties = {
-				std::to_string(id->iB),
-				std::to_string(id->iA),
+				std::to_string(id.iB),
+				std::to_string(id.iA),
 				std::to_string(a->getOrientationId()),
 				std::to_string(a->getGrainId())
 			};
@@ -388,9 +528,6 @@ long AtomContainer::getNumOrientations() const{
 	return orient->getNumOrientations();
 }
 
-const Orientation * AtomContainer::getOrientations() const{
-	return orient->getOrientations();
-}
 long AtomContainer::getNumGrains() const{
 	return grains->getNumGrains();
 }
@@ -402,33 +539,91 @@ const Grain * AtomContainer::getGrain(long  grainNum) const{
 void AtomContainer::identifyGrains(double angularThreshold, double rSqrMin, double rSqrMax)
 {
 	grains->setSearchRadiiSquared(rSqrMin,rSqrMax);
+	grains->setEngineType(grainEngineType);
+	grains->setContainerGeometry(size, isPeriodic());
+	grains->setNeighborList(neighborList.isBuilt() ? &neighborList : nullptr);
 	grains->run(angularThreshold);
 	grains->assignOrphanAtoms();
 	grains->sort();
 	calculateGrainProperties();
 }
 
+void AtomContainer::setUseNeighborList(bool inUseNeighborList)
+{
+	useNeighborList = inUseNeighborList;
+	if (!useNeighborList) {
+		neighborList.clear();
+	}
+}
+
+void AtomContainer::setGrainEngineType(GrainEngineType inEngineType)
+{
+	grainEngineType = inEngineType;
+}
+
+void AtomContainer::setSparseCells(bool inSparseCells)
+{
+	sparseCells = inSparseCells;
+}
+
+void AtomContainer::setMortonOrder(bool inMortonOrder)
+{
+	mortonOrder = inMortonOrder;
+}
+
+void AtomContainer::setGhostHalo(bool inGhostHalo)
+{
+	useGhostHalo = inGhostHalo;
+	if (!useGhostHalo) {
+		halo.clear();
+	}
+}
+
 const Orientator * AtomContainer::getOrientator() const {
 	return orient;
 }
 
 void AtomContainer::generate(long nAtoms)
 {
+	//the boxes are at least as large as the search radius, so that all neighbors of an atom lie in the adjacent boxes
 	nX = size[0]/minBoxSize;
 	nY = size[1]/minBoxSize;
 	nZ = size[2]/minBoxSize;
-	if(nX > MAXFRAGMENT) nX = MAXFRAGMENT;
-		else if(nX <= 0) nX = 1;
-	if(nY > MAXFRAGMENT) nY = MAXFRAGMENT;
-		else if(nY <= 0) nY = 1;
-	if(nZ > MAXFRAGMENT) nZ = MAXFRAGMENT;
-		else if(nZ <= 0) nZ = 1;
+	if(nX <= 0) nX = 1;
+	if(nY <= 0) nY = 1;
+	if(nZ <= 0) nZ = 1;
+	//dilute samples get larger boxes, sparse cells do not store the empty boxes anyway
+	double numGridBoxes = double(nX) * nY * nZ;
+	if (!sparseCells && nAtoms > 0 && numGridBoxes * MINATOMSPERBOX > nAtoms) {
+		double scale = cbrt(numGridBoxes * MINATOMSPERBOX / nAtoms);
+		nX = std::max(1L, long(nX / scale));
+		nY = std::max(1L, long(nY / scale));
+		nZ = std::max(1L, long(nZ / scale));
+	}
 	nXY = nX*nY;
-	nBoxes = nXY*nZ;
-	boxes = new AtomBox[nBoxes];
-	initBoxes();
-	orient = new Orientator(boxes, nAtoms);
-	grains = new GrainIdentificator(orient,boxes,nBoxes,DEFAULT_ANGULARTHRESHOLD,12);
+	if (sparseCells) {
+		boxSize[0] = size[0]/nX;
+		boxSize[1] = size[1]/nY;
+		boxSize[2] = size[2]/nZ;
+		nBoxes = 0;
+	} else {
+		nBoxes = nXY*nZ;
+		if (mortonOrder) rankCells();
+		if (nBoxes > boxCapacity) {
+			delete [] boxes;
+			boxes = new AtomBox[nBoxes];
+			boxCapacity = nBoxes;
+		}
+		initBoxes();
+	}
+	cellList.reserve(nAtoms);
+	if (orient == nullptr) {
+		orient = new Orientator(boxes);
+		grains = new GrainIdentificator(orient,boxes,nBoxes,DEFAULT_ANGULARTHRESHOLD,12);
+	} else {
+		orient->reset(boxes);
+		grains->reset(boxes, nBoxes);
+	}
 }
 
 const double * AtomContainer::getSize() const {
@@ -443,12 +638,15 @@ const double * AtomContainer::getOrigin() const{
 	return origin;
 }
 
-long AtomContainer::id(long ix, long iy, long iz) const{
+//the boundary conditions: the grid functions of both containers, which are inlined into the loops below
+template <>
+inline long GridAtomContainer<false>::id(long ix, long iy, long iz) const{
 	return iz * nXY + iy * nX + ix;
 
 }
 
-bool AtomContainer::valid(long ix, long iy, long iz) const{
+template <>
+inline bool GridAtomContainer<false>::valid(long ix, long iy, long iz) const{
 	if (ix < 0) return false;
 	if (iy < 0) return false;
 	if (iz < 0) return false;
@@ -458,64 +656,51 @@ bool AtomContainer::valid(long ix, long iy, long iz) const{
 	return true;
 }
 
-PeriodicAtomContainer::~PeriodicAtomContainer() {
+template <>
+inline bool GridAtomContainer<false>::locate(const double * inPos, long & boxId, double * boxPos) const{
+	long ix, iy, iz;
+	if(inPos[0] < origin[0] ) return false;
+	if(inPos[1] < origin[1] ) return false;
+	if(inPos[2] < origin[2] ) return false;
+	ix = (inPos[0]-origin[0])/boxSize[0];
+	iy = (inPos[1]-origin[1])/boxSize[1];
+	iz = (inPos[2]-origin[2])/boxSize[2];
+	if (!valid(ix,iy,iz)) return false;
+	//retrieve the key of the cell in the grid, the box-id is derived from it (the boxes of sparse cells are numbered by sortAtoms())
+	boxId = id(ix,iy,iz);
+	double boxOrigin[DIM];
+	cellOrigin(boxId, boxOrigin);
+	boxId = boxKey(boxId);
+	//calculate the position relative to the box's origin
+	boxPos[0] = inPos[0] - boxOrigin[0];
+	boxPos[1] = inPos[1] - boxOrigin[1];
+	boxPos[2] = inPos[2] - boxOrigin[2];
+	return true;
 }
 
-void PeriodicAtomContainer::addAtoms(double * inPos, long nAtoms){
-	double * iPos;
-	for (long i  = 0; i < nAtoms; i++){
-		iPos = inPos +i*DIM;
-		addAtom(iPos);
-	}
+template <>
+inline long GridAtomContainer<true>::id(long ix, long iy, long iz) const{
+	if(ix >= nX) ix = ix % nX;
+	else if (ix < 0) ix = nX + ((ix+1) % nX - 1);
+
+	if(iy >= nY) iy = iy % nY;
+	else if (iy < 0) iy = nY + ((iy+1) % nY - 1);
+
+	if(iz >= nZ) iz = iz % nZ;
+	else if (iz < 0) iz = nZ + ((iz+1) % nZ - 1);
+
+	return iz * nXY + iy * nX + ix;
 }
 
-void PeriodicAtomContainer::initBoxes(){
-	long ixyz, nxyz;
-	long nid;
-	long nx, ny, nz;//neighbor ids
-	ABoxNeighbor * neighbors;
-	boxSize[0] = size[0]/nX;
-	boxSize[1] = size[1]/nY;
-	boxSize[2] = size[2]/nZ;
-	neighbors = new ABoxNeighbor[MOORE];
-	double boxOrigin[DIM];
-	//loop over all boxes
-		for(long iz = 0; iz < nZ; iz ++){
-			for(long iy = 0; iy < nY; iy ++){
-				for(long ix = 0; ix < nX; ix ++){
-				ixyz = id(ix,iy,iz);
-				nid = 0;
-				//moore-neighborhood
-				for (long nz = iz-1; nz <= iz+1; nz ++){
-				for (long ny = iy-1; ny <= iy+1; ny ++){
-				for (long nx = ix-1; nx <= ix+1; nx ++){
-					//the box itself is not considered in moore-neighborhood
-					if (nx != ix || ny != iy || nz != iz){
-						//for periodic case all neighbors are forced to be accessible
-						nxyz = id(nx, ny, nz);
-						neighbors[nid].box = &boxes[nxyz];
-						neighbors[nid].coord[0] = nx - ix;
-						neighbors[nid].coord[1] = ny - iy;
-						neighbors[nid].coord[2] = nz - iz;
-						nid ++;
-					}
-				}}}
-				//all neighbors defined
-				boxOrigin[0] = origin[0] + boxSize[0] * ix;
-				boxOrigin[1] = origin[1] + boxSize[1] * iy;
-				boxOrigin[2] = origin[2] + boxSize[2] * iz;
-				boxes[ixyz].init(boxOrigin, boxSize, neighbors, nid);
-				boxes[ixyz].srtNeighbors();
-				}
-			}
-		}
-	delete [] neighbors;
+template <>
+inline bool GridAtomContainer<true>::valid(long ix, long iy, long iz) const{
+	return true;
 }
 
-bool PeriodicAtomContainer::addAtom(const double * inPos){
+template <>
+inline bool GridAtomContainer<true>::locate(const double * inPos, long & boxId, double * boxPos) const{
 	long ix, iy, iz;
 	long iX, iY, iZ;
-	AtomID atomId;
 	//relative Position of the atom to the container origin
 	double relPos[DIM] = {inPos[0]-origin[0], inPos[1]-origin[1], inPos[2]-origin[2]};
 	ix = relPos[0]/boxSize[0];
@@ -528,13 +713,15 @@ bool PeriodicAtomContainer::addAtom(const double * inPos){
 	iX = relPos[0]/size[0];
 	iY = relPos[1]/size[1];
 	iZ = relPos[2]/size[2];
-	//obtain and save the id of the box
-	atomId.iB = id(ix,iy,iz);
-	//get the corresponding pointer to the box
-	AtomBoxP box = boxes + atomId.iB;
-	const double * boxOrigin = box->getOrigin();
+	//obtain the id of the box
+	boxId = id(ix,iy,iz);
+	double boxOrigin[DIM];
+	cellOrigin(boxId, boxOrigin);
+	boxId = boxKey(boxId);
 	//calculate the relative coordinates to the box's origin
-	double boxPos[DIM] = {inPos[0] - boxOrigin[0], inPos[1] - boxOrigin[1], inPos[2] - boxOrigin[2]};
+	boxPos[0] = inPos[0] - boxOrigin[0];
+	boxPos[1] = inPos[1] - boxOrigin[1];
+	boxPos[2] = inPos[2] - boxOrigin[2];
 	//atom position inside the boxes are defined in the box's local coordinate system
 	//hence, we need to translate position by periodic translation vectors in order to obtain
 	//true relative coordinates (smaller as the box size)
@@ -546,26 +733,122 @@ bool PeriodicAtomContainer::addAtom(const double * inPos){
 	//
 	if( iZ > 0 ) boxPos[2] -= iZ * size[2];
 	else if (relPos[2] < 0. ) boxPos[2] -= (iZ - 1) * size[2];
-	//the corresponding atom-id is equal to the number of atoms
-	//before adding the atom to the box
-	atomId.iA = box->getNumAtoms();
-	//add atom to box
-	box->addAtom(boxPos);
-	//remember the order the atoms were put into the container
-	atomInputOrder.add(atomId);
-	numberAtoms++;
 	return true;
 }
 
-long PeriodicAtomContainer::id(long ix, long iy, long iz) const{
-	if(ix >= nX) ix = ix % nX;
-	else if (ix < 0) ix = nX + ((ix+1) % nX - 1);
+template <bool PERIODIC>
+bool GridAtomContainer<PERIODIC>::locateAtom(const double * inPos, long & boxId, double * boxPos) const{
+	return locate(inPos, boxId, boxPos);
+}
 
-	if(iy >= nY) iy = iy % nY;
-	else if (iy < 0) iy = nY + ((iy+1) % nY - 1);
+template <bool PERIODIC>
+long GridAtomContainer<PERIODIC>::locateAtoms(const double * atomPos, long nAtoms, long firstNum){
+	long nOutside = 0;
+#pragma omp parallel for schedule(static) reduction(+:nOutside)
+	for (long i = 0; i < nAtoms; i++){
+		long boxId;
+		double boxPos[DIM];
+		if (locate(atomPos + DIM * i, boxId, boxPos)) {
+			cellList.set(firstNum + i, boxId, boxPos);
+		} else {
+			nOutside++;
+		}
+	}
+	return nOutside;
+}
 
-	if(iz >= nZ) iz = iz % nZ;
-	else if (iz < 0) iz = nZ + ((iz+1) % nZ - 1);
+template <bool PERIODIC>
+void GridAtomContainer<PERIODIC>::initBoxes(){
+	ABoxNeighbor * neighbors;
+	long ixyz, nxyz;
+	long nid;
+	long nx, ny, nz;
+	boxSize[0] = size[0]/nX;
+	boxSize[1] = size[1]/nY;
+	boxSize[2] = size[2]/nZ;
+	neighbors = new ABoxNeighbor[MOORE];
+	double boxOrigin[DIM];
+	for(long iz = 0; iz < nZ; iz ++){
+		for(long iy = 0; iy < nY; iy ++){
+			for(long ix = 0; ix < nX; ix ++){
+			ixyz = boxKey(id(ix,iy,iz));
+			nid = 0;
+			//moore-neighborhood
+			for (long nz = iz-1; nz <= iz+1; nz ++){
+			for (long ny = iy-1; ny <= iy+1; ny ++){
+			for (long nx = ix-1; nx <= ix+1; nx ++){
+				//the box itself is not considered in moore-neighborhood
+				if (nx != ix || ny != iy || nz != iz){
+					//proof that neighbor lays inside the container, for periodic containers all neighbors are accessible
+					if( valid(nx, ny, nz) ) {
+					nxyz = boxKey(id(nx, ny, nz));
+					neighbors[nid].box = boxes + nxyz ;
+					neighbors[nid].coord[0] = nx - ix;
+					neighbors[nid].coord[1] = ny - iy;
+					neighbors[nid].coord[2] = nz - iz;
+					nid ++;
+					}
+				}
+			}}}
 
-	return iz * nXY + iy * nX + ix;
+			//all neighbors defined
+			boxOrigin[0] = origin[0] + boxSize[0] * ix;
+			boxOrigin[1] = origin[1] + boxSize[1] * iy;
+			boxOrigin[2] = origin[2] + boxSize[2] * iz;
+			boxes[ixyz].init(boxOrigin, boxSize, neighbors, nid);
+			boxes[ixyz].srtNeighbors();
+			}
+		}
+	}
+
+	delete [] neighbors;
+}
+
+template <bool PERIODIC>
+void GridAtomContainer<PERIODIC>::initSparseBoxes(){
+	nBoxes = cellList.getNumCells();
+	if (nBoxes > boxCapacity) {
+		delete [] boxes;
+		boxes = new AtomBox[nBoxes];
+		boxCapacity = nBoxes;
+	}
+#pragma omp parallel for schedule(dynamic,64)
+	for (long iBox = 0; iBox < nBoxes; iBox ++){
+		ABoxNeighbor neighbors[MOORE];
+		double boxOrigin[DIM];
+		long key = cellList.getCellKey(iBox);
+		long ix, iy, iz;
+		if (mortonOrder) {
+			morton::decode(key, ix, iy, iz);
+		} else {
+			ix = key % nX;
+			iy = (key / nX) % nY;
+			iz = key / nXY;
+		}
+		long nid = 0;
+		//moore-neighborhood, the empty cells are not stored and thus skipped
+		for (long nz = iz-1; nz <= iz+1; nz ++){
+		for (long ny = iy-1; ny <= iy+1; ny ++){
+		for (long nx = ix-1; nx <= ix+1; nx ++){
+			if (nx == ix && ny == iy && nz == iz) continue;
+			//periodic containers wrap the neighbors around
+			if (!valid(nx, ny, nz)) continue;
+			long nborBox = cellList.findCell(boxKey(id(nx, ny, nz)));
+			if (nborBox < 0) continue;
+			neighbors[nid].box = boxes + nborBox;
+			neighbors[nid].coord[0] = nx - ix;
+			neighbors[nid].coord[1] = ny - iy;
+			neighbors[nid].coord[2] = nz - iz;
+			nid ++;
+		}}}
+		cellOrigin(id(ix, iy, iz), boxOrigin);
+		boxes[iBox].init(boxOrigin, boxSize, neighbors, nid);
+		boxes[iBox].srtNeighbors();
+	}
+	//the boxes may have been allocated again
+	orient->reset(boxes);
+	grains->reset(boxes, nBoxes);
 }
+
+template class GridAtomContainer<true>;
+template class GridAtomContainer<false>;
@@ -22,9 +22,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Orientator.h"
 #include "Grain.h"
 #include "GrainIdentificator.h"
+#include "NeighborList.h"
 #include "AtomPropertyList.h"
-#include "AtomIdList.h"
-#define MAXFRAGMENT 80
+#include "CellList.h"
+#include "GhostHalo.h"
+//the grid is coarsened, if it would have fewer atoms per box on average (boxes need more memory than atoms)
+#define MINATOMSPERBOX 2
 //!\brief Container class inside which a whole atom-position configuration is stored.\n
 //! An AtomContainer object represents a three-dimensional block which boundaries are defined by its origin and size.\n
 //!	The class comprises of a cellular structure (i.e. boxes) which is used to store the atoms.\n
@@ -57,6 +60,19 @@ public:
 	//! The number of elements of atomProperties must be consistent with the number of properties stored in atomPropertyList.
 	void addAtom(const double * pos, const std::vector<std::string> & atomProperties);
 
+	//!\brief Adds an atom to the container with already converted property values.
+	//!\param[in] pos The position of the atom. Must refer to data with at least three accessible elements.
+	//!\param[in] propertyValues The values of the additional properties of the atom, one for each property stored in atomPropertyList.
+	//!\param[in] propertyIsFloat Flag for each value, whether it has been given as floating point number (otherwise as integer).
+	//! An integer property is converted to a floating point property by the first floating point value.
+	void addAtom(const double * pos, const double * propertyValues, const std::vector<bool> & propertyIsFloat);
+
+	//!\brief Sorts all added atoms into the boxes.
+	//! Added atoms are collected in input order and become accessible in the boxes after this call.
+	//! The atoms of all boxes are stored in one contiguous block sorted by box.
+	//! Is called by \c calculateAtomOrientations() if atoms have been added since the last call.
+	void sortAtoms();
+
 	//!\brief Adds an additional user-defined property to the container.
 	//! Increases the number of properties stored in atomPropertyList by 1.
 	void addAtomProperty(const std::string & name);
@@ -89,9 +105,16 @@ public:
 	double getAtomsProperty(int propertyNum, const AtomID & atomId);
 
 	//!\brief Initializes the container object allocating memory for nAtoms atoms.
+	//! Memory of a previous frame is reused, the boxes are only allocated again if their number grows.
+	//! The boxes are at least \c minBoxSize large, the grid is coarsened if there are fewer than \c MINATOMSPERBOX atoms per box.
+	//! With sparse cells the boxes are created by \c sortAtoms() for the occupied cells of the grid only.
 	//!\param[in] nAtoms Number of atoms to allocate memory for.
 	virtual void generate(long nAtoms);
 
+	//!\brief Removes all atoms, properties, orientations and grains, so that the next frame can be read into the container.
+	//! All allocated memory is kept, the container has to be initialized again by \c setSize(), \c setOrigin() and \c generate().
+	void reset();
+
 	//!\brief Sets the size of the container object (in Angstrom).
 	//!\param[in] inSize Reference to the x,y and z coordinates of the size-values to set. The corresponding data-block must contain at least three accessible elements.
 	void setSize(const double * inSize);
@@ -121,6 +144,34 @@ public:
 	//!\param[in] rSqrMax Maximum squared radius for the nearest-neighbor identification step (in Angstrom^2).
 	void identifyGrains(double angularThreshold, double rSqrMin, double rSqrMax);
 
+	//!\brief Enables or disables the neighbor list, which is built once by \c calculateAtomOrientations() and reused by \c identifyGrains().
+	//! If disabled, each step runs its own neighbor search with less memory consumption.
+	void setUseNeighborList(bool inUseNeighborList);
+
+	//!\brief Selects the algorithm used by \c identifyGrains().
+	void setGrainEngineType(GrainEngineType inEngineType);
+
+	//!\brief Enables or disables sparse cells: only the boxes holding atoms are stored, their neighbors are found by a hash map.
+	//! Saves the memory of the empty boxes of samples with free surfaces or vacuum, takes effect with the next \c generate().
+	void setSparseCells(bool inSparseCells);
+
+	//!\brief Orders the boxes and the atoms inside each box along a Morton curve instead of the grid order and the input order.
+	//! Boxes and atoms close in space are then stored close together, the output is still written in input order.
+	//! Takes effect with the next \c generate().
+	void setMortonOrder(bool inMortonOrder);
+
+	//!\brief Builds a ghost halo of the periodic images once per frame, from which the neighbor searches read the positions of the box neighborhoods.
+	//! The halo stores the positions of all atoms a second time (plus the images) in the frame of the container.
+	void setGhostHalo(bool inGhostHalo);
+
+	//!\brief Adds a block of atoms with already converted property values to the container.
+	//! The atoms are sorted into the cell list in parallel, their input order is kept.
+	//!\param[in] atomPos Positions of the atoms, at least 3*nAtoms elements must be accessible.
+	//!\param[in] nAtoms Number of atoms.
+	//!\param[in] propertyValues The property values stored column by column: the value of property \c iP of atom \c i is at \c iP*nAtoms+i.
+	//!\param[in] propertyIsFloat Flag for each property, whether at least one of its values has been given as floating point number.
+	void addAtoms(const double * atomPos, long nAtoms, const double * propertyValues, const std::vector<bool> & propertyIsFloat);
+
 	//!\brief Adds atoms to the container by a list of atom-positions.
 	//!\param[in] atomPos Pointer to the beginning of the list. At least 3*nAtoms elements must be accessible.
 	//!\param[in] nAtoms Number of atoms contained in the list.
@@ -151,6 +202,9 @@ public:
 	//!\return A pointer to the underlying box-list. \c getNumBoxes() elements are accessible.
 	const AtomBox * getBoxes() const;
 
+	//!\return The atom positions sorted by box and the permutation to the input order of the atoms.
+	const CellList & getCellList() const { return cellList;};
+
 	//!\return The corresponding box-index in the underlying box-list to \c box.
 	//!\param[in] A pointer to a box. Must be contained in the underlying box-list.
 	long getBoxId (const AtomBox * box) const;
@@ -158,9 +212,6 @@ public:
 	//!\return The number of orientations stored inside the container object.
 	long getNumOrientations() const;
 
-	//!\return A pointer to the underlying orientation-list. Contains \c getNumOrientations() elements.
-	const Orientation * getOrientations() const;
-
 	//!\return A pointer to the underlying orientator-object.
 	const Orientator * getOrientator() const;
 
@@ -172,11 +223,26 @@ public:
 	const Grain * getGrain(long grainNum) const;
 
 	//!\return Whether the container has periodic boundary conditions or not.
-	virtual bool isPeriodic() const {return false;}
+	virtual bool isPeriodic() const = 0;
 protected:
 	void init(double * center, double * size, unsigned long * fragmentation, unsigned long initCapacity);
 	double reducedCoordinate(double pos, unsigned char dimension) const;
 	void calculateGrainProperties();
+	//!\brief Adds an atom to the cell list. \return \c false if the atom lies outside of the container.
+	bool addAtom(const double * pos);
+	//!\brief Calculates the origin of the box with the key \c cellKey in the grid.
+	void cellOrigin(long cellKey, double * outOrigin) const {
+		outOrigin[0] = origin[0] + boxSize[0] * (cellKey % nX);
+		outOrigin[1] = origin[1] + boxSize[1] * ((cellKey / nX) % nY);
+		outOrigin[2] = origin[2] + boxSize[2] * (cellKey / nXY);
+	};
+	//!\return The key of a cell in the cell list: the number of its box for dense cells (the Morton rank if ordered),
+	//! the Morton code of the cell or \c gridKey for sparse cells.
+	long boxKey(long gridKey) const {
+		if (!mortonOrder) return gridKey;
+		if (!sparseCells) return cellRanks[gridKey];
+		return morton::encode(gridKey % nX, (gridKey / nX) % nY, gridKey / nXY);
+	};
 	double origin[DIM];
 	double boxSize[DIM];
 	double size[DIM];
@@ -186,32 +252,83 @@ protected:
 	double minBoxSize;
 	long capacity = 0;
 	AtomBox * boxes = nullptr;
+	//!number of allocated boxes, may be larger than nBoxes after a reset
+	long boxCapacity = 0;
+	//!atoms of all boxes sorted by box
+	Atom * atoms = nullptr;
+	//!number of allocated atoms
+	long atomCapacity = 0;
+	//!per-atom results of the orientation calculation, kept to be reused by the next frame
+	std::vector<double> atomQuats;
+	bool * atomValid = nullptr;
 	Orientator * orient = nullptr;
 	GrainIdentificator * grains = nullptr;
-	AtomIdList atomInputOrder;
+	GrainEngineType grainEngineType = recursiveEngine;
+	NeighborList neighborList;
+	bool useNeighborList = true;
+	bool sparseCells = false;
+	bool mortonOrder = false;
+	bool useGhostHalo = false;
+	GhostHalo halo;
+	//!number of the box of each grid cell in Morton order (dense cells only) and the grid it has been calculated for
+	std::vector<long> cellRanks;
+	long rankGrid[DIM] = {0, 0, 0};
+	CellList cellList;
 	AtomPropertyList atomPropertyList;
 	const static int numDefaultProperties = 4;
 	std::string defaultAtomProperties[numDefaultProperties] =
 		{BOX_ID_NAME, ATOM_ID_NAME, ORIENTATION_ID_NAME, GRAIN_ID_NAME};
 private:
-	virtual void initBoxes();
-	virtual inline bool addAtom(const double * pos);
-	virtual inline bool valid(long ix, long iy, long iz) const;
-	virtual inline long id(long ix, long iy, long iz) const;
+	//!\brief Numbers the cells of the dense grid in Morton order.
+	void rankCells();
+	//!\brief Initializes the boxes of the dense grid and links the adjacent boxes.
+	virtual void initBoxes() = 0;
+	//!\brief Creates a box for each occupied cell of the sorted cell list and links the boxes of adjacent cells.
+	virtual void initSparseBoxes() = 0;
+	//!\brief Determines the box of a position and the position relative to the box's origin.
+	//!\return \c false if the position lies outside of the container.
+	virtual bool locateAtom(const double * pos, long & boxId, double * boxPos) const = 0;
+	//!\brief Determines the boxes of a block of appended atoms in parallel and sets them in the cell list.
+	//!\param[in] firstNum Number of the first atom of the block among the atoms added since the last sort.
+	//!\return The number of atoms, which lie outside of the container.
+	virtual long locateAtoms(const double * atomPos, long nAtoms, long firstNum) = 0;
 };
-//
-class PeriodicAtomContainer : public AtomContainer{
+
+//!\brief Container with its boundary conditions fixed at compile time.
+//! The grid functions (\c valid(), \c id() and \c locate()) are not virtual, so that they are inlined into the per-atom loop
+//! sorting the atoms into the cells and into the initialization of the boxes. The boundary conditions are chosen once,
+//! when the container is created, afterwards it is used through the interface of \c AtomContainer.
+//! Both instantiations are compiled in AtomContainer.cpp.
+template <bool PERIODIC>
+class GridAtomContainer : public AtomContainer {
 public:
-	PeriodicAtomContainer(double inMinBoxSize) : AtomContainer(inMinBoxSize){};
-	PeriodicAtomContainer(double * center, double * size, unsigned long * fragmentation) : AtomContainer(center, size, fragmentation){};
-	PeriodicAtomContainer(double * center, double * size, unsigned long * fragmentation,  unsigned long initCapacity) : AtomContainer(center, size, fragmentation, initCapacity){};
-	~PeriodicAtomContainer();
-	void addAtoms(double * atomPos, long nAtoms);
-	bool isPeriodic() const {return true;}
+	GridAtomContainer(double inMinBoxSize) : AtomContainer(inMinBoxSize){};
+	GridAtomContainer(double * center, double * size, unsigned long * fragmentation) : AtomContainer(center, size, fragmentation){ initBoxes();};
+	GridAtomContainer(double * center, double * size, unsigned long * fragmentation,  unsigned long initCapacity) : AtomContainer(center, size, fragmentation, initCapacity){ initBoxes();};
+	bool isPeriodic() const {return PERIODIC;}
 private:
 	void initBoxes();
-	inline bool addAtom(const double * pos);
-	inline long id(long ix, long iy, long iz) const;
+	void initSparseBoxes();
+	bool locateAtom(const double * pos, long & boxId, double * boxPos) const;
+	long locateAtoms(const double * atomPos, long nAtoms, long firstNum);
+	bool locate(const double * pos, long & boxId, double * boxPos) const;
+	//!\return Whether the cell lies inside the grid, always \c true for periodic containers.
+	bool valid(long ix, long iy, long iz) const;
+	//!\return The key of the cell in the grid, periodic containers wrap the cell around.
+	long id(long ix, long iy, long iz) const;
 };
+//the grid functions are specialized for both boundary conditions in AtomContainer.cpp, where they are inlined into the loops
+template <> inline bool GridAtomContainer<true>::locate(const double * pos, long & boxId, double * boxPos) const;
+template <> inline bool GridAtomContainer<true>::valid(long ix, long iy, long iz) const;
+template <> inline long GridAtomContainer<true>::id(long ix, long iy, long iz) const;
+template <> inline bool GridAtomContainer<false>::locate(const double * pos, long & boxId, double * boxPos) const;
+template <> inline bool GridAtomContainer<false>::valid(long ix, long iy, long iz) const;
+template <> inline long GridAtomContainer<false>::id(long ix, long iy, long iz) const;
+extern template class GridAtomContainer<true>;
+extern template class GridAtomContainer<false>;
+//!\brief Container with periodic boundary conditions, atoms outside are wrapped into it.
+typedef GridAtomContainer<true> PeriodicAtomContainer;
+//!\brief Container with open boundaries, atoms outside are rejected.
+typedef GridAtomContainer<false> OpenAtomContainer;
 
 #endif /* ATOMCONTAINER_H_ */
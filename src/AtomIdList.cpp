@@ -24,55 +24,38 @@ AtomIdList::AtomIdList() {
 AtomIdList::~AtomIdList() {
 }
 
-void AtomIdList::add(AtomID& id) {
-	if (id.iB >= inverseList.size()){
-		//list is too small -> reserve
-		reserveInverse(id.iB+1);
-	}
-	if (id.iA >= inverseList[id.iB]->size()) {
-		//leaf is too small -> resize
-		inverseList[id.iB]->resize(id.iA+1);
-	}
-	//save corresponding list index
-	(*inverseList[id.iB])[id.iA] = list.size();
-	//and save the id
-	list.push_back(id);
+void AtomIdList::assign(std::vector<long> & inBoxOffsets, std::vector<long> & inSortedNums, std::vector<long> & inInputNums) {
+	boxOffsets.swap(inBoxOffsets);
+	sortedNums.swap(inSortedNums);
+	inputNums.swap(inInputNums);
 }
 
-void AtomIdList::reserve(long nAtoms, long nBoxes) {
-	if (nAtoms >= 0) {
-		list.reserve(nAtoms);
-		reserveInverse(nBoxes);
-	}
+void AtomIdList::clear() {
+	std::vector<long>().swap(boxOffsets);
+	std::vector<long>().swap(sortedNums);
+	std::vector<long>().swap(inputNums);
 }
 
-const AtomID* AtomIdList::getAtomId(long iAtom) const{
-	if (iAtom >= 0 && iAtom < list.size()) {
-		return list.data() + iAtom;
-	}
-	return nullptr;
+void AtomIdList::reset() {
+	boxOffsets.clear();
+	sortedNums.clear();
+	inputNums.clear();
 }
 
-void AtomIdList::reserveInverse(long nBoxes) {
-	if (inverseList.size() < nBoxes) {
-		inverseList.reserve(nBoxes);
-		for (long i = inverseList.size() - 1; i < nBoxes; i++ ){
-			inverseList.push_back(new std::vector<long>);
-		}
-	}
+AtomID AtomIdList::getAtomId(long iAtom) const{
+	AtomID id;
+	long sortedNum = sortedNums[iAtom];
+	//the box is the last one starting at or before the sorted number
+	id.iB = std::upper_bound(boxOffsets.begin(), boxOffsets.end(), sortedNum) - boxOffsets.begin() - 1;
+	id.iA = sortedNum - boxOffsets[id.iB];
+	return id;
 }
 
 long AtomIdList::getAtomNum(const AtomID& id) const {
-	if (id.iB < inverseList.size()){
-		if(id.iA < inverseList[id.iB]->size()){
-			return (*inverseList[id.iB])[id.iA];
+	if (id.iB >= 0 && id.iB + 1 < boxOffsets.size()){
+		if(id.iA >= 0 && id.iA < boxOffsets[id.iB + 1] - boxOffsets[id.iB]){
+			return inputNums[boxOffsets[id.iB] + id.iA];
 		}
 	}
 	return -1;
 }
-
-void AtomIdList::deleteInverseList() {
-	for (long i = 0; i < inverseList.size(); i++) {
-		delete inverseList[i];
-	}
-}
@@ -20,19 +20,38 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define ATOMIDLIST_H_
 #include "GradeA_Defs.h"
 
+//!\brief Flat permutation between the input order of the atoms and their order sorted by box.
+//! The atoms of the box \c iB are stored contiguously at the positions \c boxOffsets[iB] to \c boxOffsets[iB+1]-1 of the sorted order,
+//! so that an \c AtomID (box id and atom id inside the box) corresponds to the sorted number \c boxOffsets[iB] + \c iA.
 class AtomIdList {
 public:
 	AtomIdList();
 	virtual ~AtomIdList();
-	void reserve(long nAtoms, long nBoxes);
-	void add(AtomID & id);
-	const AtomID * getAtomId(long iAtom) const;
+	//!\brief Takes over the permutation. The given vectors are swapped into the list.
+	//!\param[in,out] inBoxOffsets Sorted number of the first atom of each box, number of boxes + 1 elements.
+	//!\param[in,out] inSortedNums Sorted number of each atom in input order.
+	//!\param[in,out] inInputNums Input number of each atom in sorted order.
+	void assign(std::vector<long> & inBoxOffsets, std::vector<long> & inSortedNums, std::vector<long> & inInputNums);
+	//!\brief Frees the memory of the list.
+	void clear();
+	//!\brief Empties the list, but keeps its memory for the next \c assign().
+	void reset();
+	//!\return The number of atoms in the list.
+	long size() const { return sortedNums.size();};
+	//!\return The box id and the atom id inside the box of the atom with the input number \c iAtom.
+	AtomID getAtomId(long iAtom) const;
+	//!\return The input number of an atom identified by its box id and the atom id inside the box, -1 if not contained.
 	long getAtomNum(const AtomID & id ) const;
+	//!\return The sorted number of the atom with the input number \c iAtom.
+	long getSortedNum(long iAtom) const { return sortedNums[iAtom];};
+	//!\return The input number of the atom with the sorted number \c sortedNum.
+	long getInputNum(long sortedNum) const { return inputNums[sortedNum];};
+	//!\return The sorted numbers of the first atom of each box, number of boxes + 1 elements.
+	const std::vector<long> & getBoxOffsets() const { return boxOffsets;};
 private:
-	void reserveInverse(long nBoxes);
-	void deleteInverseList();
-	std::vector<AtomID> list;
-	std::vector<std::vector<long>* > inverseList;
+	std::vector<long> boxOffsets;
+	std::vector<long> sortedNums;
+	std::vector<long> inputNums;
 };
 
 
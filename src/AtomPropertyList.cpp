@@ -24,6 +24,10 @@ AtomPropertyList::AtomPropertyList() {
 }
 
 AtomPropertyList::~AtomPropertyList() {
+	clear();
+}
+
+void AtomPropertyList::clear() {
 	int i;
 	for(i = 0; i < integerProperties.size(); i++){
 		delete integerProperties[i];
@@ -31,6 +35,11 @@ AtomPropertyList::~AtomPropertyList() {
 	for(i = 0; i < floatProperties.size(); i++){
 		delete floatProperties[i];
 	}
+	propertyNames.clear();
+	propertyIsInt.clear();
+	propertyId.clear();
+	integerProperties.clear();
+	floatProperties.clear();
 }
 
 int AtomPropertyList::addProperty(const std::string & name, long reservedSize, bool isInteger) {
@@ -68,6 +77,26 @@ void AtomPropertyList::addFloatPropertyValue(int propertyNum, double value) {
 	}
 }
 
+void AtomPropertyList::addPropertyValues(int propertyNum, const double * values, long nValues, bool isFloat) {
+	if ( propertyNum < 0 || propertyNum >= getNumProperties()) {
+		return;
+	}
+	if (isFloat) {
+		convertPropertyToFloat(propertyNum);
+	}
+	if (propertyIsInt[propertyNum]) {
+		std::vector<int> & intValues = *integerProperties[propertyId[propertyNum]];
+		long nOldValues = intValues.size();
+		intValues.resize(nOldValues + nValues);
+		for (long i = 0; i < nValues; i++) {
+			intValues[nOldValues + i] = static_cast<int>(values[i]);
+		}
+	} else {
+		std::vector<double> & floatValues = *floatProperties[propertyId[propertyNum]];
+		floatValues.insert(floatValues.end(), values, values + nValues);
+	}
+}
+
 int AtomPropertyList::getNumProperties() const {
 	return propertyNames.size();
 }
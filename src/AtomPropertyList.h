@@ -23,10 +23,14 @@ class AtomPropertyList {
 public:
 	AtomPropertyList();
 	virtual ~AtomPropertyList();
+	//removes all properties and their values
+	void clear();
 	int addProperty(const std::string & name, long reservedSize , bool isInteger = true);
 	void convertPropertyToFloat(int propertyNum);
 	void addIntPropertyValue(int propertyNum, int value);
 	void addFloatPropertyValue(int propertyNum, double value);
+	//appends nValues values to a property, an integer property is converted first if isFloat is set
+	void addPropertyValues(int propertyNum, const double * values, long nValues, bool isFloat);
 	std::string getPropertyName(int propertyNum) const;
 	int getNumProperties() const;
 	int getIntPropertyValue(int propertyNum, long atomNum) const;
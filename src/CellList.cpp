@@ -0,0 +1,249 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "CellList.h"
+#include <unordered_set>
+
+CellList::CellList() {
+}
+
+CellList::~CellList() {
+}
+
+void CellList::reserve(long nAtoms) {
+	if (nAtoms > 0) {
+		addedCells.reserve(nAtoms);
+		addedPositions.reserve(DIM * nAtoms);
+	}
+}
+
+void CellList::add(long cellId, const double * cellPos) {
+	addedCells.push_back(cellId);
+	addedPositions.push_back(cellPos[0]);
+	addedPositions.push_back(cellPos[1]);
+	addedPositions.push_back(cellPos[2]);
+}
+
+long CellList::append(long nAtoms) {
+	long firstNum = addedCells.size();
+	addedCells.resize(firstNum + nAtoms);
+	addedPositions.resize(DIM * (firstNum + nAtoms));
+	return firstNum;
+}
+
+void CellList::truncate(long nAdded) {
+	if (nAdded < addedCells.size()) {
+		addedCells.resize(nAdded);
+		addedPositions.resize(DIM * nAdded);
+	}
+}
+
+void CellList::build(long nCells, bool inSparse, const double * mortonCellSize) {
+	long nSorted = inputOrder.size();
+	long nAtoms = nSorted + addedCells.size();
+	std::vector<long> cells(nAtoms);
+	std::vector<posType> positions(DIM * nAtoms);
+	//atoms sorted before are put in front of the added ones (in input order)
+	if (nSorted > 0) {
+		const std::vector<long> & oldOffsets = inputOrder.getBoxOffsets();
+		for (long iC = 0; iC < numCells; iC++) {
+			for (long sortedNum = oldOffsets[iC]; sortedNum < oldOffsets[iC + 1]; sortedNum++) {
+				long iAtom = inputOrder.getInputNum(sortedNum);
+				cells[iAtom] = getCellKey(iC);
+				positions[DIM * iAtom] = posX[sortedNum];
+				positions[DIM * iAtom + 1] = posY[sortedNum];
+				positions[DIM * iAtom + 2] = posZ[sortedNum];
+			}
+		}
+	}
+	std::copy(addedCells.begin(), addedCells.end(), cells.begin() + nSorted);
+	std::copy(addedPositions.begin(), addedPositions.end(), positions.begin() + DIM * nSorted);
+	std::vector<long>().swap(addedCells);
+	std::vector<posType>().swap(addedPositions);
+	sparse = inSparse;
+	if (sparse) {
+		nCells = numberOccupiedCells(cells);
+	} else {
+		std::vector<long>().swap(cellKeys);
+		cellNums.clear();
+	}
+	numCells = nCells;
+	//each chunk of atoms is counted and scattered by one thread
+	//the number of chunks is limited, such that the counters do not need more memory than one counter per atom
+	long nChunks = omp_get_max_threads();
+	if (nChunks > 1 + nAtoms / (nCells + 1)) nChunks = 1 + nAtoms / (nCells + 1);
+	std::vector<long> counters(nChunks * nCells, 0);
+	//1st pass: count the atoms of each cell and chunk
+#pragma omp parallel for schedule(static,1)
+	for (long iChunk = 0; iChunk < nChunks; iChunk++) {
+		long * chunkCounters = counters.data() + iChunk * nCells;
+		for (long iAtom = nAtoms * iChunk / nChunks; iAtom < nAtoms * (iChunk + 1) / nChunks; iAtom++) {
+			chunkCounters[cells[iAtom]]++;
+		}
+	}
+	//the vectors of the previous permutation are swapped out of the input order and reused
+	std::vector<long> cellOffsets;
+	std::vector<long> sortedNums;
+	std::vector<long> inputNums;
+	inputOrder.assign(cellOffsets, sortedNums, inputNums);
+	//prefix sum (cell by cell, chunk by chunk inside each cell): counters become the first position of each chunk inside each cell
+	cellOffsets.resize(nCells + 1);
+	long sum = 0;
+	long count;
+	for (long iC = 0; iC < nCells; iC++) {
+		cellOffsets[iC] = sum;
+		for (long iChunk = 0; iChunk < nChunks; iChunk++) {
+			count = counters[iChunk * nCells + iC];
+			counters[iChunk * nCells + iC] = sum;
+			sum += count;
+		}
+	}
+	cellOffsets[nCells] = sum;
+	//2nd pass: scatter the atoms to their cells
+	posX.resize(nAtoms);
+	posY.resize(nAtoms);
+	posZ.resize(nAtoms);
+	sortedNums.resize(nAtoms);
+	inputNums.resize(nAtoms);
+#pragma omp parallel for schedule(static,1)
+	for (long iChunk = 0; iChunk < nChunks; iChunk++) {
+		long * chunkCounters = counters.data() + iChunk * nCells;
+		long sortedNum;
+		for (long iAtom = nAtoms * iChunk / nChunks; iAtom < nAtoms * (iChunk + 1) / nChunks; iAtom++) {
+			sortedNum = chunkCounters[cells[iAtom]]++;
+			posX[sortedNum] = positions[DIM * iAtom];
+			posY[sortedNum] = positions[DIM * iAtom + 1];
+			posZ[sortedNum] = positions[DIM * iAtom + 2];
+			sortedNums[iAtom] = sortedNum;
+			inputNums[sortedNum] = iAtom;
+		}
+	}
+	if (mortonCellSize != nullptr) {
+		orderCellsByMortonCode(cellOffsets, sortedNums, inputNums, mortonCellSize);
+	}
+	inputOrder.assign(cellOffsets, sortedNums, inputNums);
+}
+
+void CellList::orderCellsByMortonCode(const std::vector<long> & cellOffsets, std::vector<long> & sortedNums, std::vector<long> & inputNums, const double * cellSize) {
+	const long nSubCells = 1L << CELLLIST_MORTONLEVELS;
+#pragma omp parallel
+{
+	std::vector<std::pair<uint64_t, long>> codes;
+	std::vector<posType> cellX, cellY, cellZ;
+	std::vector<long> cellInputNums;
+	long subCell[DIM];
+#pragma omp for schedule(dynamic,64)
+	for (long iC = 0; iC < numCells; iC++) {
+		long first = cellOffsets[iC];
+		long n = cellOffsets[iC + 1] - first;
+		if (n < 2) continue;
+		codes.resize(n);
+		for (long i = 0; i < n; i++) {
+			subCell[0] = posX[first + i] / cellSize[0] * nSubCells;
+			subCell[1] = posY[first + i] / cellSize[1] * nSubCells;
+			subCell[2] = posZ[first + i] / cellSize[2] * nSubCells;
+			for (int d = 0; d < DIM; d++) {
+				subCell[d] = std::min(std::max(subCell[d], 0L), nSubCells - 1);
+			}
+			codes[i].first = morton::encode(subCell[0], subCell[1], subCell[2]);
+			codes[i].second = i;
+		}
+		//the pairs are unique, as the second entries differ
+		std::sort(codes.begin(), codes.end());
+		cellX.assign(posX.begin() + first, posX.begin() + first + n);
+		cellY.assign(posY.begin() + first, posY.begin() + first + n);
+		cellZ.assign(posZ.begin() + first, posZ.begin() + first + n);
+		cellInputNums.assign(inputNums.begin() + first, inputNums.begin() + first + n);
+		for (long i = 0; i < n; i++) {
+			long src = codes[i].second;
+			posX[first + i] = cellX[src];
+			posY[first + i] = cellY[src];
+			posZ[first + i] = cellZ[src];
+			inputNums[first + i] = cellInputNums[src];
+			sortedNums[cellInputNums[src]] = first + i;
+		}
+	}
+}
+}
+
+long CellList::numberOccupiedCells(std::vector<long> & cells) {
+	long nAtoms = cells.size();
+	//each thread collects the keys of its atoms, consecutive atoms often lie in the same cell
+	std::vector<long> keys;
+#pragma omp parallel
+{
+	std::unordered_set<long> threadKeys;
+	long lastKey = -1;
+#pragma omp for schedule(static)
+	for (long iAtom = 0; iAtom < nAtoms; iAtom++) {
+		if (cells[iAtom] != lastKey) {
+			lastKey = cells[iAtom];
+			threadKeys.insert(lastKey);
+		}
+	}
+#pragma omp critical
+	keys.insert(keys.end(), threadKeys.begin(), threadKeys.end());
+}
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+	cellNums.clear();
+	cellNums.reserve(keys.size());
+	for (long iC = 0; iC < keys.size(); iC++) {
+		cellNums[keys[iC]] = iC;
+	}
+#pragma omp parallel for schedule(static)
+	for (long iAtom = 0; iAtom < nAtoms; iAtom++) {
+		cells[iAtom] = cellNums.find(cells[iAtom])->second;
+	}
+	cellKeys.swap(keys);
+	return cellKeys.size();
+}
+
+long CellList::findCell(long cellKey) const {
+	if (!sparse) {
+		return cellKey;
+	}
+	std::unordered_map<long, long>::const_iterator it = cellNums.find(cellKey);
+	return it == cellNums.end() ? -1 : it->second;
+}
+
+void CellList::clear() {
+	numCells = 0;
+	sparse = false;
+	std::vector<long>().swap(cellKeys);
+	cellNums.clear();
+	std::vector<long>().swap(addedCells);
+	std::vector<posType>().swap(addedPositions);
+	std::vector<posType>().swap(posX);
+	std::vector<posType>().swap(posY);
+	std::vector<posType>().swap(posZ);
+	inputOrder.clear();
+}
+
+void CellList::reset() {
+	numCells = 0;
+	sparse = false;
+	cellKeys.clear();
+	cellNums.clear();
+	addedCells.clear();
+	addedPositions.clear();
+	posX.clear();
+	posY.clear();
+	posZ.clear();
+	inputOrder.reset();
+}
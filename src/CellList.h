@@ -0,0 +1,127 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CELLLIST_H_
+#define CELLLIST_H_
+#include "GradeA_Defs.h"
+#include "AtomIdList.h"
+#include "MortonOrder.h"
+#include <unordered_map>
+
+//number of levels of the Morton curve through a cell, along which its atoms are ordered
+#define CELLLIST_MORTONLEVELS 4
+
+//!\brief Contiguous storage of the atom positions sorted by cell (compressed rows, CSR).
+//! Atoms are collected in input order by \c add() and afterwards sorted by \c build() with a parallel two-pass counting sort:
+//! the first pass counts the atoms of each cell, the second pass scatters them to their cell.
+//! The sort is stable, thus the atoms of a cell keep their input order independent of the number of threads.
+//! The positions are stored as structure of arrays (one column for each coordinate) relative to the origin of the cell.
+//! The columns are the only copy of the positions, they are stored in single precision in the compact memory mode.
+class CellList {
+public:
+	CellList();
+	virtual ~CellList();
+
+	//!\brief Allocates memory for \c nAtoms atoms to add.
+	void reserve(long nAtoms);
+
+	//!\brief Adds an atom in input order.
+	//!\param[in] cellId Number of the cell the atom is placed in.
+	//!\param[in] cellPos Position of the atom relative to the origin of the cell. At least three elements must be accessible.
+	void add(long cellId, const double * cellPos);
+
+	//!\brief Appends \c nAtoms atoms in input order, their cells and positions are set afterwards by \c set().
+	//!\return The number of the first appended atom among the atoms added since the last \c build().
+	long append(long nAtoms);
+
+	//!\brief Sets the cell and the position of an appended atom. Different atoms may be set concurrently.
+	//!\param[in] addedNum Number of the atom among the atoms added since the last \c build().
+	void set(long addedNum, long cellId, const double * cellPos) {
+		addedCells[addedNum] = cellId;
+		addedPositions[DIM * addedNum] = cellPos[0];
+		addedPositions[DIM * addedNum + 1] = cellPos[1];
+		addedPositions[DIM * addedNum + 2] = cellPos[2];
+	};
+
+	//!\brief Removes the added atoms behind the first \c nAdded ones.
+	void truncate(long nAdded);
+
+	//!\brief Sorts all added atoms by cell. Atoms sorted by a previous call are kept.
+	//!\param[in] nCells Number of cells, all added cell numbers must be smaller.
+	//!\param[in] sparse If \c true, the added cell numbers are keys of a grid with \c nCells cells, of which only the occupied ones are kept.
+	//! The occupied cells are numbered in the order of their keys and are found by a hash map (see \c findCell()).
+	//!\param[in] mortonCellSize If given, the atoms of each cell are ordered along a Morton curve through the cell of this size
+	//! instead of their input order, so that atoms close in space are stored close together.
+	void build(long nCells, bool sparse = false, const double * mortonCellSize = nullptr);
+
+	//!\brief Frees the memory of the list.
+	void clear();
+
+	//!\brief Removes all atoms, but keeps the memory of the sorted columns for the next \c build().
+	void reset();
+
+	//!\return Whether atoms have been added since the last \c build().
+	bool hasUnsortedAtoms() const { return !addedCells.empty();};
+
+	//!\return The number of sorted atoms.
+	long getNumAtoms() const { return inputOrder.size();};
+
+	//!\return The number of cells.
+	long getNumCells() const { return numCells;};
+
+	//!\return The sorted number of the first atom of the cell \c iC.
+	long getCellOffset(long iC) const { return inputOrder.getBoxOffsets()[iC];};
+
+	//!\return The number of atoms in the cell \c iC.
+	long getNumAtomsInCell(long iC) const { return getCellOffset(iC + 1) - getCellOffset(iC);};
+
+	//!\return The key of the cell \c iC in the grid, equal to \c iC if the list is not sparse.
+	long getCellKey(long iC) const { return sparse ? cellKeys[iC] : iC;};
+
+	//!\return The number of the cell with the key \c cellKey, -1 if the cell holds no atoms of a sparse list.
+	long findCell(long cellKey) const;
+
+	//!\return The columns of the x, y and z coordinates in sorted order.
+	const posType * getPosX() const { return posX.data();};
+	const posType * getPosY() const { return posY.data();};
+	const posType * getPosZ() const { return posZ.data();};
+
+	//!\return The permutation between input order and sorted order.
+	const AtomIdList & getInputOrder() const { return inputOrder;};
+private:
+	//!\brief Replaces the cell keys of all atoms by the numbers of the occupied cells.
+	//!\return The number of occupied cells.
+	long numberOccupiedCells(std::vector<long> & cells);
+	//!\brief Orders the atoms of each cell by the Morton code of their position in the cell, atoms with equal codes keep their order.
+	void orderCellsByMortonCode(const std::vector<long> & cellOffsets, std::vector<long> & sortedNums, std::vector<long> & inputNums, const double * cellSize);
+	long numCells = 0;
+	bool sparse = false;
+	//keys of the occupied cells in ascending order and their numbers (sparse only)
+	std::vector<long> cellKeys;
+	std::unordered_map<long, long> cellNums;
+	//atoms added in input order, not sorted yet
+	std::vector<long> addedCells;
+	std::vector<posType> addedPositions;
+	//sorted columns
+	std::vector<posType> posX;
+	std::vector<posType> posY;
+	std::vector<posType> posZ;
+	AtomIdList inputOrder;
+};
+
+#endif /* CELLLIST_H_ */
@@ -31,10 +31,11 @@ bool isNumeric(const std::string& input) {
     return true;
 }
 
-ComputationManager::ComputationManager(bool inPeriodic, double latticeParameter, double inAngularThreshold, std::string chemElementName, bool inPrintOrientations) {
+ComputationManager::ComputationManager(bool inPeriodic, double latticeParameter, double inAngularThreshold, std::string chemElementName, bool inPrintOrientations, const ComputationOptions & inOptions) {
 	material = new FccLattice(latticeParameter, VOLUMEUNIT,chemElementName);
 	periodic = inPeriodic;
 	printOrientations = inPrintOrientations;
+	options = inOptions;
 	NN_searchRadiusSqrMin = SQR(0.9 * HALFSQRT2 *  latticeParameter);
 	NN_searchRadiusSqrMax = SQR(1.1 * HALFSQRT2 * latticeParameter);
 	grainAngularThreshold = inAngularThreshold;
@@ -46,42 +47,167 @@ void ComputationManager::run(std::string fileNameWildCard, std::string inInitGra
 	std::cout << "This is the MSVC version" << std::endl;
 #endif
 	initGrainFileName = inInitGrainFileName;
+	RunPlan::printAtomDataBytes();
 	mkdir(TIMEEVOSUBDIR);
+	if (FrameStream::isStream(fileNameWildCard)) {
+		runStream(fileNameWildCard, startFileNum, endFileNum);
+		return;
+	}
 	queue.initByWildcard(fileNameWildCard, startFileNum, endFileNum);
 	queue.autoFindFiles();
+	if (options.groupShards) {
+		queue.groupShards();
+	}
+	if (options.multiFrameFiles) {
+		indexFrames();
+	}
 	std::cout <<"Found " << queue.numFiles() << " files to compute." << std::endl;
-	parallelRun();
+	//the headers of all inputs are read before the computation, so that broken inputs are reported at once
+	RunPlan plan(options.properties, options.useNeighborList);
+	plan.build(queue);
+	plan.print(options.dryRun);
+	if (options.dryRun) {
+		return;
+	}
+	parallelRun(plan);
 	std::cout << LINE << "\n"
 	<<"-- Finished whole Calculation --\n"
 	<< LINE <<std::endl;
 }
 
-void ComputationManager::parallelRun() {
+void ComputationManager::runStream(std::string streamName, int startFileNum, int endFileNum) {
+	FrameStream * stream;
+	try {
+		stream = new FrameStream(streamName);
+	} catch (const std::exception & e) {
+		std::cerr << e.what() << std::endl;
+		return;
+	}
+	//the output files are named by the stream and the number of each frame
+	std::string name = stream->getName();
+	queue.initStream(name);
+	std::cout << "Reading frames from \"" << name << "\"" << std::endl;
+	StopWatch streamWatch;
+	streamWatch.trigger();
+	//the frames are computed one after another, each with all threads, and tracked as soon as they are done
+	GrainTracker tracker(&queue, material, initGrainFileName);
+	std::vector<char> text;
+	for (int frameNum = 0; frameNum <= endFileNum; frameNum++) {
+		try {
+			if (!stream->nextFrame(text)) break;
+		} catch (const std::exception & e) {
+			std::cerr << "Reading of stream \"" << name << "\" stopped - " << e.what() << std::endl;
+			break;
+		}
+		if (frameNum < startFileNum) continue;
+		int fileNum = queue.numFiles();
+		queue.addStreamFrame(frameNum);
+		std::cout << "Running frame " << frameNum << " of stream \"" << name << "\"" << std::endl;
+		initContainer();
+		if (!importText(stream->getFileType(), name, text)) continue;
+		computeFile(fileNum);
+		tracker.advance(fileNum);
+	}
+	delete stream;
+	streamWatch.trigger();
+	std::cout << LINE << "\n"
+		<<"-- Stream of " << queue.numFiles() << " frames Done --\n"
+		<< LINE <<std::endl;
+	//the time evolution covers all frames, it is written at the end of the stream
+	std::cout << "Running TimeEvo-Writer with \"" << queue.outCsvFileNameWildCard() << "\"" << std::endl;
+	GrainTimeEvolutionWriter timeEvo(queue.outCsvFileNameWildCard());
+	timeEvo.run();
+	std::cout << "\nStream time = " << streamWatch.getString() << std::endl;
+	std::cout << LINE << "\n"
+	<<"-- Finished whole Calculation --\n"
+	<< LINE <<std::endl;
+}
+
+void ComputationManager::indexFrames() {
+	std::vector<std::string> fileNames(queue.numFiles());
+	for (int iF = 0; iF < queue.numFiles(); iF++) {
+		//a frame written as several shards is not split, it keeps no file name
+		if (queue.getNumShards(iF) == 1) fileNames[iF] = queue.fileName(iF);
+	}
+	std::vector<std::vector<FrameInfo> > fileFrames(queue.numFiles());
+#pragma omp parallel for schedule(dynamic,1) shared(std::cout, std::cerr, fileNames, fileFrames) default(none)
+	for (int iF = 0; iF < fileNames.size(); iF++) {
+		if (fileNames[iF].empty()) {
+			fileFrames[iF].assign(1, FrameInfo());
+			continue;
+		}
+		FrameIndex index(fileNames[iF]);
+		try {
+			index.load();
+			fileFrames[iF] = index.getFrames();
+		} catch (...) {
+#pragma omp critical
+{
+			std::cerr << "Frames of file \"" << fileNames[iF] << "\" could not be located, it is read as a single frame." << std::endl;
+}
+			fileFrames[iF].assign(1, FrameInfo());
+			continue;
+		}
+#pragma omp critical
+{
+		std::cout << (index.isScanned() ? "Indexed " : "Read index of ") << fileFrames[iF].size()
+			<< " frames of file \"" << fileNames[iF] << "\"" << std::endl;
+}
+	}
+	queue.splitIntoFrames(fileFrames);
+}
+
+void ComputationManager::parallelRun(const RunPlan & plan) {
 	OrientatorFileQueue privateQueue = queue;
+	const std::vector<int> & schedule = plan.getSchedule();
 	//Measure computation time
 	StopWatch parallelWatch;
 	parallelWatch.trigger();
 	//Even though this is a thread-parallelization, the threads do not share any data.
 	//The amount of memory increases linearly with number of threads.
-#pragma omp parallel shared(std::cout) firstprivate(privateQueue) default(none)
+	//If there are less files than threads, the remaining threads are used inside each file (nested parallelism).
+	int numThreads = omp_get_max_threads();
+	int numFileThreads = numThreads;
+	if (queue.numFiles() > 0 && queue.numFiles() < numFileThreads) {
+		numFileThreads = queue.numFiles();
+	}
+	//as many files as fit into the memory are computed at the same time
+	int numMemoryThreads = plan.getMaxFileThreads(numFileThreads);
+	if (numMemoryThreads < numFileThreads) {
+		std::cout << "The memory suffices for " << numMemoryThreads << " files at the same time" << std::endl;
+		numFileThreads = numMemoryThreads;
+	}
+	int numInnerThreads = numThreads / numFileThreads;
+	if (numInnerThreads > 1) {
+		omp_set_max_active_levels(2);
+	}
+#pragma omp parallel num_threads(numFileThreads) shared(std::cout, schedule) firstprivate(privateQueue, numInnerThreads) default(none)
 {
+	omp_set_num_threads(numInnerThreads);
 #pragma omp single
 {
 	std::cout << "Running computation in parallel with " << omp_get_num_threads() << " threads" << std::endl;
+	if (numInnerThreads > 1) {
+		std::cout << "Each file is computed with " << numInnerThreads << " threads" << std::endl;
+	}
 }
 	//DO NOT WRITE TO ANY MEMBER OF THIS CLASS OBJECT INSIDE THE PARALLEL REGION (shared memory) !!!!
 	//ESPECIALLY DONT USE the queue object, use privateQueue instead!
 
-	//Therefor construct a manager object for each thread
-	ComputationManager threadManager (periodic, material->getLatticeParameter(), grainAngularThreshold, material->getName(), printOrientations);
-#pragma omp for
-	for(int iF = 0; iF < privateQueue.numFiles(); iF++){
+	//Therefor construct a manager object for each thread, which keeps its container for all files of the thread
+	ComputationManager threadManager (periodic, material->getLatticeParameter(), grainAngularThreshold, material->getName(), printOrientations, options);
+	//the queue is copied once per thread, since it holds an entry per frame for files with several frames
+	threadManager.queue = privateQueue;
+	//the files are taken in the order of the plan, largest first, by the next free thread
+#pragma omp for schedule(dynamic,1)
+	for(int iS = 0; iS < schedule.size(); iS++){
+		int iF = schedule[iS];
 #pragma omp critical
 	{
 		std::cout << "Thread " << omp_get_thread_num() << ": Running file " << iF ;
 		std::cout << " with filename \"" << privateQueue.fileName(iF) << "\" " << std::endl;
 	}
-		threadManager.runFile(iF, privateQueue);
+		threadManager.runSingleFile(iF);
 	}
 }
 	parallelWatch.trigger();
@@ -114,46 +240,92 @@ void ComputationManager::runFile(int fileNum, OrientatorFileQueue & inQueue) {
 	runSingleFile(fileNum);
 }
 
-void ComputationManager::runSingleFile(int fileNum) {
-	//Init a new container object in order to store atom position data
-	initContainer();
-	std::string inputFileName;
-	inputFileName = queue.fileName(fileNum);
-
-	//import-object utilized to read data into the container
-	CFGImporter import(inputFileName, container);
-
-	//check whether file has cfg format, exit if not
-	bool isCfg;
+bool ComputationManager::importFile(std::string & inputFileName, int fileNum, SnapshotCache * cache) {
+	//import-object utilized to read data into the container, chosen by the format of the file (CFG or LAMMPS dump)
+	FileImporter * import;
 
 	try {
-		isCfg = import.checkFileFormat();
+		import = FileImporter::create(inputFileName, container);
+		if (import != nullptr) {
+			import->setFrame(queue.getFrame(fileNum));
+			import->setPropertySelection(options.properties);
+			import->setCache(cache);
+		}
 	} catch (...) {
 		std::cerr << "File \"" << queue.curFileName()
 				<< "\" skipped - could not be read." << std::endl;
-		delete container;
-		container = nullptr;
-		return;
+		return false;
 	}
 
-	if (!isCfg) {
+	if (import == nullptr) {
 		std::cerr << "File \"" << queue.curFileName()
 				<< "\" skipped - has wrong format." << std::endl;
-		delete container;
-		container = nullptr;
-		return;
+		return false;
 	}
 
-	//now since file has cfg format, parse it
+	//now since file has a supported format, parse it
 	try {
-		import.parseFile();
+		import->parseFile();
 	} catch (...) {
+		delete import;
 		std::cerr << "File \"" << queue.curFileName()
 				<< "\" skipped - could not be parsed." << std::endl;
-		delete container;
-		container = nullptr;
-		return;
+		return false;
+	}
+	delete import;
+	return true;
+}
+
+bool ComputationManager::importText(FileType type, std::string & streamName, const std::vector<char> & text) {
+	FileImporter * import = FileImporter::create(type, streamName, container);
+	import->setPropertySelection(options.properties);
+	try {
+		import->parseText(text.data(), text.data() + text.size());
+	} catch (...) {
+		delete import;
+		std::cerr << "Frame " << queue.getFileNameId(queue.numFiles() - 1) << " of stream \"" << streamName
+				<< "\" skipped - could not be parsed." << std::endl;
+		return false;
 	}
+	delete import;
+	return true;
+}
+
+void ComputationManager::runSingleFile(int fileNum) {
+	//Init the container object in order to store atom position data
+	initContainer();
+	std::string inputFileName;
+	inputFileName = queue.fileName(fileNum);
+
+	if (queue.getNumShards(fileNum) > 1) {
+		//the shards of a frame are parsed in parallel, they are not cached
+		std::vector<std::string> shardFileNames(queue.getNumShards(fileNum));
+		for (int iS = 0; iS < shardFileNames.size(); iS++) {
+			shardFileNames[iS] = queue.shardFileName(fileNum, iS);
+		}
+		try {
+			ShardImporter import(shardFileNames, container, options.properties);
+			import.parseFiles();
+		} catch (const std::exception & e) {
+#pragma omp critical
+{
+			std::cerr << "File \"" << queue.curFileName() << "\" skipped - " << e.what() << "." << std::endl;
+}
+			return;
+		}
+	} else {
+		//a cached snapshot of the input replaces parsing the file
+		SnapshotCache cache(inputFileName, queue.getFrame(fileNum), options.properties.getList(), options.cacheDirectory);
+		if (!options.useSnapshotCache || !cache.load(container)) {
+			if (!importFile(inputFileName, fileNum, options.useSnapshotCache ? &cache : nullptr)) {
+				return;
+			}
+		}
+	}
+	computeFile(fileNum);
+}
+
+void ComputationManager::computeFile(int fileNum) {
 	//---------------------------------------------------------------------
 	//MAIN EXECUTION:
 
@@ -169,6 +341,10 @@ void ComputationManager::runSingleFile(int fileNum) {
 	std::cout << LINE << "\n"
 	<<"Thread " << omp_get_thread_num() <<": Orientation Calculation Done (1/3)\n"
 	<< LINE <<std::endl;
+	const QuaternionTierCounter & tierCounter = container->getOrientator()->getTierCounter();
+	std::cout << "Thread " << omp_get_thread_num() << ": Quaternions extracted by closed form: " << tierCounter.counts[closedFormTier]
+		<< ", polar decomposition: " << tierCounter.counts[polarTier]
+		<< ", eigen solver: " << tierCounter.counts[eigenTier] << std::endl;
 }
 	//print orientations
 	if( printOrientations){
@@ -202,21 +378,30 @@ void ComputationManager::runSingleFile(int fileNum) {
 	std::cout << "Writing csv file: " << outputCsvFileName << std::endl;
 	writeCsvTableFile(outputCsvFileName);
 
-	delete container;
-	container = nullptr;
-
 	std::cout << "Finished calculation of file " << fileNum+1 << " with filename " << queue.curFileName() << std::endl << std::endl;
 }
 
 void ComputationManager::initContainer() {
+	//each thread keeps its container for all of its files, so that the memory of the previous file is reused
+	if (container != nullptr) {
+		container->reset();
+		return;
+	}
 	if (periodic) {
 		container = new PeriodicAtomContainer(boxSize);
 	} else {
-		container = new AtomContainer(boxSize);
+		container = new OpenAtomContainer(boxSize);
 	}
+	container->setGrainEngineType(options.grainEngine);
+	container->setUseNeighborList(options.useNeighborList);
+	container->setSparseCells(options.sparseCells);
+	container->setMortonOrder(options.mortonOrder);
+	container->setGhostHalo(options.ghostHalo);
 }
 
 ComputationManager::~ComputationManager() {
+	delete container;
+	container = nullptr;
 	delete material;
 	material = nullptr;
 }
@@ -26,29 +26,70 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "GradeA_Defs.h"
 #include "GradeA_Version.h"
 #include "GrainTracker.h"
+#include "RunPlan.h"
 #include "io/AtomIO.h"
 #include "io/CFGImporter.h"
+#include "io/ShardImporter.h"
+#include "io/FrameStream.h"
 #include "io/GrainTimeEvolutionWriter.h"
 
 #define PERIODIC_STRING "p"
 
-#define MAXFRAGMENT 80
-
+//! Optional settings of a computation, given as --name=value on the command line.
+struct ComputationOptions {
+	//! algorithm used to build the grains
+	GrainEngineType grainEngine = recursiveEngine;
+	//! build the nearest-neighbor list once per file and share it between all steps
+	bool useNeighborList = true;
+	//! split input files with several frames into one computation per frame
+	bool multiFrameFiles = false;
+	//! per-atom columns of the input files, which are stored as atom properties, and their types
+	PropertySelection properties;
+	//! write the parsed atoms of each input into a binary cache file and read them from it in later runs
+	bool useSnapshotCache = false;
+	//! directory of the cache files, the directory of the input files if empty
+	std::string cacheDirectory;
+	//! merge the files of a frame written per rank (e.g. dump.1000.0.cfg ... dump.1000.255.cfg) into one computation
+	bool groupShards = false;
+	//! print the run plan built from the headers of the input files and stop without computing
+	bool dryRun = false;
+	//! store only the boxes of the cell grid, which hold atoms (for samples with free surfaces or vacuum)
+	bool sparseCells = false;
+	//! store the cells and the atoms inside each cell along a Morton curve instead of the grid order and the input order
+	bool mortonOrder = false;
+	//! read the neighborhoods from a ghost halo of the periodic images built once per frame instead of the neighbor boxes
+	bool ghostHalo = false;
+};
 
 //! Class, which organizes a whole GraDe-A-computation.
 class ComputationManager {
 public:
-	ComputationManager(bool inPeriodic = true, double inLatticeParameter = 4.05, double inAngularThreshold = 0.5/RADTODEG, std::string inChemElemName = "Al", bool inPrintOrientations = false);
+	ComputationManager(bool inPeriodic = true, double inLatticeParameter = 4.05, double inAngularThreshold = 0.5/RADTODEG, std::string inChemElemName = "Al", bool inPrintOrientations = false, const ComputationOptions & inOptions = ComputationOptions());
 	virtual ~ComputationManager();
 	//! Executes a computation of multiple files identified by a wildcard-string.
 	void run(std::string fileNameWildCard, std::string inInitGrainFileName = "", int startFileNum = 0, int endFileNum = INT_MAX);
 	void runFile(int fileNum, OrientatorFileQueue & inQueue);
 private:
-	void parallelRun();
+	//! Computes the frames of a stream (stdin or a named pipe) one after another as they arrive.
+	//! The grains are tracked after each frame, frames with a number outside [startFileNum, endFileNum] are not computed.
+	void runStream(std::string streamName, int startFileNum, int endFileNum);
+	//! Computes the entries of the queue in the order of the plan.
+	void parallelRun(const RunPlan & plan);
+	//! Locates the frames of all files of the queue by their frame indices and replaces each file by its frames.
+	void indexFrames();
 	bool initPrevTimeStepDataFromCSVFile(std::string initGrainFileName);
 	//! Method, which runs a computation for a single file.
 	//!\param[in] fileNum file-identifier for the underlaying filequeue.
 	void runSingleFile(int fileNum);
+	//! Reads the atoms of an input file into the container by the importer of its format.
+	//!\param[in] cache Cache, into which the parsed atoms are written, nullptr for none.
+	//!\return false if the file has been skipped.
+	bool importFile(std::string & inputFileName, int fileNum, SnapshotCache * cache);
+	//! Reads the atoms of a frame of a stream into the container.
+	//!\return false if the frame has been skipped.
+	bool importText(FileType type, std::string & streamName, const std::vector<char> & text);
+	//! Computes the orientations and the grains of the atoms in the container and writes the output files of the entry \c fileNum.
+	void computeFile(int fileNum);
 	void initContainer();
 	void writeCfgFile(std::string fileName);
 	void writeCsvTableFile(std::string fileName);
@@ -63,6 +104,7 @@ private:
 	double boxSize = 0.;
 	bool periodic = true;
 	bool printOrientations = false;
+	ComputationOptions options;
 	//material
 	const FccLattice * material = nullptr;
 	//! nearest-neighbor search radii squared
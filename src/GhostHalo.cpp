@@ -0,0 +1,120 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "GhostHalo.h"
+#include <cmath>
+#include <unordered_map>
+//the shift of an image is coded by one digit in {0,1,2} for each coordinate (-1, 0, +1 times the size of the container)
+#define GHOSTHALO_NUMSHIFTS 27
+#define GHOSTHALO_NOSHIFT 13
+
+GhostHalo::GhostHalo() {
+}
+
+GhostHalo::~GhostHalo() {
+}
+
+void GhostHalo::build(AtomBox * boxes, long numBoxes, const CellList & cells, Atom * inAtoms, const double * origin, const double * size) {
+	atoms = inAtoms;
+	numAtoms = cells.getNumAtoms();
+	//1. the shift of each neighbor, which does not lie next to its box, but is reached across a periodic boundary
+	neighborCells.resize(MOORE * numBoxes);
+#pragma omp parallel for schedule(dynamic,64)
+	for (long iB = 0; iB < numBoxes; iB++) {
+		const double * boxOrigin = boxes[iB].getOrigin();
+		const double * boxSize = boxes[iB].getSize();
+		for (long iN = 0; iN < boxes[iB].getNumNeighbors(); iN++) {
+			const ABoxNeighbor & nbor = boxes[iB].getNeighbors()[iN];
+			long shiftCode = 0;
+			for (int d = DIM - 1; d >= 0; d--) {
+				double shift = boxOrigin[d] + nbor.coord[d] * boxSize[d] - nbor.box->getOrigin()[d];
+				shiftCode = 3 * shiftCode + lround(shift / size[d]) + 1;
+			}
+			//images are coded as negative numbers until their ghost cells are numbered
+			long nborNum = nbor.box - boxes;
+			neighborCells[MOORE * iB + iN] = shiftCode == GHOSTHALO_NOSHIFT ? nborNum : -1 - (GHOSTHALO_NUMSHIFTS * nborNum + shiftCode);
+		}
+	}
+	//2. one ghost cell for each image, numbered in the order of the boxes referring to it first
+	std::unordered_map<long, long> ghostCells;
+	std::vector<long> ghostImages;
+	for (long iB = 0; iB < numBoxes; iB++) {
+		for (long iN = 0; iN < boxes[iB].getNumNeighbors(); iN++) {
+			long & cell = neighborCells[MOORE * iB + iN];
+			if (cell >= 0) continue;
+			auto inserted = ghostCells.emplace(-1 - cell, numBoxes + long(ghostImages.size()));
+			if (inserted.second) ghostImages.push_back(-1 - cell);
+			cell = inserted.first->second;
+		}
+	}
+	long numCells = numBoxes + ghostImages.size();
+	cellOffsets.resize(numCells + 1);
+	for (long iB = 0; iB <= numBoxes; iB++) {
+		cellOffsets[iB] = cells.getCellOffset(iB);
+	}
+	for (long iG = 0; iG < ghostImages.size(); iG++) {
+		cellOffsets[numBoxes + iG + 1] = cellOffsets[numBoxes + iG] + boxes[ghostImages[iG] / GHOSTHALO_NUMSHIFTS].getNumAtoms();
+	}
+	atomNums.resize(cellOffsets[numCells]);
+	posX.resize(cellOffsets[numCells]);
+	posY.resize(cellOffsets[numCells]);
+	posZ.resize(cellOffsets[numCells]);
+	//3. the positions relative to the origin of the container, shifted for the ghost cells
+	const posType * cellPosX = cells.getPosX();
+	const posType * cellPosY = cells.getPosY();
+	const posType * cellPosZ = cells.getPosZ();
+#pragma omp parallel for schedule(dynamic,64)
+	for (long iC = 0; iC < numCells; iC++) {
+		long sourceBox = iC < numBoxes ? iC : ghostImages[iC - numBoxes] / GHOSTHALO_NUMSHIFTS;
+		double offset[DIM];
+		for (int d = 0; d < DIM; d++) {
+			offset[d] = boxes[sourceBox].getOrigin()[d] - origin[d];
+		}
+		if (iC >= numBoxes) {
+			long shiftCode = ghostImages[iC - numBoxes] % GHOSTHALO_NUMSHIFTS;
+			for (int d = 0; d < DIM; d++) {
+				offset[d] += (shiftCode % 3 - 1) * size[d];
+				shiftCode /= 3;
+			}
+		}
+		long atomNum = cells.getCellOffset(sourceBox);
+		for (long iE = cellOffsets[iC]; iE < cellOffsets[iC + 1]; iE++, atomNum++) {
+			atomNums[iE] = atomNum;
+			posX[iE] = offset[0] + cellPosX[atomNum];
+			posY[iE] = offset[1] + cellPosY[atomNum];
+			posZ[iE] = offset[2] + cellPosZ[atomNum];
+		}
+	}
+	built = true;
+}
+
+void GhostHalo::clear() {
+	reset();
+	std::vector<long>().swap(cellOffsets);
+	std::vector<long>().swap(neighborCells);
+	std::vector<long>().swap(atomNums);
+	std::vector<double>().swap(posX);
+	std::vector<double>().swap(posY);
+	std::vector<double>().swap(posZ);
+}
+
+void GhostHalo::reset() {
+	built = false;
+	numAtoms = 0;
+	atoms = nullptr;
+}
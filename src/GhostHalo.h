@@ -0,0 +1,91 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GHOSTHALO_H_
+#define GHOSTHALO_H_
+#include "GradeA_Defs.h"
+#include "AtomBox.h"
+#include "CellList.h"
+#include <vector>
+
+//!\brief Positions of the atoms of all boxes in the frame of the container together with ghost copies of their periodic images (ghost halo).
+//! The halo is built once per frame. It consists of cells stored in compressed rows (CSR): the first cells are the boxes,
+//! whose atoms keep the numbers of the cell list, the following ghost cells hold the images of boxes, which are neighbors across a periodic boundary,
+//! shifted by the size of the container. Each neighbor of a box refers to the cell, which lies at its place.
+//! Thus the atoms of a box neighborhood are read cell by cell without shifting positions, equally for periodic and non-periodic containers.
+//! The positions are stored in double precision also in the compact memory mode, where they would lose digits in the frame of the container.
+class GhostHalo {
+public:
+	GhostHalo();
+	virtual ~GhostHalo();
+
+	//!\brief Builds the halo from the atoms of all boxes.
+	//!\param[in] boxes Box list of the container, the atoms of the boxes must be sorted into \c cells.
+	//!\param[in] numBoxes Number of boxes.
+	//!\param[in] cells Cell list holding the positions of the atoms relative to the origins of their boxes.
+	//!\param[in] atoms Atoms of all boxes sorted by box, must stay valid as long as the halo is used.
+	//!\param[in] origin Origin of the container. At least three elements must be accessible.
+	//!\param[in] size Size of the container, by which the periodic images are shifted. At least three elements must be accessible.
+	void build(AtomBox * boxes, long numBoxes, const CellList & cells, Atom * atoms, const double * origin, const double * size);
+
+	//!\brief Frees the memory of the halo.
+	void clear();
+
+	//!\brief Marks the halo as not built, but keeps its memory for the next \c build().
+	void reset();
+
+	//!\return Whether the halo has been built.
+	bool isBuilt() const { return built;};
+
+	//!\return The number of the first entry of the cell \c iC. The entries of a box are numbered like its atoms in the cell list.
+	long getCellBegin(long iC) const { return cellOffsets[iC];};
+
+	//!\return The number behind the last entry of the cell \c iC.
+	long getCellEnd(long iC) const { return cellOffsets[iC + 1];};
+
+	//!\return The cell at the place of the neighbor \c iN of the box \c iB.
+	long getNeighborCell(long iB, long iN) const { return neighborCells[MOORE * iB + iN];};
+
+	//!\return The number of ghost entries (copies of periodic images).
+	long getNumGhosts() const { return atomNums.size() - numAtoms;};
+
+	//!\return The number of the atom in the cell list, which the entry \c iE is a copy of.
+	long getAtomNum(long iE) const { return atomNums[iE];};
+
+	//!\return The atom, which the entry \c iE is a copy of.
+	Atom * getAtom(long iE) const { return atoms + atomNums[iE];};
+
+	//!\return The columns of the x, y and z coordinates of all entries relative to the origin of the container.
+	const double * getPosX() const { return posX.data();};
+	const double * getPosY() const { return posY.data();};
+	const double * getPosZ() const { return posZ.data();};
+private:
+	bool built = false;
+	long numAtoms = 0;
+	Atom * atoms = nullptr;
+	std::vector<long> cellOffsets;
+	//cells of the neighbors of each box, MOORE per box
+	std::vector<long> neighborCells;
+	//number of the atom in the cell list for each entry
+	std::vector<long> atomNums;
+	std::vector<double> posX;
+	std::vector<double> posY;
+	std::vector<double> posZ;
+};
+
+#endif /* GHOSTHALO_H_ */
@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 #include <array>
 #include <climits>
+#include <cstdint>
 #include <string>
 
 #define VOLUMEUNIT "1000nm^3"
@@ -40,7 +41,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define THIRD2 		(0.666666666666666666666666667)
 #define THIRDSQRT2 (0.47140452079103168293389624140)
 #define FOURTHIRDPI (4.188790204786390984616857844373)
-#define ATOMALLOC 5
 #ifdef _MSC_VER
 #define DIRCHAR '\\'
 #else
@@ -58,8 +58,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "OrientationMath.h"
 
+#ifdef COMPACT_MEMORY
+//positions relative to the origin of their box need no double precision
+typedef float posType;
+typedef int32_t oID;
+typedef int32_t gID;
+#else
+typedef double posType;
 typedef long oID;
 typedef long gID;
+#endif
 
 typedef struct{
 	long iB;
@@ -31,10 +31,17 @@ void Grain::addToCenter(const double *vec)
 	nCenter++;
 }
 
+void Grain::reserve(long nAtoms)
+{
+	atoms.reserve(nAtoms);
+}
+
 void Grain::add(Atom * atom, const Orientator * orient)
 {
 	atoms.push_back(atom);
-	meanOrient.add(orient->getOrientation(atom->getOrientationId())->getQuaternion());
+	double q[4];
+	orient->getQuaternion(atom, q);
+	meanOrient.add(q);
 }
 
 void Grain::addOrphan(Atom *oAtom)
@@ -114,13 +121,13 @@ void Grain::calcRegularOrientationSpread(const Orientator * orient)
 	oriSpread = 0.;
 	cosHalfOriSpread = 0.;
 	double cosHalfMisOri;
-	oID oId;
+	double q[4];
 	long n = 0;
 	for (long i = 0; i < atoms.size(); i++){
-		oId = atoms[i]->getOrientationId();
-		if (oId == NO_ORIENTATION) continue;
+		if (!orient->hasOrientation(atoms[i])) continue;
+		orient->getQuaternion(atoms[i], q);
 		cosHalfMisOri = ori::cosHalfMisOrientation(
-		orient->getOrientation(oId)->getQuaternion(),
+		q,
 		meanOrient.getQuaternion()
 		);
 		n++;
@@ -137,13 +144,13 @@ void Grain::calcOrphanOrientationSpread(const Orientator * orient){
 	orphanOriSpread = 0.;
 	orphanCosHalfOriSpread = 0.;
 	double cosHalfMisOri;
-	oID oId;
+	double q[4];
 	long n = 0;
 	for (long i = 0; i < orphanAtoms.size(); i++){
-		oId = orphanAtoms[i]->getOrientationId();
-		if (oId == NO_ORIENTATION) continue;
+		if (!orient->hasOrientation(orphanAtoms[i])) continue;
+		orient->getQuaternion(orphanAtoms[i], q);
 		cosHalfMisOri = ori::cosHalfMisOrientation(
-		orient->getOrientation(oId)->getQuaternion(),
+		q,
 		meanOrient.getQuaternion()
 		);
 		n++;
@@ -25,6 +25,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 class Grain {
 public:
 	Grain();
+	void reserve(long nAtoms);
 	void add(Atom * atom, const Orientator * orient);
 	void addOrphan(Atom * oAtom);
 	void addToCenter(const double * vec);
@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "GrainIdentificator.h"
+#include "UnionFindGrainIdentificationEngine.h"
 
 GrainIdentificator::GrainIdentificator(Orientator * inOrient, AtomBox * inBoxes, long inNumBoxes, double angleThreshold, unsigned char inNumMaxAtomNeighbors) {
 	numGrains = 0;
@@ -38,7 +39,27 @@ GrainIdentificator::~GrainIdentificator() {
 	delete engine;
 }
 
+void GrainIdentificator::reset(AtomBox * inBoxes, long inNumBoxes) {
+	while (!grains.empty()) {
+		deleteLastGrain();
+	}
+	numGrains = 0;
+	boxes = inBoxes;
+	numBoxes = inNumBoxes;
+	newEmptyGrain();
+}
+
 long GrainIdentificator::run(double angularThreshold) {
+	if (engineType == unionFindEngine) {
+		deleteLastGrain();
+		UnionFindGrainIdentificationEngine ufEngine(orient, boxes, numBoxes, nMaxAtomNeighbors);
+		ufEngine.setSearchRadiiSquared(rSqrMin, rSqrMax);
+		ufEngine.setContainerGeometry(containerSize, periodic);
+		ufEngine.setNeighborList(neighborList);
+		numGrains += ufEngine.run(angularThreshold, 200, grains);
+		calculateOrientationSpread();
+		return grains.size();
+	}
 	//for all atoms run the recursive engine
 	AtomBox * box;
 	long iA;
@@ -85,9 +106,27 @@ void GrainIdentificator::assign() {
 }
 
 void GrainIdentificator::setSearchRadiiSquared(double inRsqrMin, double inRsqrMax) {
+	rSqrMin = inRsqrMin;
+	rSqrMax = inRsqrMax;
 	engine->setSearchRadiiSquared(inRsqrMin, inRsqrMax);
 }
 
+void GrainIdentificator::setEngineType(GrainEngineType inEngineType) {
+	engineType = inEngineType;
+}
+
+void GrainIdentificator::setNeighborList(const NeighborList * inNeighborList) {
+	neighborList = inNeighborList;
+	engine->setNeighborList(inNeighborList);
+}
+
+void GrainIdentificator::setContainerGeometry(const double * inSize, bool inPeriodic) {
+	containerSize[0] = inSize[0];
+	containerSize[1] = inSize[1];
+	containerSize[2] = inSize[2];
+	periodic = inPeriodic;
+}
+
 Grain * GrainIdentificator::getGrain(gID grainID) {
 	if (grainID >= 0) {
 		return grains[grainID];
@@ -198,7 +237,16 @@ void GrainIdentificator::orphanAtomAssignAttempt(std::vector<AtomID> & unassigne
 		box = boxes + unassignedAtoms[iA].iB;
 		atom = box->getAtom(unassignedAtoms[iA].iA);
 		//calculate nearest neighbors
-		nNeighbors = box->nearestAtomNeighbors(unassignedAtoms[iA].iA, nMaxAtomNeighbors, neighbors);
+		if (neighborList) {
+			long atomNum = neighborList->getAtomNum(box, unassignedAtoms[iA].iA);
+			const long * nborNums = neighborList->getNeighbors(atomNum);
+			nNeighbors = neighborList->getNumNeighbors(atomNum, nMaxAtomNeighbors);
+			for (unsigned char iN = 0; iN < nNeighbors; iN++) {
+				neighbors[iN] = neighborList->getAtom(nborNums[iN]);
+			}
+		} else {
+			nNeighbors = box->nearestAtomNeighbors(unassignedAtoms[iA].iA, nMaxAtomNeighbors, neighbors);
+		}
 		if (nNeighbors <= 0) {
 			continue;
 		}
@@ -280,6 +328,14 @@ void RecursiveGrainIdentificationEngine::setSearchRadiiSquared(double inRsqrMin,
 	rSqrMax = inRsqrMax;
 }
 
+void RecursiveGrainIdentificationEngine::setNeighborList(const NeighborList * inNeighborList) {
+	neighborList = inNeighborList;
+}
+
+const NeighborList * RecursiveGrainIdentificationEngine::getNeighborList() const {
+	return neighborList;
+}
+
 void RecursiveGrainIdentificationEngine::setup(gID inGrainId, Grain *inGrain, double angularThreshold) {
 	grainId = inGrainId;
 	grain = inGrain;
@@ -342,7 +398,7 @@ bool RecursiveGrainIdentificationEngine::belongsToGrain(GrainCandidate * candida
 	if (atom->getGrainId() != NO_GRAIN) {
 		return false;
 	}
-	if (atom->getOrientationId() == NO_ORIENTATION) {
+	if (!orient->hasOrientation(atom)) {
 		return false;
 	}
 	parentAtom = candidate->getParentAtom();
@@ -363,15 +419,16 @@ bool RecursiveGrainIdentificationEngine::strictBelongsToGrain(GrainCandidate * c
 	if (atom->getGrainId() != NO_GRAIN) {
 		return false;
 	}
-	if (atom->getOrientationId() == NO_ORIENTATION) {
+	if (!orient->hasOrientation(atom)) {
 		return false;
 	}
 	parentAtom = candidate->getParentAtom();
 	if (!orient->haveCloseOrientations(parentAtom, atom, cosHalfThreshold)) {
 		return false;
 	}
-	if (!ori::haveCloseOrientations(grain->getOrientation()->getQuaternion(), orient->getOrientation(atom->getOrientationId())->getQuaternion(),
-			bigCosHalfThreshold)) {
+	double q[4];
+	orient->getQuaternion(atom, q);
+	if (!ori::haveCloseOrientations(grain->getOrientation()->getQuaternion(), q, bigCosHalfThreshold)) {
 		return false;
 	}
 	return true;
@@ -391,7 +448,7 @@ void RecursiveGrainIdentificationEngine::test(GrainCandidateList *candidates) {
 		if (atom->getGrainId() != NO_GRAIN) {
 			continue;
 		}
-		if (atom->getOrientationId() == NO_ORIENTATION) {
+		if (!orient->hasOrientation(atom)) {
 			continue;
 		}
 		parentAtom = candidate->getParentAtom();
@@ -446,10 +503,29 @@ void GrainCandidate::activate() {
 	active = true;
 }
 
-unsigned char GrainCandidate::findNeighbors(unsigned char inNumMaxAtomNeighbors, GrainCandidate *outNeighborsList, double rSqrMin, double rSqrMax) {
-	AtomBoxP * nborBoxesList = new AtomBoxP[inNumMaxAtomNeighbors];
-	long * nborAtomIdList = new long[inNumMaxAtomNeighbors];
-	double * neighborVects = new double[DIM * inNumMaxAtomNeighbors];
+unsigned char GrainCandidate::findNeighbors(unsigned char inNumMaxAtomNeighbors, GrainCandidate *outNeighborsList, double rSqrMin, double rSqrMax, const NeighborList * nborList) {
+	if (nborList) {
+		long nborNums[NEIGHBORLIST_MAXNEIGHBORS];
+		double nborVects[NEIGHBORLIST_MAXNEIGHBORS * DIM];
+		unsigned char nNeighbors = nborList->getShellNeighbors(nborList->getAtomNum(box, atomId), inNumMaxAtomNeighbors, nborNums, nborVects);
+		double * curVect;
+		AtomID nborId;
+		for (unsigned char iNA = 0; iNA < nNeighbors; iNA++) {
+			curVect = nborVects + iNA * DIM;
+			curVect[0] += position[0];
+			curVect[1] += position[1];
+			curVect[2] += position[2];
+			nborId = nborList->getAtomId(nborNums[iNA]);
+			outNeighborsList[iNA].init(nborList->getBox(nborId.iB), nborId.iA, curVect);
+		}
+		return nNeighbors;
+	}
+	if (inNumMaxAtomNeighbors > NEIGHBORLIST_MAXNEIGHBORS) {
+		inNumMaxAtomNeighbors = NEIGHBORLIST_MAXNEIGHBORS;
+	}
+	AtomBoxP nborBoxesList[NEIGHBORLIST_MAXNEIGHBORS];
+	long nborAtomIdList[NEIGHBORLIST_MAXNEIGHBORS];
+	double neighborVects[DIM * NEIGHBORLIST_MAXNEIGHBORS];
 	unsigned char nNeighbors = box->atomNeighbors(atomId, rSqrMin, rSqrMax, inNumMaxAtomNeighbors, nborBoxesList, nborAtomIdList, neighborVects);
 	double * curVect;
 	for (unsigned char iNA = 0; iNA < nNeighbors; iNA++) {
@@ -462,9 +538,6 @@ unsigned char GrainCandidate::findNeighbors(unsigned char inNumMaxAtomNeighbors,
 		curVect[2] += position[2];
 		outNeighborsList[iNA].init(nborBoxesList[iNA], nborAtomIdList[iNA], curVect);
 	}
-	delete[] nborBoxesList;
-	delete[] nborAtomIdList;
-	delete[] neighborVects;
 	return nNeighbors;
 }
 
@@ -526,7 +599,7 @@ void GrainCandidateList::buildNextGeneration(GrainCandidateList & nextGenList, d
 	for (long i = 0; i < list.size(); i++) {
 		if (list[i].isActive()) {
 			//
-			nNeighbors = list[i].findNeighbors(nMaxAtomNeighbors, testCandidates, rSqrMin, rSqrMax);
+			nNeighbors = list[i].findNeighbors(nMaxAtomNeighbors, testCandidates, rSqrMin, rSqrMax, owner->getNeighborList());
 			if (nNeighbors > nMaxAtomNeighbors) {
 				std::cerr << "ERROR too much neighbors" << std::endl;
 			}
@@ -25,7 +25,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Orientator.h"
 #include "AtomBox.h"
 #include "Grain.h"
+#include "NeighborList.h"
 class RecursiveGrainIdentificationEngine;
+class UnionFindGrainIdentificationEngine;
+//!\brief Algorithm used to build the grains from the oriented atoms.
+enum GrainEngineType {
+	recursiveEngine, //!< serial recursive infection of the neighbors (default)
+	unionFindEngine //!< parallel connected components by a concurrent union-find
+};
 typedef struct {
 	long id;
 	long count;
@@ -37,8 +44,15 @@ public:
 	GrainIdentificator(Orientator * inOrient, AtomBox * inBoxes, long inNumBoxes, double angleThreshold, unsigned char nMaxAtomNeighbors);
 	long getNumGrains();
 	virtual ~GrainIdentificator();
+	//!\brief Removes all grains and attaches the object to other boxes, the settings are kept.
+	void reset(AtomBox * inBoxes, long inNumBoxes);
 	Grain * getGrain(gID grainID);
 	void setSearchRadiiSquared(double inRsqrMin, double inRsqrMax);
+	void setEngineType(GrainEngineType inEngineType);
+	//!\brief Sets the container geometry, needed by the union-find engine to unwrap periodic grains.
+	void setContainerGeometry(const double * inSize, bool inPeriodic);
+	//!\brief Sets a prebuilt neighbor list, which replaces the neighbor searches of all steps. \c nullptr disables it.
+	void setNeighborList(const NeighborList * inNeighborList);
 	long run(double angularThreshold);//returns the number of found grains
 	void calculateOrientationSpread();
 	void assignOrphanAtoms(long depth = 0);
@@ -61,6 +75,11 @@ private:
 	long grainAlloc = 0;
 	RecursiveGrainIdentificationEngine * engine = nullptr;
 	unsigned char nMaxAtomNeighbors = 0;
+	GrainEngineType engineType = recursiveEngine;
+	double rSqrMin = 0., rSqrMax = 0.;
+	double containerSize[DIM] = {0., 0., 0.};
+	bool periodic = false;
+	const NeighborList * neighborList = nullptr;
 };
 
 class GrainCandidate{
@@ -72,7 +91,7 @@ public:
 	void activate();
 	void setParent(GrainCandidate * inParent);
 	bool isActive();
-	unsigned char findNeighbors(unsigned char inNumMaxAtomNeighbors, GrainCandidate * outNeighborsList, double rSqrMin, double rSqrMax);
+	unsigned char findNeighbors(unsigned char inNumMaxAtomNeighbors, GrainCandidate * outNeighborsList, double rSqrMin, double rSqrMax, const NeighborList * nborList = nullptr);
 	Atom * getAtom();
 	Atom * getParentAtom();
 	AtomBox * getBox();
@@ -111,6 +130,8 @@ class RecursiveGrainIdentificationEngine {
 	RecursiveGrainIdentificationEngine(Orientator * inOrient, unsigned char inNumMaxAtomNeighbors, double inAngleThreshold);
 	virtual ~RecursiveGrainIdentificationEngine();
 	void setSearchRadiiSquared(double inRsqrMin, double inRsqrMax);
+	void setNeighborList(const NeighborList * inNeighborList);
+	const NeighborList * getNeighborList() const;
 	void init(Orientator * orient, unsigned char inNumMaxAtomNeighbors, double inAngleThreshold);
 	void setup(gID inGrainId, Grain * inGrain, double angularThreshold);
 	long start(Atom * parent, AtomBox * curBox, long curAtomNum, double * inRelAtomPos);
@@ -129,6 +150,7 @@ class RecursiveGrainIdentificationEngine {
 	double rSqrMin, rSqrMax;
 	double cosHalfThreshold, bigCosHalfThreshold;
 	unsigned char nMaxAtomNeighbors;
+	const NeighborList * neighborList = nullptr;
 	Grain * grain;
 	gID grainId;
 	Orientator * orient;
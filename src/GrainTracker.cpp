@@ -38,29 +38,9 @@ void GrainTracker::run() {
 	watch.trigger();
 	std::string initCsvFileName;
 	int initFileNum = 0;
-	bool prevDataInitialized = false;
-	if( initGrainFileName != "") {
-		std::cout << "Initializing from grain data file \"" << initGrainFileName << "\" ." << std::endl;
-		initCsvFileName = initGrainFileName;
-		if (initPrevTimeStepDataFromCSVFile(initGrainFileName)){
-			prevDataInitialized = true;
-			grainNumberingBegin = prevData->maxGrainId() + 1 ;
-		} else {
-			std::cerr << "Failed to initialize from file \"" << initGrainFileName << "\" will continue with standard grain numbering."<< std::endl;
-		}
-	}
-
-	if (!prevDataInitialized){
-		if(initPrevTimeStepDataFromCSVFile(queue->outCsvFileName(0))){
-			initCsvFileName = queue->outCsvFileName(0);
-			prevDataInitialized = true;
-			initFileNum = 1;
-			grainNumberingBegin = prevData->getNumberOfGrains();
-		} else {
-			std::cerr << "Failed to initialize from file \"" << queue->outCsvFileName(0) << "\" will continue with standard grain numbering."<< std::endl;
-			std::cerr << "Exited " << std::endl;
-			return;
-		}
+	if (!initTracking(0, initFileNum, initCsvFileName)) {
+		std::cerr << "Exited " << std::endl;
+		return;
 	}
 
 	std::cout << "Tracking applied from file \""<< initCsvFileName <<"\" for " << queue->numFiles()-initFileNum <<" files "<< std::endl;
@@ -69,35 +49,7 @@ void GrainTracker::run() {
 	std::vector<int> mappingFileNums;
 	//This for loop MUST be run serially!
 	for(int iF = initFileNum; iF < queue->numFiles(); iF++){
-		//read in the csv file
-		CSVTableReader curReader  (queue->outCsvFileName(iF),csvFormat.getNumHeaderLines());
-		curReader.parse();
-		if(!csvFormat.isRightFormat(&curReader)){
-			std::cout << "Exiting \"" << queue->outCsvFileName(iF) << "\" has wrong format" << std::endl;
-			continue;
-		}
-		//init curData object
-		curData = new ContainerData();
-		if(!csvFormat.init(&curReader, curData)){
-			delete curData;
-			curData = nullptr;
-			continue;
-		}
-		mapping = new GrainIDMapper(*material,prevData, curData);
-		mapping->init(maxCosHalfMisOri,maxVolFrac, grainNumberingBegin);
-		mapping->map();
-		calculateGrainDataChangeToInitial();
-		//first construct copies of that mapping stuff in order to start a task independently
-		mappings.push_back(mapping);
-		mappingFileNums.push_back(iF);
-		grainNumberingBegin = mapping->getNewGrainId();
-		delete mapping;
-		mapping = nullptr;
-		//for the next timestep(file) make curData available as prevData
-		delete prevData;
-		prevData = curData;
-		//make curData able to be deleted again
-		curData = nullptr;
+		trackFile(iF, mappings, mappingFileNums);
 	}
 	watch.trigger();
 	int numFiles = mappings.size();
@@ -130,6 +82,94 @@ void GrainTracker::run() {
 	}
 }
 
+void GrainTracker::advance(int fileNum) {
+	if (!isStarted) {
+		isStarted = true;
+		std::string initCsvFileName;
+		int initFileNum = fileNum;
+		if (!initTracking(fileNum, initFileNum, initCsvFileName)) {
+			std::cerr << "Grain tracking is switched off." << std::endl;
+			return;
+		}
+		std::cout << "Tracking applied from file \""<< initCsvFileName <<"\"" << std::endl;
+		if (initFileNum > fileNum) {
+			//the grains of the first file are the initial ones
+			return;
+		}
+	}
+	if (prevData == nullptr) {
+		return;
+	}
+	std::vector<GrainIDMapping> mappings;
+	std::vector<int> mappingFileNums;
+	if (!trackFile(fileNum, mappings, mappingFileNums)) {
+		return;
+	}
+	CSVTableWriter csvWriter(queue->outCsvFileName(fileNum));
+	mappings[0].print(&csvWriter);
+	csvWriter.write();
+	if (editCfgFiles) {
+		CFGEditor editor(queue->outCfgFileName(fileNum));
+		mappings[0].edit(&editor);
+		editor.close();
+	}
+}
+
+bool GrainTracker::initTracking(int firstFileNum, int & initFileNum, std::string & initCsvFileName) {
+	initFileNum = firstFileNum;
+	if( initGrainFileName != "") {
+		std::cout << "Initializing from grain data file \"" << initGrainFileName << "\" ." << std::endl;
+		initCsvFileName = initGrainFileName;
+		if (initPrevTimeStepDataFromCSVFile(initGrainFileName)){
+			grainNumberingBegin = prevData->maxGrainId() + 1 ;
+			return true;
+		}
+		std::cerr << "Failed to initialize from file \"" << initGrainFileName << "\" will continue with standard grain numbering."<< std::endl;
+	}
+
+	if(initPrevTimeStepDataFromCSVFile(queue->outCsvFileName(firstFileNum))){
+		initCsvFileName = queue->outCsvFileName(firstFileNum);
+		initFileNum = firstFileNum + 1;
+		grainNumberingBegin = prevData->getNumberOfGrains();
+		return true;
+	}
+	std::cerr << "Failed to initialize from file \"" << queue->outCsvFileName(firstFileNum) << "\" will continue with standard grain numbering."<< std::endl;
+	return false;
+}
+
+bool GrainTracker::trackFile(int fileNum, std::vector<GrainIDMapping> & mappings, std::vector<int> & mappingFileNums) {
+	//read in the csv file
+	CSVTableReader curReader  (queue->outCsvFileName(fileNum),csvFormat.getNumHeaderLines());
+	curReader.parse();
+	if(!csvFormat.isRightFormat(&curReader)){
+		std::cout << "Exiting \"" << queue->outCsvFileName(fileNum) << "\" has wrong format" << std::endl;
+		return false;
+	}
+	//init curData object
+	curData = new ContainerData();
+	if(!csvFormat.init(&curReader, curData)){
+		delete curData;
+		curData = nullptr;
+		return false;
+	}
+	mapping = new GrainIDMapper(*material,prevData, curData);
+	mapping->init(maxCosHalfMisOri,maxVolFrac, grainNumberingBegin);
+	mapping->map();
+	calculateGrainDataChangeToInitial();
+	//first construct copies of that mapping stuff in order to start a task independently
+	mappings.push_back(mapping);
+	mappingFileNums.push_back(fileNum);
+	grainNumberingBegin = mapping->getNewGrainId();
+	delete mapping;
+	mapping = nullptr;
+	//for the next timestep(file) make curData available as prevData
+	delete prevData;
+	prevData = curData;
+	//make curData able to be deleted again
+	curData = nullptr;
+	return true;
+}
+
 bool GrainTracker::initPrevTimeStepDataFromCSVFile(std::string inFileName) {
 	//create local reader object for parsing input file.
 	CSVTableReader startTable (inFileName, csvFormat.getNumHeaderLines());
@@ -35,7 +35,18 @@ public:
 	GrainTracker(OrientatorFileQueue * const inQueue, const CubicLattice * inMaterial, std::string inInitGrainFileName = "", bool inEditCfgFiles = true);
 	virtual ~GrainTracker();
 	void run();
+	//!\brief Tracks the grains of the file \c fileNum, which has just been computed, and writes the tracked ids into its output files.
+	//! The files are tracked one after another as they are computed, e.g. the frames of a stream.
+	//! The first call initializes the tracking by the initial grain file or by the file itself.
+	void advance(int fileNum);
 private:
+	//!\brief Initializes prevData by the initial grain file or else by the output of the file \c firstFileNum.
+	//!\param[out] initFileNum The first file to be tracked.
+	//!\return false if no grain data could be read.
+	bool initTracking(int firstFileNum, int & initFileNum, std::string & initCsvFileName);
+	//!\brief Maps the grains of the file \c fileNum to the ones of prevData, which are replaced by them afterwards.
+	//!\return false if the grain data of the file could not be read.
+	bool trackFile(int fileNum, std::vector<GrainIDMapping> & mappings, std::vector<int> & mappingFileNums);
 	//!\brief Calculates and saves the orientation and center change for each grain to the initial state
 	void calculateGrainDataChangeToInitial();
 	//!\brief Saves data for prevData from a csv file
@@ -55,6 +66,8 @@ private:
 	double maxCosHalfMisOri;
 	double maxVolFrac;
 	bool editCfgFiles = true;
+	//!whether the tracking has been initialized by advance()
+	bool isStarted = false;
 };
 
 #endif /* GRAINTRACKER_H_ */
@@ -0,0 +1,59 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MORTONORDER_H_
+#define MORTONORDER_H_
+#include <cstdint>
+
+//!\brief Morton order (Z-order curve) of the cells of a grid.
+//! The bits of the three cell coordinates are interleaved, so that cells close in space are mostly close in the order.
+//! Up to 2^21 cells per axis are supported, the codes fit into 63 bits.
+namespace morton {
+	//!\return The lower 21 bits of \c v, spread to every third bit.
+	inline uint64_t spreadBits(uint64_t v) {
+		v &= 0x1fffff;
+		v = (v | v << 32) & 0x1f00000000ffffULL;
+		v = (v | v << 16) & 0x1f0000ff0000ffULL;
+		v = (v | v << 8) & 0x100f00f00f00f00fULL;
+		v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+		v = (v | v << 2) & 0x1249249249249249ULL;
+		return v;
+	}
+	//!\return Every third bit of \c v, gathered into the lower 21 bits (inverse of \c spreadBits()).
+	inline uint64_t gatherBits(uint64_t v) {
+		v &= 0x1249249249249249ULL;
+		v = (v ^ (v >> 2)) & 0x10c30c30c30c30c3ULL;
+		v = (v ^ (v >> 4)) & 0x100f00f00f00f00fULL;
+		v = (v ^ (v >> 8)) & 0x1f0000ff0000ffULL;
+		v = (v ^ (v >> 16)) & 0x1f00000000ffffULL;
+		v = (v ^ (v >> 32)) & 0x1fffff;
+		return v;
+	}
+	//!\return The Morton code of the cell (ix, iy, iz).
+	inline uint64_t encode(uint64_t ix, uint64_t iy, uint64_t iz) {
+		return spreadBits(ix) | spreadBits(iy) << 1 | spreadBits(iz) << 2;
+	}
+	//!\brief Calculates the cell coordinates of a Morton code.
+	inline void decode(uint64_t code, long & ix, long & iy, long & iz) {
+		ix = gatherBits(code);
+		iy = gatherBits(code >> 1);
+		iz = gatherBits(code >> 2);
+	}
+}
+
+#endif /* MORTONORDER_H_ */
@@ -0,0 +1,148 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+//The kernels have to calculate bit-identical results on every instruction set,
+//hence a*a + b*b must not be contracted to a fused multiply-add.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+#include "NearestNeighborKernel.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define NNK_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace nnk {
+
+static void sqrLengthsScalar(const double * vx, const double * vy, const double * vz, long n, double * outSqrLengths) {
+	for (long i = 0; i < n; i++) {
+		outSqrLengths[i] = vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i];
+	}
+}
+
+#ifdef NNK_X86_DISPATCH
+__attribute__((target("avx2")))
+static void sqrLengthsAVX2(const double * vx, const double * vy, const double * vz, long n, double * outSqrLengths) {
+	long i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256d x = _mm256_loadu_pd(vx + i);
+		__m256d y = _mm256_loadu_pd(vy + i);
+		__m256d z = _mm256_loadu_pd(vz + i);
+		__m256d sum = _mm256_add_pd(_mm256_mul_pd(x, x), _mm256_mul_pd(y, y));
+		_mm256_storeu_pd(outSqrLengths + i, _mm256_add_pd(sum, _mm256_mul_pd(z, z)));
+	}
+	sqrLengthsScalar(vx + i, vy + i, vz + i, n - i, outSqrLengths + i);
+}
+
+__attribute__((target("avx512f")))
+static void sqrLengthsAVX512(const double * vx, const double * vy, const double * vz, long n, double * outSqrLengths) {
+	long i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m512d x = _mm512_loadu_pd(vx + i);
+		__m512d y = _mm512_loadu_pd(vy + i);
+		__m512d z = _mm512_loadu_pd(vz + i);
+		__m512d sum = _mm512_add_pd(_mm512_mul_pd(x, x), _mm512_mul_pd(y, y));
+		_mm512_storeu_pd(outSqrLengths + i, _mm512_add_pd(sum, _mm512_mul_pd(z, z)));
+	}
+	sqrLengthsScalar(vx + i, vy + i, vz + i, n - i, outSqrLengths + i);
+}
+#endif
+
+typedef void (*SqrLengthsFunction)(const double *, const double *, const double *, long, double *);
+
+static SqrLengthsFunction functionOf(InstructionSet set) {
+#ifdef NNK_X86_DISPATCH
+	switch (set) {
+	case avx512Set:
+		return sqrLengthsAVX512;
+	case avx2Set:
+		return sqrLengthsAVX2;
+	default:
+		break;
+	}
+#endif
+	return sqrLengthsScalar;
+}
+
+bool isSupported(InstructionSet set) {
+	switch (set) {
+#ifdef NNK_X86_DISPATCH
+	case avx512Set:
+		return __builtin_cpu_supports("avx512f");
+	case avx2Set:
+		return __builtin_cpu_supports("avx2");
+	case sse2Set:
+		return __builtin_cpu_supports("sse2");
+#endif
+	case scalarSet:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static InstructionSet bestInstructionSet() {
+	if (isSupported(avx512Set)) return avx512Set;
+	if (isSupported(avx2Set)) return avx2Set;
+	return scalarSet;
+}
+
+//chosen once on first use (thread-safe initialization of static locals)
+static InstructionSet & currentInstructionSet() {
+	static InstructionSet set = bestInstructionSet();
+	return set;
+}
+
+static SqrLengthsFunction & currentFunction() {
+	static SqrLengthsFunction function = functionOf(currentInstructionSet());
+	return function;
+}
+
+void sqrLengths(const double * vx, const double * vy, const double * vz, long n, double * outSqrLengths) {
+	currentFunction()(vx, vy, vz, n, outSqrLengths);
+}
+
+InstructionSet getInstructionSet() {
+	return currentInstructionSet();
+}
+
+bool setInstructionSet(InstructionSet set) {
+	if (!isSupported(set)) {
+		return false;
+	}
+	currentInstructionSet() = set;
+	currentFunction() = functionOf(set);
+	return true;
+}
+
+const char * instructionSetName(InstructionSet set) {
+	switch (set) {
+	case avx512Set:
+		return "AVX-512";
+	case avx2Set:
+		return "AVX2";
+	case sse2Set:
+		return "SSE2";
+	default:
+		return "scalar";
+	}
+}
+
+}
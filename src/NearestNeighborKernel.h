@@ -0,0 +1,131 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NEARESTNEIGHBORKERNEL_H_
+#define NEARESTNEIGHBORKERNEL_H_
+#include <cmath>
+#include "GradeA_Defs.h"
+
+//!maximum number of neighbors a NearestNeighborSelection can hold
+#define NN_MAXSELECTION 24
+//!number of candidates whose distances are calculated at once
+#define NN_CHUNKSIZE 128
+
+//!\brief Vectorized kernels for the nearest-neighbor search.
+//! The instruction set (AVX-512, AVX2 or scalar) is chosen once at runtime depending on the cpu.
+//! All implementations calculate exactly the same values.
+//! The enumeration of the instruction sets is shared with the other kernels (e.g. \c ork), \c sqrLengths() runs the scalar code for \c sse2Set.
+namespace nnk {
+	enum InstructionSet {scalarSet, sse2Set, avx2Set, avx512Set};
+	//!\brief Calculates the squared lengths of \c n vectors given by their separate coordinate arrays.
+	void sqrLengths(const double * vx, const double * vy, const double * vz, long n, double * outSqrLengths);
+	//!\return The instruction set used by \c sqrLengths().
+	InstructionSet getInstructionSet();
+	//!\brief Forces an instruction set, e.g. for benchmarks.
+	//!\return false if the cpu does not support \c set, the instruction set is not changed in that case.
+	bool setInstructionSet(InstructionSet set);
+	//!\return Whether the cpu supports \c set.
+	bool isSupported(InstructionSet set);
+	//!\return The name of an instruction set.
+	const char * instructionSetName(InstructionSet set);
+}
+
+//!\brief Bounded list of the \c k closest candidates, sorted by ascending squared distance.
+//! Candidates with equal distance keep the order they were inserted in.
+template <typename Payload>
+class NearestNeighborSelection {
+public:
+	NearestNeighborSelection(unsigned char inK) : k(inK > NN_MAXSELECTION ? NN_MAXSELECTION : inK) {};
+	//!\return Squared distance a candidate must fall below to be inserted.
+	double bound() const { return n < k ? INFINITY : sqrDists[n - 1];};
+	//!\brief Inserts a candidate if it is closer than the current \c k-th candidate.
+	inline void insert(double sqrDist, double vx, double vy, double vz, const Payload & payload);
+	unsigned char size() const { return n;};
+	double getSqrDist(unsigned char i) const { return sqrDists[i];};
+	const double * getVect(unsigned char i) const { return vects + DIM * i;};
+	const Payload & getPayload(unsigned char i) const { return payloads[i];};
+private:
+	unsigned char k;
+	unsigned char n = 0;
+	double sqrDists[NN_MAXSELECTION];
+	double vects[NN_MAXSELECTION * DIM];
+	Payload payloads[NN_MAXSELECTION];
+};
+
+//!\brief Buffer of neighbor candidates (vectors from the center atom), whose distances are calculated chunk-wise by the vectorized kernel.
+template <typename Payload>
+class NeighborCandidateChunk {
+public:
+	//!\brief Adds a candidate, the chunk has to be processed if \c isFull() afterwards.
+	void add(double vx, double vy, double vz, const Payload & payload) {
+		x[n] = vx; y[n] = vy; z[n] = vz;
+		payloads[n++] = payload;
+	}
+	bool isFull() const { return n == NN_CHUNKSIZE;};
+	long size() const { return n;};
+	//!\brief Calculates the squared distances of all buffered candidates.
+	void calcSqrDists() { nnk::sqrLengths(x, y, z, n, sqrDists);};
+	double getSqrDist(long i) const { return sqrDists[i];};
+	const Payload & getPayload(long i) const { return payloads[i];};
+	Payload & getPayload(long i) { return payloads[i];};
+	//!\brief Inserts all buffered candidates into \c selection and empties the chunk.
+	void flush(NearestNeighborSelection<Payload> & selection) {
+		calcSqrDists();
+		insertInto(selection);
+		clear();
+	}
+	//!\brief Inserts all buffered candidates with calculated distances into \c selection.
+	void insertInto(NearestNeighborSelection<Payload> & selection) const {
+		for (long i = 0; i < n; i++) {
+			if (sqrDists[i] < selection.bound()) {
+				selection.insert(sqrDists[i], x[i], y[i], z[i], payloads[i]);
+			}
+		}
+	}
+	void clear() { n = 0;};
+private:
+	long n = 0;
+	double x[NN_CHUNKSIZE];
+	double y[NN_CHUNKSIZE];
+	double z[NN_CHUNKSIZE];
+	double sqrDists[NN_CHUNKSIZE];
+	Payload payloads[NN_CHUNKSIZE];
+};
+
+template <typename Payload>
+void NearestNeighborSelection<Payload>::insert(double sqrDist, double vx, double vy, double vz, const Payload & payload) {
+	if (k == 0 || sqrDist >= bound()) {
+		return;
+	}
+	unsigned char pos = n < k ? n++ : n - 1;
+	//shift the farther candidates back, equal distances stay in front
+	while (pos > 0 && sqrDists[pos - 1] > sqrDist) {
+		sqrDists[pos] = sqrDists[pos - 1];
+		vects[DIM * pos] = vects[DIM * (pos - 1)];
+		vects[DIM * pos + 1] = vects[DIM * (pos - 1) + 1];
+		vects[DIM * pos + 2] = vects[DIM * (pos - 1) + 2];
+		payloads[pos] = payloads[pos - 1];
+		pos--;
+	}
+	sqrDists[pos] = sqrDist;
+	vects[DIM * pos] = vx;
+	vects[DIM * pos + 1] = vy;
+	vects[DIM * pos + 2] = vz;
+	payloads[pos] = payload;
+}
+
+#endif /* NEARESTNEIGHBORKERNEL_H_ */
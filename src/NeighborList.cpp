@@ -0,0 +1,257 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "NeighborList.h"
+
+NeighborList::NeighborList() {
+}
+
+NeighborList::~NeighborList() {
+}
+
+void NeighborList::build(AtomBox * inBoxes, long inNumBoxes, double rSqrMin, double rSqrMax, const CellList * inCells, const GhostHalo * inHalo) {
+	boxes = inBoxes;
+	cells = inCells;
+	halo = inHalo;
+	numBoxes = inNumBoxes;
+	boxOffsets.assign(numBoxes + 1, 0);
+	for (long iB = 0; iB < numBoxes; iB++) {
+		boxOffsets[iB + 1] = boxOffsets[iB] + boxes[iB].getNumAtoms();
+	}
+	numAtoms = boxOffsets[numBoxes];
+	//the row length usually only depends on the number of atoms in the box neighborhood
+	std::vector<long> rowLengths(numAtoms);
+	for (long iB = 0; iB < numBoxes; iB++) {
+		AtomBox * box = boxes + iB;
+		long numCandidates = box->getNumAtoms() - 1;
+		for (long iN = 0; iN < box->getNumNeighbors(); iN++) {
+			numCandidates += box->getNeighbors()[iN].box->getNumAtoms();
+		}
+		if (numCandidates > NEIGHBORLIST_MAXNEIGHBORS) numCandidates = NEIGHBORLIST_MAXNEIGHBORS;
+		for (long atomNum = boxOffsets[iB]; atomNum < boxOffsets[iB + 1]; atomNum++) {
+			rowLengths[atomNum] = numCandidates;
+		}
+	}
+	shellRanks.clear();
+	firstShellNeighbors.resize(numAtoms);
+	numShellNeighbors.resize(numAtoms);
+	//a second pass is only needed, if atoms closer than the shell push shell atoms out of the rows
+	bool rowsTooShort = true;
+	for (int pass = 0; pass < 2 && rowsTooShort; pass++) {
+		offsets.assign(numAtoms + 1, 0);
+		for (long atomNum = 0; atomNum < numAtoms; atomNum++) {
+			offsets[atomNum + 1] = offsets[atomNum] + rowLengths[atomNum];
+		}
+		neighbors.resize(offsets[numAtoms]);
+		neighborVectors.resize(DIM * offsets[numAtoms]);
+		shellRanks.resize(offsets[numAtoms]);
+		rowsTooShort = false;
+#pragma omp parallel for schedule(dynamic,16) reduction(||:rowsTooShort)
+		for (long iB = 0; iB < numBoxes; iB++) {
+			for (long iA = 0; iA < boxes[iB].getNumAtoms(); iA++) {
+				long atomNum = boxOffsets[iB] + iA;
+				long rowLength = collectNeighbors(iB, iA, rSqrMin, rSqrMax);
+				if (rowLength > rowLengths[atomNum]) {
+					rowsTooShort = true;
+				}
+				rowLengths[atomNum] = rowLength;
+			}
+		}
+	}
+	cells = nullptr;
+	halo = nullptr;
+	built = true;
+}
+
+void NeighborList::clear() {
+	built = false;
+	numAtoms = 0;
+	std::vector<long>().swap(boxOffsets);
+	std::vector<long>().swap(offsets);
+	std::vector<long>().swap(neighbors);
+	std::vector<double>().swap(neighborVectors);
+	std::vector<unsigned char>().swap(shellRanks);
+	std::vector<unsigned char>().swap(firstShellNeighbors);
+	std::vector<unsigned char>().swap(numShellNeighbors);
+}
+
+void NeighborList::reset() {
+	built = false;
+	numAtoms = 0;
+}
+
+//!\brief Counts the inner and shell atoms among the candidates and inserts them into the selection.
+void NeighborList::selectCandidates(NeighborCandidateChunk<NeighborCandidate> & candidates, NearestNeighborSelection<NeighborCandidate> & selection,
+		double rSqrMin, double rSqrMax, long & nInner, long & nShell) const {
+	candidates.calcSqrDists();
+	double sqrDistance;
+	for (long i = 0; i < candidates.size(); i++) {
+		sqrDistance = candidates.getSqrDist(i);
+		unsigned char & shellRank = candidates.getPayload(i).shellRank;
+		shellRank = NEIGHBORLIST_NOSHELL;
+		if (sqrDistance <= rSqrMin) {
+			nInner++;
+		} else if (sqrDistance < rSqrMax) {
+			if (nShell < NEIGHBORLIST_MAXNEIGHBORS) {
+				shellRank = nShell;
+			}
+			nShell++;
+		}
+	}
+	candidates.insertInto(selection);
+	candidates.clear();
+}
+
+//!\brief Searches the nearest neighbors of an atom and writes them into its row, if the row is long enough.
+//!\return The needed row length.
+long NeighborList::collectNeighbors(long iB, long iA, double rSqrMin, double rSqrMax) {
+	AtomBox * box = boxes + iB;
+	const double * size = box->getSize();
+	double atomPos[DIM];
+	box->getAtomPos(iA, atomPos);
+	long atomNum = boxOffsets[iB] + iA;
+	//the sorted columns of the cell list are scanned contiguously, if available
+	const posType * posX = cells ? cells->getPosX() : nullptr;
+	const posType * posY = cells ? cells->getPosY() : nullptr;
+	const posType * posZ = cells ? cells->getPosZ() : nullptr;
+	NeighborCandidateChunk<NeighborCandidate> candidates;
+	NearestNeighborSelection<NeighborCandidate> selection(NEIGHBORLIST_MAXROWLENGTH);
+	NeighborCandidate candidate;
+	long nCandidates = 0;
+	long nInner = 0;
+	long nShell = 0;
+	//own box first, then the neighbor boxes (same order as AtomBox::atomNeighbors)
+	if (halo) {
+		//the ghost halo holds the positions of the whole box neighborhood in the frame of the container, its cells are read without shifts
+		const double * haloX = halo->getPosX();
+		const double * haloY = halo->getPosY();
+		const double * haloZ = halo->getPosZ();
+		double x = haloX[atomNum], y = haloY[atomNum], z = haloZ[atomNum];
+		for (long iNB = -1; iNB < box->getNumNeighbors(); iNB++) {
+			long cell = iNB < 0 ? iB : halo->getNeighborCell(iB, iNB);
+			for (long iE = halo->getCellBegin(cell); iE < halo->getCellEnd(cell); iE++) {
+				if (iE == atomNum) {
+					continue;
+				}
+				nCandidates++;
+				candidate.atomNum = halo->getAtomNum(iE);
+				candidates.add(haloX[iE] - x, haloY[iE] - y, haloZ[iE] - z, candidate);
+				if (candidates.isFull()) {
+					selectCandidates(candidates, selection, rSqrMin, rSqrMax, nInner, nShell);
+				}
+			}
+		}
+	} else {
+		double relAtomPos[DIM];
+		AtomBox * nborBox;
+		long nborBoxOffset;
+		double nborAtomPos[DIM];
+		for (long iNB = -1; iNB < box->getNumNeighbors(); iNB++) {
+			if (iNB < 0) {
+				nborBox = box;
+				relAtomPos[0] = atomPos[0];
+				relAtomPos[1] = atomPos[1];
+				relAtomPos[2] = atomPos[2];
+			} else {
+				const ABoxNeighbor & boxNbor = box->getNeighbors()[iNB];
+				nborBox = boxNbor.box;
+				relAtomPos[0] = atomPos[0] - boxNbor.coord[0] * size[0];
+				relAtomPos[1] = atomPos[1] - boxNbor.coord[1] * size[1];
+				relAtomPos[2] = atomPos[2] - boxNbor.coord[2] * size[2];
+			}
+			nborBoxOffset = boxOffsets[nborBox - boxes];
+			for (long iNA = 0; iNA < nborBox->getNumAtoms(); iNA++) {
+				if (iNB < 0 && iNA == iA) {
+					continue;
+				}
+				nCandidates++;
+				candidate.atomNum = nborBoxOffset + iNA;
+				if (cells) {
+					candidates.add(posX[candidate.atomNum] - relAtomPos[0], posY[candidate.atomNum] - relAtomPos[1], posZ[candidate.atomNum] - relAtomPos[2], candidate);
+				} else {
+					nborBox->getAtomPos(iNA, nborAtomPos);
+					candidates.add(nborAtomPos[0] - relAtomPos[0], nborAtomPos[1] - relAtomPos[1], nborAtomPos[2] - relAtomPos[2], candidate);
+				}
+				if (candidates.isFull()) {
+					selectCandidates(candidates, selection, rSqrMin, rSqrMax, nInner, nShell);
+				}
+			}
+		}
+	}
+	selectCandidates(candidates, selection, rSqrMin, rSqrMax, nInner, nShell);
+	long rowLength = nCandidates < NEIGHBORLIST_MAXNEIGHBORS ? nCandidates : NEIGHBORLIST_MAXNEIGHBORS;
+	//the shell neighbors follow the inner atoms in the sorted row
+	if (nShell > NEIGHBORLIST_MAXNEIGHBORS || nInner + nShell > NEIGHBORLIST_MAXROWLENGTH) {
+		firstShellNeighbors[atomNum] = 0;
+		numShellNeighbors[atomNum] = NEIGHBORLIST_NOSHELL;
+	} else {
+		firstShellNeighbors[atomNum] = nInner;
+		numShellNeighbors[atomNum] = nShell;
+		if (nInner + nShell > rowLength) rowLength = nInner + nShell;
+	}
+	if (rowLength > offsets[atomNum + 1] - offsets[atomNum]) {
+		return rowLength;
+	}
+	long * outNbors = neighbors.data() + offsets[atomNum];
+	double * outVects = neighborVectors.data() + DIM * offsets[atomNum];
+	unsigned char * outShellRanks = shellRanks.data() + offsets[atomNum];
+	const double * vect;
+	for (long iE = 0; iE < rowLength; iE++) {
+		outNbors[iE] = selection.getPayload(iE).atomNum;
+		outShellRanks[iE] = selection.getPayload(iE).shellRank;
+		vect = selection.getVect(iE);
+		outVects[DIM * iE] = vect[0];
+		outVects[DIM * iE + 1] = vect[1];
+		outVects[DIM * iE + 2] = vect[2];
+	}
+	return rowLength;
+}
+
+AtomID NeighborList::getAtomId(long atomNum) const {
+	AtomID atomId;
+	atomId.iB = std::upper_bound(boxOffsets.begin(), boxOffsets.end(), atomNum) - boxOffsets.begin() - 1;
+	atomId.iA = atomNum - boxOffsets[atomId.iB];
+	return atomId;
+}
+
+Atom * NeighborList::getAtom(long atomNum) const {
+	AtomID atomId = getAtomId(atomNum);
+	return boxes[atomId.iB].getAtom(atomId.iA);
+}
+
+unsigned char NeighborList::getNumNeighbors(long atomNum, unsigned char nMaxAtomNeighbors) const {
+	long rowLength = offsets[atomNum + 1] - offsets[atomNum];
+	return rowLength < nMaxAtomNeighbors ? rowLength : nMaxAtomNeighbors;
+}
+
+unsigned char NeighborList::getShellNeighbors(long atomNum, unsigned char nMaxAtomNeighbors, long * outNbors, double * outNborVects) const {
+	unsigned char nShell = numShellNeighbors[atomNum];
+	if (nShell > nMaxAtomNeighbors) {
+		return 0;
+	}
+	long iE = offsets[atomNum] + firstShellNeighbors[atomNum];
+	for (unsigned char iN = 0; iN < nShell; iN++, iE++) {
+		unsigned char rank = shellRanks[iE];
+		outNbors[rank] = neighbors[iE];
+		if (outNborVects) {
+			outNborVects[DIM * rank] = neighborVectors[DIM * iE];
+			outNborVects[DIM * rank + 1] = neighborVectors[DIM * iE + 1];
+			outNborVects[DIM * rank + 2] = neighborVectors[DIM * iE + 2];
+		}
+	}
+	return nShell;
+}
@@ -0,0 +1,120 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NEIGHBORLIST_H_
+#define NEIGHBORLIST_H_
+#include "GradeA_Defs.h"
+#include "AtomBox.h"
+#include "NearestNeighborKernel.h"
+#include "CellList.h"
+#include "GhostHalo.h"
+
+//!number of nearest neighbors stored for each atom
+#define NEIGHBORLIST_MAXNEIGHBORS 12
+//!maximum row length, if atoms closer than the neighbor shell push shell atoms out of the nearest neighbors
+#define NEIGHBORLIST_MAXROWLENGTH 24
+#define NEIGHBORLIST_NOSHELL 255
+
+//!\brief Neighbor candidate used while building the neighbor list.
+struct NeighborCandidate {
+	long atomNum;
+	unsigned char shellRank;
+};
+
+//!\brief Nearest-neighbor list of all atoms of a container, built once per frame.
+//! The atoms are numbered box by box (atom number = number of atoms in the preceding boxes + atom id inside the box).
+//! For each atom the \c NEIGHBORLIST_MAXNEIGHBORS nearest atoms of the box neighborhood are stored sorted by distance in compressed rows (CSR),
+//! together with the vectors pointing to them. The neighbors inside the spherical shell defined by the search radii are a part of each row,
+//! their order of \c AtomBox::atomNeighbors() is stored as well.
+//! Thus the same list serves the orientation calculation, the grain identification (shell neighbors) and the orphan atom adoption (nearest neighbors).
+class NeighborList {
+public:
+	NeighborList();
+	virtual ~NeighborList();
+
+	//!\brief Builds the list for all atoms in parallel.
+	//!\param[in] inBoxes Box list of the container. Must stay valid as long as the list is used.
+	//!\param[in] inNumBoxes Number of boxes.
+	//!\param[in] rSqrMin Minimum squared radius of the neighbor shell.
+	//!\param[in] rSqrMax Maximum squared radius of the neighbor shell.
+	//!\param[in] inCells Positions of the atoms of all boxes sorted by box, which are read instead of the atoms of the boxes if given.
+	//! Must stay valid during the build.
+	//!\param[in] inHalo Ghost halo of the boxes, which is read instead of the cell list if given. Must stay valid during the build.
+	void build(AtomBox * inBoxes, long inNumBoxes, double rSqrMin, double rSqrMax, const CellList * inCells = nullptr, const GhostHalo * inHalo = nullptr);
+
+	//!\brief Frees the memory of the list.
+	void clear();
+
+	//!\brief Marks the list as not built, but keeps its memory for the next \c build().
+	void reset();
+
+	//!\return Whether the list has been built.
+	bool isBuilt() const { return built;};
+
+	//!\return The number of atoms in the list.
+	long getNumAtoms() const { return numAtoms;};
+
+	//!\return The number of an atom identified by its box and the atom id inside the box.
+	long getAtomNum(const AtomBox * box, long atomId) const { return boxOffsets[box - boxes] + atomId;};
+
+	//!\return The box and the atom id inside the box to an atom number.
+	AtomID getAtomId(long atomNum) const;
+
+	//!\return The box with the number \c iB.
+	AtomBox * getBox(long iB) const { return boxes + iB;};
+
+	//!\return The atom to an atom number.
+	Atom * getAtom(long atomNum) const;
+
+	//!\return The number of nearest neighbors of an atom, at most \c nMaxAtomNeighbors
+	//! (equal to the result of \c AtomBox::nearestAtomNeighbors()).
+	unsigned char getNumNeighbors(long atomNum, unsigned char nMaxAtomNeighbors = NEIGHBORLIST_MAXNEIGHBORS) const;
+
+	//!\return The atom numbers of the nearest neighbors of an atom, sorted by distance.
+	const long * getNeighbors(long atomNum) const { return neighbors.data() + offsets[atomNum];};
+
+	//!\return The vectors from an atom to its nearest neighbors, sorted by distance. 3 elements for each neighbor.
+	const double * getNeighborVectors(long atomNum) const { return neighborVectors.data() + DIM * offsets[atomNum];};
+
+	//!\brief Obtains the neighbors inside the shell in the same order as \c AtomBox::atomNeighbors().
+	//!\param[out] outNbors Atom numbers of the neighbors. At least \c nMaxAtomNeighbors elements must be accessible.
+	//!\param[out] outNborVects Vectors to the neighbors, may be \c nullptr. At least 3*\c nMaxAtomNeighbors elements must be accessible.
+	//!\return The number of neighbors inside the shell, 0 if more than \c nMaxAtomNeighbors were found.
+	unsigned char getShellNeighbors(long atomNum, unsigned char nMaxAtomNeighbors, long * outNbors, double * outNborVects = nullptr) const;
+private:
+	long collectNeighbors(long iB, long iA, double rSqrMin, double rSqrMax);
+	inline void selectCandidates(NeighborCandidateChunk<NeighborCandidate> & candidates, NearestNeighborSelection<NeighborCandidate> & selection,
+			double rSqrMin, double rSqrMax, long & nInner, long & nShell) const;
+	AtomBox * boxes = nullptr;
+	const CellList * cells = nullptr;
+	const GhostHalo * halo = nullptr;
+	long numBoxes = 0;
+	long numAtoms = 0;
+	bool built = false;
+	std::vector<long> boxOffsets;
+	std::vector<long> offsets;
+	std::vector<long> neighbors;
+	std::vector<double> neighborVectors;
+	//!position of each neighbor among the shell neighbors in the order of the box search, NEIGHBORLIST_NOSHELL if outside the shell
+	std::vector<unsigned char> shellRanks;
+	//!row index of the first shell neighbor of each atom
+	std::vector<unsigned char> firstShellNeighbors;
+	//!number of shell neighbors of each atom, NEIGHBORLIST_NOSHELL if the shell contains too many atoms
+	std::vector<unsigned char> numShellNeighbors;
+};
+
+#endif /* NEIGHBORLIST_H_ */
@@ -0,0 +1,88 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "OrientationKernel.h"
+
+namespace ork {
+
+static long fccQuaternionsScalar(const Orientator & orient, const double * const * nborVects, const unsigned char * nNeighbors, long nAtoms,
+		double * outQuats, bool * outValid, QuaternionTierCounter * tierCounter) {
+	long nValid = 0;
+	for (long iA = 0; iA < nAtoms; iA++) {
+		outValid[iA] = orient.fccQuaternion(nborVects[iA], nNeighbors[iA], outQuats + 4 * iA, tierCounter);
+		if (outValid[iA]) nValid++;
+	}
+	return nValid;
+}
+
+typedef long (*FccQuaternionsFunction)(const Orientator &, const double * const *, const unsigned char *, long, double *, bool *, QuaternionTierCounter *);
+
+static FccQuaternionsFunction functionOf(nnk::InstructionSet set) {
+#ifdef ORK_X86_DISPATCH
+	switch (set) {
+	case nnk::avx512Set:
+		return fccQuaternionsAVX512;
+	case nnk::avx2Set:
+		return fccQuaternionsAVX2;
+	case nnk::sse2Set:
+		return fccQuaternionsSSE2;
+	default:
+		break;
+	}
+#endif
+	return fccQuaternionsScalar;
+}
+
+//The pipeline is bound by the divisions, which have to stay divisions for bit-identical results.
+//With 2 lanes SSE2 does not beat the scalar code and is therefore only used if set explicitly.
+static nnk::InstructionSet bestInstructionSet() {
+	if (nnk::isSupported(nnk::avx512Set)) return nnk::avx512Set;
+	if (nnk::isSupported(nnk::avx2Set)) return nnk::avx2Set;
+	return nnk::scalarSet;
+}
+
+//chosen once on first use (thread-safe initialization of static locals)
+static nnk::InstructionSet & currentInstructionSet() {
+	static nnk::InstructionSet set = bestInstructionSet();
+	return set;
+}
+
+static FccQuaternionsFunction & currentFunction() {
+	static FccQuaternionsFunction function = functionOf(currentInstructionSet());
+	return function;
+}
+
+long fccQuaternions(const Orientator & orient, const double * const * nborVects, const unsigned char * nNeighbors, long nAtoms,
+		double * outQuats, bool * outValid, QuaternionTierCounter * tierCounter) {
+	return currentFunction()(orient, nborVects, nNeighbors, nAtoms, outQuats, outValid, tierCounter);
+}
+
+nnk::InstructionSet getInstructionSet() {
+	return currentInstructionSet();
+}
+
+bool setInstructionSet(nnk::InstructionSet set) {
+	if (!nnk::isSupported(set)) {
+		return false;
+	}
+	currentInstructionSet() = set;
+	currentFunction() = functionOf(set);
+	return true;
+}
+
+}
@@ -0,0 +1,65 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ORIENTATIONKERNEL_H_
+#define ORIENTATIONKERNEL_H_
+#include "Orientator.h"
+#include "NearestNeighborKernel.h"
+
+//!number of atoms whose neighbor vectors are gathered before they are passed to the kernel at once
+#define ORK_CHUNKSIZE 256
+//!maximum number of atoms processed by one vector (8 for AVX-512)
+#define ORK_MAXLANES 8
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define ORK_X86_DISPATCH
+#endif
+
+//!\brief Batched calculation of the fcc orientations of many atoms.
+//! Each lane of a SIMD vector processes one atom through the whole pipeline (unit vectors, antiparallel pairs, <100> directions,
+//! quaternion extraction and cubic reduction). The instruction set (AVX-512, AVX2 or scalar) is chosen once at runtime depending on the cpu,
+//! SSE2 can be set explicitly.
+//! The results are bit-identical to \c Orientator::fccQuaternion(), to which the few atoms needing the eigen solver are passed.
+namespace ork {
+	//!\brief Calculates the unique cubic quaternions of \c nAtoms atoms like \c Orientator::fccQuaternion().
+	//!\param[in] nborVects The vectors to the nearest neighbors of each atom, 3 elements for each neighbor.
+	//!\param[in] nNeighbors The number of neighbors of each atom.
+	//!\param[out] outQuats The quaternions, 4 elements for each atom.
+	//!\param[out] outValid Whether an orientation could be determined for the atom.
+	//!\param[in,out] tierCounter Counts the method used for the quaternion extraction, may be \c nullptr.
+	//!\return The number of valid orientations.
+	long fccQuaternions(const Orientator & orient, const double * const * nborVects, const unsigned char * nNeighbors, long nAtoms,
+			double * outQuats, bool * outValid, QuaternionTierCounter * tierCounter = nullptr);
+	//!\return The instruction set used by \c fccQuaternions().
+	nnk::InstructionSet getInstructionSet();
+	//!\brief Forces an instruction set, e.g. for benchmarks.
+	//!\return false if the cpu does not support \c set, the instruction set is not changed in that case.
+	bool setInstructionSet(nnk::InstructionSet set);
+
+#ifdef ORK_X86_DISPATCH
+	//instruction set specific implementations of fccQuaternions(), only to be called if the cpu supports them
+	long fccQuaternionsSSE2(const Orientator & orient, const double * const * nborVects, const unsigned char * nNeighbors, long nAtoms,
+			double * outQuats, bool * outValid, QuaternionTierCounter * tierCounter);
+	long fccQuaternionsAVX2(const Orientator & orient, const double * const * nborVects, const unsigned char * nNeighbors, long nAtoms,
+			double * outQuats, bool * outValid, QuaternionTierCounter * tierCounter);
+	long fccQuaternionsAVX512(const Orientator & orient, const double * const * nborVects, const unsigned char * nNeighbors, long nAtoms,
+			double * outQuats, bool * outValid, QuaternionTierCounter * tierCounter);
+#endif
+}
+
+#endif /* ORIENTATIONKERNEL_H_ */
@@ -0,0 +1,78 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "OrientationKernel.h"
+
+#ifdef ORK_X86_DISPATCH
+#include <immintrin.h>
+//Everything below is compiled for AVX-512, the kernels have to round exactly like the scalar code,
+//hence products must not be contracted to fused multiply-adds.
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#pragma STDC FP_CONTRACT OFF
+#else
+#pragma GCC push_options
+#pragma GCC target ("avx512f")
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+namespace {
+//!\brief 8 lanes of AVX-512, the lane masks are mask registers.
+struct AVX512Vector {
+	typedef __m512d D;
+	typedef __mmask8 M;
+	static const int width = 8;
+	static inline D zero() { return _mm512_setzero_pd();}
+	static inline D set1(double a) { return _mm512_set1_pd(a);}
+	static inline D load(const double * a) { return _mm512_loadu_pd(a);}
+	static inline void store(double * a, D v) { _mm512_storeu_pd(a, v);}
+	static inline D add(D a, D b) { return _mm512_add_pd(a, b);}
+	static inline D sub(D a, D b) { return _mm512_sub_pd(a, b);}
+	static inline D mul(D a, D b) { return _mm512_mul_pd(a, b);}
+	static inline D div(D a, D b) { return _mm512_div_pd(a, b);}
+	static inline D sqrt(D a) { return _mm512_sqrt_pd(a);}
+	static inline D abs(D a) { return _mm512_castsi512_pd(_mm512_andnot_si512(_mm512_castpd_si512(_mm512_set1_pd(-0.)), _mm512_castpd_si512(a)));}
+	static inline D neg(D a) { return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(_mm512_set1_pd(-0.)), _mm512_castpd_si512(a)));}
+	static inline M lt(D a, D b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ);}
+	static inline M le(D a, D b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ);}
+	static inline M gt(D a, D b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ);}
+	static inline M ge(D a, D b) { return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ);}
+	static inline M eq(D a, D b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ);}
+	static inline M none() { return 0;}
+	static inline M mand(M a, M b) { return a & b;}
+	static inline M mor(M a, M b) { return a | b;}
+	static inline M mnot(M a) { return static_cast<M>(~a);}
+	//!\return \c a in the lanes set in \c m, \c b otherwise
+	static inline D select(M m, D a, D b) { return _mm512_mask_blend_pd(m, b, a);}
+	static inline int bits(M m) { return m;}
+};
+}
+
+#include "OrientationKernelBatch.h"
+
+long ork::fccQuaternionsAVX512(const Orientator & orient, const double * const * nborVects, const unsigned char * nNeighbors, long nAtoms,
+		double * outQuats, bool * outValid, QuaternionTierCounter * tierCounter) {
+	return fccQuaternionsBatch<AVX512Vector>(orient, nborVects, nNeighbors, nAtoms, outQuats, outValid, tierCounter);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
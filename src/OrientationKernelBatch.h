@@ -0,0 +1,341 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Generic implementation of the batched fcc orientation pipeline of OrientationKernel.h.
+//This header is included by the instruction set specific translation units after all other headers,
+//inside the region compiled for the instruction set. It must not include any header itself.
+//The vector type V provides the double vector D, the lane mask M and the operations used below,
+//every operation has to round exactly like the scalar code (no fused multiply-add).
+#ifndef ORIENTATIONKERNELBATCH_H_
+#define ORIENTATIONKERNELBATCH_H_
+
+namespace ork {
+
+//!\brief Coefficients (+1, -1 or 0) of a sum of quaternion components in the order of \c ori::uniqueCubicRotationQuaternion().
+struct CubicCandidate {
+	//!factor of the absolute value of the selecting sum
+	double scale;
+	//!selecting sum, its sign is the sign of the cubic equivalent
+	signed char selection[4];
+	//!sums of the components 1-3 of the cubic equivalent
+	signed char components[3][4];
+};
+
+//!the 24 rotations of the cubic symmetry, in the order of ori::uniqueCubicRotationQuaternion()
+static const CubicCandidate cubicCandidates[24] = {
+	{1., {1,0,0,0}, {{0,1,0,0}, {0,0,1,0}, {0,0,0,1}}},
+	{1., {0,-1,0,0}, {{1,0,0,0}, {0,0,0,1}, {0,0,-1,0}}},
+	{1., {0,0,-1,0}, {{0,0,0,-1}, {1,0,0,0}, {0,1,0,0}}},
+	{1., {0,0,0,-1}, {{0,0,1,0}, {0,-1,0,0}, {1,0,0,0}}},
+	{.5, {1,-1,-1,-1}, {{1,1,1,-1}, {1,-1,1,1}, {1,1,-1,1}}},
+	{.5, {1,1,1,1}, {{-1,1,-1,1}, {-1,1,1,-1}, {-1,-1,1,1}}},
+	{.5, {1,-1,1,-1}, {{1,1,1,1}, {-1,-1,1,1}, {1,-1,-1,1}}},
+	{.5, {1,1,-1,1}, {{-1,1,-1,-1}, {1,1,1,-1}, {-1,1,1,1}}},
+	{.5, {1,1,-1,-1}, {{-1,1,1,-1}, {1,-1,1,-1}, {1,1,1,1}}},
+	{.5, {1,-1,1,1}, {{1,1,-1,1}, {-1,1,1,1}, {-1,-1,-1,1}}},
+	{.5, {1,1,1,-1}, {{-1,1,1,1}, {-1,-1,1,-1}, {1,-1,1,1}}},
+	{.5, {1,-1,-1,1}, {{1,1,-1,-1}, {1,1,1,1}, {-1,1,-1,1}}},
+	{HALFSQRT2, {1,-1,0,0}, {{1,1,0,0}, {0,0,1,1}, {0,0,-1,1}}},
+	{HALFSQRT2, {1,0,-1,0}, {{0,1,0,-1}, {1,0,1,0}, {0,1,0,1}}},
+	{HALFSQRT2, {1,0,0,-1}, {{0,1,1,0}, {0,-1,1,0}, {1,0,0,1}}},
+	{HALFSQRT2, {0,-1,-1,0}, {{1,0,0,-1}, {1,0,0,1}, {0,1,-1,0}}},
+	{HALFSQRT2, {0,0,-1,-1}, {{0,0,1,-1}, {1,-1,0,0}, {1,1,0,0}}},
+	{HALFSQRT2, {0,-1,0,-1}, {{1,0,1,0}, {0,-1,0,1}, {1,0,-1,0}}},
+	{HALFSQRT2, {1,1,0,0}, {{-1,1,0,0}, {0,0,1,-1}, {0,0,1,1}}},
+	{HALFSQRT2, {1,0,1,0}, {{0,1,0,1}, {-1,0,1,0}, {0,-1,0,1}}},
+	{HALFSQRT2, {1,0,0,1}, {{0,1,-1,0}, {0,1,1,0}, {-1,0,0,1}}},
+	{HALFSQRT2, {0,1,-1,0}, {{-1,0,0,-1}, {1,0,0,-1}, {0,1,1,0}}},
+	{HALFSQRT2, {0,0,1,-1}, {{0,0,1,1}, {-1,-1,0,0}, {1,-1,0,0}}},
+	{HALFSQRT2, {0,1,0,-1}, {{-1,0,1,0}, {0,-1,0,-1}, {1,0,1,0}}}
+};
+
+//!\brief Sums the quaternion components with the signs \c coefs from left to right, zero coefficients are skipped.
+template<class V> static inline typename V::D signedSum(const typename V::D * q, const signed char * coefs) {
+	typename V::D sum = V::zero();
+	bool first = true;
+#pragma GCC unroll 4
+	for (int i = 0; i < 4; i++) {
+		if (0 == coefs[i]) continue;
+		if (first) {
+			sum = coefs[i] > 0 ? q[i] : V::neg(q[i]);
+			first = false;
+		} else {
+			sum = coefs[i] > 0 ? V::add(sum, q[i]) : V::sub(sum, q[i]);
+		}
+	}
+	return sum;
+}
+
+template<class V> static inline typename V::D dot(typename V::D x1, typename V::D y1, typename V::D z1, typename V::D x2, typename V::D y2, typename V::D z2) {
+	return V::add(V::add(V::mul(x1, x2), V::mul(y1, y2)), V::mul(z1, z2));
+}
+
+template<class V> static inline typename V::D one() {
+	return V::set1(1.);
+}
+
+//!\brief Calculates the quaternions of \c V::width atoms at once.
+//! Atoms leaving the common path (degenerate <100> directions, matrices too distorted for the polar decomposition) are passed to \c Orientator::fccQuaternion().
+template<class V> static long fccQuaternionsLanes(const Orientator & orient, const double * const * nborVects, const unsigned char * nNeighbors,
+		double * outQuats, bool * outValid, QuaternionTierCounter * tierCounter) {
+	typedef typename V::D D;
+	typedef typename V::M M;
+	const int W = V::width;
+	double buffer[4][ORK_MAXLANES];
+
+	//transpose the neighbor vectors, lane l holds atom l
+	for (int l = 0; l < W; l++) {
+		buffer[0][l] = nNeighbors[l];
+	}
+	const D nNbors = V::load(buffer[0]);
+	M ok = V::le(nNbors, V::set1(FCC_NUMNEIGHBORS));
+	M present[FCC_NUMNEIGHBORS];
+	D x[FCC_NUMNEIGHBORS], y[FCC_NUMNEIGHBORS], z[FCC_NUMNEIGHBORS];
+	for (int k = 0; k < FCC_NUMNEIGHBORS; k++) {
+		for (int l = 0; l < W; l++) {
+			if (k < nNeighbors[l] && nNeighbors[l] <= FCC_NUMNEIGHBORS) {
+				buffer[0][l] = nborVects[l][DIM * k];
+				buffer[1][l] = nborVects[l][DIM * k + 1];
+				buffer[2][l] = nborVects[l][DIM * k + 2];
+			} else {
+				buffer[0][l] = 1.;
+				buffer[1][l] = 0.;
+				buffer[2][l] = 0.;
+			}
+		}
+		present[k] = V::mand(ok, V::lt(V::set1(k), nNbors));
+		//unit vectors
+		D xk = V::load(buffer[0]), yk = V::load(buffer[1]), zk = V::load(buffer[2]);
+		D length = V::sqrt(dot<V>(xk, yk, zk, xk, yk, zk));
+		x[k] = V::div(xk, length);
+		y[k] = V::div(yk, length);
+		z[k] = V::div(zk, length);
+	}
+
+	//replace antiparallel pairs by their mean direction, slot i holds the reduced vector of neighbor i
+	M redundant[FCC_NUMNEIGHBORS];
+	M reduced[FCC_NUMNEIGHBORS];
+	D rx[FCC_NUMNEIGHBORS], ry[FCC_NUMNEIGHBORS], rz[FCC_NUMNEIGHBORS];
+	for (int k = 0; k < FCC_NUMNEIGHBORS; k++) {
+		redundant[k] = V::none();
+	}
+	const D half = V::set1(.5);
+	D nVects = V::zero();
+	for (int i = 0; i < FCC_NUMNEIGHBORS; i++) {
+		reduced[i] = V::mand(present[i], V::mnot(redundant[i]));
+		rx[i] = x[i]; ry[i] = y[i]; rz[i] = z[i];
+		for (int ii = i + 1; ii < FCC_NUMNEIGHBORS; ii++) {
+			M pair = V::mand(V::mand(present[i], present[ii]), V::mnot(V::mor(redundant[i], redundant[ii])));
+			if (!V::bits(pair)) continue;
+			D cosAngle = dot<V>(x[i], y[i], z[i], x[ii], y[ii], z[ii]);
+			pair = V::mand(pair, V::lt(V::abs(V::sub(V::abs(cosAngle), one<V>())), V::set1(COSTRESHOLD)));
+			redundant[i] = V::mor(redundant[i], pair);
+			redundant[ii] = V::mor(redundant[ii], pair);
+			rx[i] = V::select(pair, V::mul(half, V::sub(x[i], x[ii])), rx[i]);
+			ry[i] = V::select(pair, V::mul(half, V::sub(y[i], y[ii])), ry[i]);
+			rz[i] = V::select(pair, V::mul(half, V::sub(z[i], z[ii])), rz[i]);
+		}
+		nVects = V::add(nVects, V::select(reduced[i], one<V>(), V::zero()));
+	}
+	ok = V::mand(ok, V::ge(nVects, V::set1(6.)));
+
+	//the cross products of the first three perpendicular pairs are the <100> directions (rows of the orientation matrix)
+	D m[9];
+	for (int i = 0; i < 9; i++) {
+		m[i] = V::zero();
+	}
+	const D three = V::set1(3.);
+	D nPerpend = V::zero();
+	for (int i = 0; i < FCC_NUMNEIGHBORS && V::bits(V::mand(ok, V::lt(nPerpend, three))); i++) {
+		for (int ii = i + 1; ii < FCC_NUMNEIGHBORS; ii++) {
+			M perpend = V::mand(V::mand(reduced[i], reduced[ii]), V::mand(ok, V::lt(nPerpend, three)));
+			if (!V::bits(perpend)) continue;
+			perpend = V::mand(perpend, V::lt(V::abs(dot<V>(rx[i], ry[i], rz[i], rx[ii], ry[ii], rz[ii])), V::set1(SINTRESHOLD)));
+			if (!V::bits(perpend)) continue;
+			D cx = V::sub(V::mul(ry[i], rz[ii]), V::mul(rz[i], ry[ii]));
+			D cy = V::sub(V::mul(rz[i], rx[ii]), V::mul(rx[i], rz[ii]));
+			D cz = V::sub(V::mul(rx[i], ry[ii]), V::mul(ry[i], rx[ii]));
+			for (int iRow = 0; iRow < 3; iRow++) {
+				M row = V::mand(perpend, V::eq(nPerpend, V::set1(iRow)));
+				m[3 * iRow] = V::select(row, cx, m[3 * iRow]);
+				m[3 * iRow + 1] = V::select(row, cy, m[3 * iRow + 1]);
+				m[3 * iRow + 2] = V::select(row, cz, m[3 * iRow + 2]);
+			}
+			nPerpend = V::add(nPerpend, V::select(perpend, one<V>(), V::zero()));
+		}
+	}
+	ok = V::mand(ok, V::eq(nPerpend, three));
+
+	//right-handed matrix: determinant as calculated by Eigen, nearly singular matrices are left to the scalar code
+	//(whose determinant may differ in rounding, e.g. if Armadillo is used)
+	D det = V::add(V::sub(V::mul(m[0], V::sub(V::mul(m[4], m[8]), V::mul(m[5], m[7]))),
+			V::mul(m[1], V::sub(V::mul(m[3], m[8]), V::mul(m[5], m[6])))),
+			V::mul(m[2], V::sub(V::mul(m[3], m[7]), V::mul(m[4], m[6]))));
+	M fallback = V::mand(ok, V::mnot(V::ge(V::abs(det), V::set1(1.e-6))));
+	M leftHanded = V::lt(det, V::zero());
+	for (int i = 0; i < 3; i++) {
+		m[i] = V::select(leftHanded, V::neg(m[i]), m[i]);
+	}
+
+	//deviation from orthonormality: max |M*M^T - I|
+	D deviation = V::zero();
+	for (int i = 0; i < DIM; i++) {
+		for (int j = i; j < DIM; j++) {
+			D element = dot<V>(m[DIM * i], m[DIM * i + 1], m[DIM * i + 2], m[DIM * j], m[DIM * j + 1], m[DIM * j + 2]);
+			if (i == j) element = V::sub(element, one<V>());
+			element = V::abs(element);
+			deviation = V::select(V::gt(element, deviation), element, deviation);
+		}
+	}
+	M common = V::mand(ok, V::mnot(fallback));
+	M closedForm = V::mand(common, V::lt(deviation, V::set1(ORTHONORMAL_TOLERANCE)));
+	M polar = V::mand(V::mand(common, V::mnot(closedForm)), V::lt(deviation, V::set1(POLAR_TOLERANCE)));
+
+	//polar decomposition by the Newton iteration R = (R + R^-T)/2, lanes stop as soon as they converged
+	D r[9], cofactors[9];
+	for (int i = 0; i < 9; i++) {
+		r[i] = m[i];
+	}
+	M active = polar;
+	M converged = V::none();
+	for (int iIter = 0; iIter < POLAR_MAXITERATIONS && V::bits(active); iIter++) {
+		cofactors[0] = V::sub(V::mul(r[4], r[8]), V::mul(r[5], r[7]));
+		cofactors[1] = V::sub(V::mul(r[5], r[6]), V::mul(r[3], r[8]));
+		cofactors[2] = V::sub(V::mul(r[3], r[7]), V::mul(r[4], r[6]));
+		cofactors[3] = V::sub(V::mul(r[2], r[7]), V::mul(r[1], r[8]));
+		cofactors[4] = V::sub(V::mul(r[0], r[8]), V::mul(r[2], r[6]));
+		cofactors[5] = V::sub(V::mul(r[1], r[6]), V::mul(r[0], r[7]));
+		cofactors[6] = V::sub(V::mul(r[1], r[5]), V::mul(r[2], r[4]));
+		cofactors[7] = V::sub(V::mul(r[2], r[3]), V::mul(r[0], r[5]));
+		cofactors[8] = V::sub(V::mul(r[0], r[4]), V::mul(r[1], r[3]));
+		D rDet = dot<V>(r[0], r[1], r[2], cofactors[0], cofactors[1], cofactors[2]);
+		active = V::mand(active, V::mnot(V::le(rDet, V::zero())));
+		D change = V::zero();
+		for (int i = 0; i < 9; i++) {
+			D newElement = V::mul(half, V::add(r[i], V::div(cofactors[i], rDet)));
+			D elementChange = V::abs(V::sub(newElement, r[i]));
+			change = V::select(V::gt(elementChange, change), elementChange, change);
+			r[i] = V::select(active, newElement, r[i]);
+		}
+		M done = V::mand(active, V::lt(change, V::set1(POLAR_CONVERGENCE)));
+		converged = V::mor(converged, done);
+		active = V::mand(active, V::mnot(done));
+	}
+	fallback = V::mor(fallback, V::mand(common, V::mnot(V::mor(closedForm, converged))));
+	for (int i = 0; i < 9; i++) {
+		r[i] = V::select(closedForm, m[i], r[i]);
+	}
+
+	//quaternion of the rotation matrix (Shepperd's method as ori::rotationMatrixToQuaternion())
+	D trace = V::add(V::add(r[0], r[4]), r[8]);
+	M branch0 = V::mand(V::mand(V::ge(trace, r[0]), V::ge(trace, r[4])), V::ge(trace, r[8]));
+	M branch1 = V::mand(V::mnot(branch0), V::mand(V::ge(r[0], r[4]), V::ge(r[0], r[8])));
+	M branch2 = V::mand(V::mnot(V::mor(branch0, branch1)), V::ge(r[4], r[8]));
+	M branch3 = V::mnot(V::mor(V::mor(branch0, branch1), branch2));
+	D largestArg = V::sub(V::sub(V::add(one<V>(), r[0]), r[4]), r[8]);
+	largestArg = V::select(branch0, V::add(V::add(V::add(one<V>(), r[0]), r[4]), r[8]), largestArg);
+	largestArg = V::select(branch2, V::sub(V::add(V::sub(one<V>(), r[0]), r[4]), r[8]), largestArg);
+	largestArg = V::select(branch3, V::add(V::sub(V::sub(one<V>(), r[0]), r[4]), r[8]), largestArg);
+	D largest = V::mul(half, V::sqrt(largestArg));
+	D diff57 = V::sub(r[5], r[7]), diff62 = V::sub(r[6], r[2]), diff13 = V::sub(r[1], r[3]);
+	D sum13 = V::add(r[1], r[3]), sum62 = V::add(r[6], r[2]), sum57 = V::add(r[5], r[7]);
+	D numerators[4];
+	numerators[0] = V::select(branch1, diff57, V::select(branch2, diff62, diff13));
+	numerators[1] = V::select(branch0, diff57, V::select(branch2, sum13, sum62));
+	numerators[2] = V::select(branch0, diff62, V::select(branch1, sum13, sum57));
+	numerators[3] = V::select(branch0, diff13, V::select(branch1, sum62, sum57));
+	const M branches[4] = {branch0, branch1, branch2, branch3};
+	const D quarter = V::set1(.25);
+	D q[4];
+	for (int i = 0; i < 4; i++) {
+		q[i] = V::select(branches[i], largest, V::div(V::mul(quarter, numerators[i]), largest));
+	}
+
+	//unique cubic equivalent (as ori::uniqueCubicRotationQuaternion())
+	D maxCos = V::zero();
+	D selection = V::zero();
+	D candidateId = V::set1(-1.);
+#pragma GCC unroll 24
+	for (int iC = 0; iC < 24; iC++) {
+		const CubicCandidate & candidate = cubicCandidates[iC];
+		D sum = signedSum<V>(q, candidate.selection);
+		D cosine = 1. == candidate.scale ? V::abs(sum) : V::mul(V::set1(candidate.scale), V::abs(sum));
+		M larger = V::gt(cosine, maxCos);
+		maxCos = V::select(larger, cosine, maxCos);
+		selection = V::select(larger, sum, selection);
+		candidateId = V::select(larger, V::set1(iC), candidateId);
+	}
+	M accepted = V::mand(V::mor(closedForm, converged), V::gt(maxCos, V::zero()));
+	fallback = V::mor(fallback, V::mand(V::mor(closedForm, converged), V::mnot(accepted)));
+	D qSign = V::select(V::gt(selection, V::zero()), one<V>(), V::select(V::lt(selection, V::zero()), V::set1(-1.), V::zero()));
+	D qOut[4] = {maxCos, V::zero(), V::zero(), V::zero()};
+#pragma GCC unroll 24
+	for (int iC = 0; iC < 24; iC++) {
+		M isCandidate = V::mand(accepted, V::eq(candidateId, V::set1(iC)));
+		if (!V::bits(isCandidate)) continue;
+		const CubicCandidate & candidate = cubicCandidates[iC];
+		D factor = 1. == candidate.scale ? qSign : V::mul(qSign, V::set1(candidate.scale));
+		for (int i = 0; i < 3; i++) {
+			qOut[i + 1] = V::select(isCandidate, V::mul(factor, signedSum<V>(q, candidate.components[i])), qOut[i + 1]);
+		}
+	}
+
+	for (int i = 0; i < 4; i++) {
+		V::store(buffer[i], qOut[i]);
+	}
+	const int acceptedBits = V::bits(accepted);
+	const int closedFormBits = V::bits(closedForm);
+	const int fallbackBits = V::bits(fallback);
+	long nValid = 0;
+	for (int l = 0; l < W; l++) {
+		if (fallbackBits & (1 << l)) {
+			outValid[l] = orient.fccQuaternion(nborVects[l], nNeighbors[l], outQuats + 4 * l, tierCounter);
+		} else if (acceptedBits & (1 << l)) {
+			for (int i = 0; i < 4; i++) {
+				outQuats[4 * l + i] = buffer[i][l];
+			}
+			outValid[l] = true;
+			if (tierCounter) {
+				tierCounter->add((closedFormBits & (1 << l)) ? closedFormTier : polarTier);
+			}
+		} else {
+			outValid[l] = false;
+		}
+		if (outValid[l]) nValid++;
+	}
+	return nValid;
+}
+
+//!\brief Calculates the quaternions of all atoms, \c V::width atoms at once. The remaining atoms are calculated by the scalar code.
+template<class V> static long fccQuaternionsBatch(const Orientator & orient, const double * const * nborVects, const unsigned char * nNeighbors, long nAtoms,
+		double * outQuats, bool * outValid, QuaternionTierCounter * tierCounter) {
+	long nValid = 0;
+	long iA = 0;
+	for (; iA + V::width <= nAtoms; iA += V::width) {
+		nValid += fccQuaternionsLanes<V>(orient, nborVects + iA, nNeighbors + iA, outQuats + 4 * iA, outValid + iA, tierCounter);
+	}
+	for (; iA < nAtoms; iA++) {
+		outValid[iA] = orient.fccQuaternion(nborVects[iA], nNeighbors[iA], outQuats + 4 * iA, tierCounter);
+		if (outValid[iA]) nValid++;
+	}
+	return nValid;
+}
+
+}
+
+#endif /* ORIENTATIONKERNELBATCH_H_ */
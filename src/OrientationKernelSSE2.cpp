@@ -0,0 +1,78 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "OrientationKernel.h"
+
+#ifdef ORK_X86_DISPATCH
+#include <immintrin.h>
+//Everything below is compiled for SSE2, the kernels have to round exactly like the scalar code,
+//hence products must not be contracted to fused multiply-adds.
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#pragma STDC FP_CONTRACT OFF
+#else
+#pragma GCC push_options
+#pragma GCC target ("sse2")
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+namespace {
+//!\brief 2 lanes of SSE2.
+struct SSE2Vector {
+	typedef __m128d D;
+	typedef __m128d M;
+	static const int width = 2;
+	static inline D zero() { return _mm_setzero_pd();}
+	static inline D set1(double a) { return _mm_set1_pd(a);}
+	static inline D load(const double * a) { return _mm_loadu_pd(a);}
+	static inline void store(double * a, D v) { _mm_storeu_pd(a, v);}
+	static inline D add(D a, D b) { return _mm_add_pd(a, b);}
+	static inline D sub(D a, D b) { return _mm_sub_pd(a, b);}
+	static inline D mul(D a, D b) { return _mm_mul_pd(a, b);}
+	static inline D div(D a, D b) { return _mm_div_pd(a, b);}
+	static inline D sqrt(D a) { return _mm_sqrt_pd(a);}
+	static inline D abs(D a) { return _mm_andnot_pd(_mm_set1_pd(-0.), a);}
+	static inline D neg(D a) { return _mm_xor_pd(_mm_set1_pd(-0.), a);}
+	static inline M lt(D a, D b) { return _mm_cmplt_pd(a, b);}
+	static inline M le(D a, D b) { return _mm_cmple_pd(a, b);}
+	static inline M gt(D a, D b) { return _mm_cmpgt_pd(a, b);}
+	static inline M ge(D a, D b) { return _mm_cmpge_pd(a, b);}
+	static inline M eq(D a, D b) { return _mm_cmpeq_pd(a, b);}
+	static inline M none() { return _mm_setzero_pd();}
+	static inline M mand(M a, M b) { return _mm_and_pd(a, b);}
+	static inline M mor(M a, M b) { return _mm_or_pd(a, b);}
+	static inline M mnot(M a) { return _mm_xor_pd(a, _mm_castsi128_pd(_mm_set1_epi32(-1)));}
+	//!\return \c a in the lanes set in \c m, \c b otherwise
+	static inline D select(M m, D a, D b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b));}
+	static inline int bits(M m) { return _mm_movemask_pd(m);}
+};
+}
+
+#include "OrientationKernelBatch.h"
+
+long ork::fccQuaternionsSSE2(const Orientator & orient, const double * const * nborVects, const unsigned char * nNeighbors, long nAtoms,
+		double * outQuats, bool * outValid, QuaternionTierCounter * tierCounter) {
+	return fccQuaternionsBatch<SSE2Vector>(orient, nborVects, nNeighbors, nAtoms, outQuats, outValid, tierCounter);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
@@ -172,34 +172,34 @@ double ori::cubicCosHalfMisOrientation(const double *q1, const double *q2) {
 }
 
 void ori::rotationMatrixToQuaternion(const double * r, double * q) {
-	if ( r[4] > -r[8] || r[0] > -r[4] || r[0] > -r[8]){
+	//the component with the largest magnitude is calculated first (Shepperd's method),
+	//the divisions by it are thus accurate for all rotations
+	double trace = r[0] + r[4] + r[8];
+	if ( trace >= r[0] && trace >= r[4] && trace >= r[8]){
 		q[0] = .5 * sqrt(1+r[0]+r[4]+r[8]);
 		q[1] = .25 * (r[5] - r[7]) / q[0];
 		q[2] = .25 * (r[6] - r[2]) / q[0];
 		q[3] = .25 * (r[1] - r[3]) / q[0];
 		return;
 	}
-	if ( r[4] < -r[8] || r[0] > r[4] || r[0] > r[8]){
+	if ( r[0] >= r[4] && r[0] >= r[8]){
 		q[1] = .5 * sqrt(1+r[0]-r[4]-r[8]);
 		q[0] = .25 * (r[5] - r[7]) / q[1];
 		q[2] = .25 * (r[1] + r[3]) / q[1];
 		q[3] = .25 * (r[6] + r[2]) / q[1];
 		return;
 	}
-	if ( r[4] > r[8] || r[0] < r[4] || r[0] < -r[8]){
+	if ( r[4] >= r[8]){
 		q[2] = .5 * sqrt(1-r[0]+r[4]-r[8]);
 		q[0] = .25 * (r[6] - r[2]) / q[2];
 		q[1] = .25 * (r[1] + r[3]) / q[2];
 		q[3] = .25 * (r[5] + r[7]) / q[2];
 		return;
 	}
-	if ( r[4] < r[8] || r[0] < -r[4] || r[0] < r[8]){
-		q[3] = .5 * sqrt(1-r[0]-r[4]+r[8]);
-		q[0] = .25 * (r[1] - r[3]) / q[3];
-		q[1] = .25 * (r[6] + r[2]) / q[3];
-		q[2] = .25 * (r[5] + r[7]) / q[3];
-		return;
-	}
+	q[3] = .5 * sqrt(1-r[0]-r[4]+r[8]);
+	q[0] = .25 * (r[1] - r[3]) / q[3];
+	q[1] = .25 * (r[6] + r[2]) / q[3];
+	q[2] = .25 * (r[5] + r[7]) / q[3];
 }
 
 void ori::bunge2Quaternion( const double * euler, double * q )
@@ -0,0 +1,70 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "OrientationStore.h"
+
+OrientationStore::OrientationStore() {
+}
+
+OrientationStore::~OrientationStore() {
+}
+
+void OrientationStore::assign(long nAtoms, const double * quats, const bool * valid) {
+	numAtoms = nAtoms;
+	for (int i = 0; i < 4; i++) {
+		columns[i].assign(nAtoms, 0.);
+	}
+	long nWords = (nAtoms + 63) / 64;
+	validBits.assign(nWords, 0);
+	long nValid = 0;
+	//each thread writes whole words of the bitmask
+#pragma omp parallel for schedule(static) reduction(+:nValid)
+	for (long iW = 0; iW < nWords; iW++) {
+		uint64_t word = 0;
+		long lastAtomNum = std::min((iW + 1) * 64, nAtoms);
+		for (long atomNum = iW * 64; atomNum < lastAtomNum; atomNum++) {
+			if (!valid[atomNum]) continue;
+			word |= uint64_t(1) << (atomNum & 63);
+			columns[0][atomNum] = quats[4 * atomNum];
+			columns[1][atomNum] = quats[4 * atomNum + 1];
+			columns[2][atomNum] = quats[4 * atomNum + 2];
+			columns[3][atomNum] = quats[4 * atomNum + 3];
+			nValid++;
+		}
+		validBits[iW] = word;
+	}
+	numValid = nValid;
+}
+
+void OrientationStore::clear() {
+	numAtoms = 0;
+	numValid = 0;
+	for (int i = 0; i < 4; i++) {
+		std::vector<double>().swap(columns[i]);
+	}
+	std::vector<uint64_t>().swap(validBits);
+}
+
+void OrientationStore::reset() {
+	numAtoms = 0;
+	numValid = 0;
+	for (int i = 0; i < 4; i++) {
+		columns[i].clear();
+	}
+	validBits.clear();
+}
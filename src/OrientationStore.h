@@ -0,0 +1,77 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ORIENTATIONSTORE_H_
+#define ORIENTATIONSTORE_H_
+#include <cstdint>
+#include "GradeA_Defs.h"
+
+//!\brief Orientations of all atoms of a container as structure of arrays.
+//! The quaternions are stored in four columns (one for each component) indexed directly by the atom number,
+//! whether an atom has an orientation is stored in a bitmask. Thus there is no indirection through an orientation id
+//! and no reallocation while the orientations are calculated.
+class OrientationStore {
+public:
+	OrientationStore();
+	virtual ~OrientationStore();
+
+	//!\brief Replaces the stored orientations.
+	//!\param[in] nAtoms Number of atoms.
+	//!\param[in] quats Quaternion of each atom, 4 elements for each atom. Only read for valid atoms.
+	//!\param[in] valid Flag for each atom, whether it has an orientation.
+	void assign(long nAtoms, const double * quats, const bool * valid);
+
+	//!\brief Frees the memory of the store.
+	void clear();
+
+	//!\brief Removes all orientations, but keeps the memory for the next \c assign().
+	void reset();
+
+	//!\return The number of atoms.
+	long size() const { return numAtoms;};
+
+	//!\return The number of atoms with an orientation.
+	long getNumValid() const { return numValid;};
+
+	//!\return Whether the atom \c atomNum has an orientation.
+	bool isValid(long atomNum) const { return (validBits[atomNum >> 6] >> (atomNum & 63)) & 1;};
+
+	//!\brief Copies the quaternion of the atom \c atomNum to \c q.
+	void getQuaternion(long atomNum, double * q) const {
+		q[0] = columns[0][atomNum];
+		q[1] = columns[1][atomNum];
+		q[2] = columns[2][atomNum];
+		q[3] = columns[3][atomNum];
+	}
+
+	//!\return The cosine of the half misorientation angle between two atoms (as \c ori::cosHalfMisOrientation()).
+	double cosHalfMisOrientation(long atomNum1, long atomNum2) const {
+		return fabs(columns[0][atomNum1] * columns[0][atomNum2] + columns[1][atomNum1] * columns[1][atomNum2]
+			+ columns[2][atomNum1] * columns[2][atomNum2] + columns[3][atomNum1] * columns[3][atomNum2]);
+	}
+
+	//!\return The column of the quaternion component \c i (0-3) of all atoms.
+	const double * getColumn(int i) const { return columns[i].data();};
+private:
+	long numAtoms = 0;
+	long numValid = 0;
+	std::vector<double> columns[4];
+	std::vector<uint64_t> validBits;
+};
+
+#endif /* ORIENTATIONSTORE_H_ */
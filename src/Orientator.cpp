@@ -46,90 +46,21 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 #define F4TY5_5DEGPREC (0.06432)
 #define TH3TY5_5DEGPREC (0.05343)
-#define COSTRESHOLD COS5DEGPREC
-#define SINTRESHOLD 2.e-1
 #define SIXTYDEGTRESHH ST_1DEGPREC
 #define DEFAULTLEAFSIZE 10
 
 Orientator::Orientator(AtomBox * inBoxes) {
-	init(inBoxes, ORIENTALLOC);
-}
-
-Orientator::Orientator(AtomBox * inBoxes, unsigned long initCapacity){
-	init(inBoxes, initCapacity);
-}
-
-void Orientator::init(AtomBox * inBoxes, unsigned long initCapacity){
-	nOrientations = 0;
-	orientAlloc = initCapacity;
-	orientSize = 0;
-	orientations = nullptr;
 	boxes = inBoxes;
 }
 
 Orientator::~Orientator() {
-	if(orientSize > 0){
-		delete [] orientations;
-	}
 }
 
-oID Orientator::orientateFCC(double * neighborPositions, unsigned char nNextNeighbors){
-	if (nNextNeighbors > 12) {
-		return NO_ORIENTATION;
-	}
-	double * unitVectors = new double [nNextNeighbors * DIM];
-	for(unsigned char i = 0; i < nNextNeighbors * DIM; i ++){
-		unitVectors[i] = neighborPositions[i];
-	}
-	ori::unitizeVectors(unitVectors, nNextNeighbors);
-	unsigned char nVects;
-	nVects = reduceAntiparallelVectors(unitVectors, nNextNeighbors);
-	double * nextNborVects = new double [nVects*DIM];
-	for(long i = 0; i < nVects*DIM; i++){
-		nextNborVects[i] = unitVectors[i];
-	}
-	delete [] unitVectors;
-	//nextNborVects has now size nVects
-#ifndef DEBUGMODE
-	if (nVects < 6) {
-		delete [] nextNborVects;
-		return NO_ORIENTATION;
-	}
-#else
-	if (nVects < 6) {
-	delete [] nextNborVects;
-	std::cout << "NO ORI BECAUSE OF nVects < 6" << std::endl;
-	return NO_ORIENTATION;
-	}
-#endif
-	//each vector pair:
-	char iVec2;
-	char nPerpend = 0;
-	double normal100Vects[3*DIM];
-	//obtain <100> directions
-	//always 2 next-neighbor pairs which are perpendicular lay inside a {100} plane
-	//the normal vector is obtained by calculating the cross product
-	for (char iVec = 0; iVec < nVects; iVec++){
-		if (3 == nPerpend) break;
-		for (iVec2 = iVec + 1; iVec2 < nVects; iVec2++){
-			if( vectsArePerpend(nextNborVects + DIM * iVec, nextNborVects + DIM * iVec2) )
-			{
-				ori::crossProduct(nextNborVects + DIM * iVec, nextNborVects + DIM * iVec2, normal100Vects + DIM * nPerpend);
-				if(3 == ++nPerpend){
-					break;
-				}
-			}
-		}
-	}
-	delete [] nextNborVects;
-	if (nPerpend < 3) {
-		//not enough perpend directions found
-		return NO_ORIENTATION;
-	}
-	return calcOrientationFromThree100Directions(normal100Vects, normal100Vects + DIM, normal100Vects + 2*DIM);
+bool Orientator::fccQuaternion(const double * neighborPositions, unsigned char nNextNeighbors, double * q, QuaternionTierCounter * inTierCounter) const{
+	return fccQuaternion<FCC_NUMNEIGHBORS>(neighborPositions, nNextNeighbors, q, inTierCounter);
 }
 
-oID Orientator::calcOrientationFromThree100Directions(double * v100, double * v010, double * v001){
+bool Orientator::quaternionFromThree100Directions(const double * v100, const double * v010, const double * v001, double * q, QuaternionTierCounter * inTierCounter) const{
 #ifdef USE_ARMADILLO
 	arma::mat m(DIM,DIM);
 #else
@@ -161,70 +92,79 @@ oID Orientator::calcOrientationFromThree100Directions(double * v100, double * v0
 #endif
 	if (det < 0.){
 		std::cout << "ERROR: determinant of matrix negative" << std::endl;
-		return NO_ORIENTATION;
+		return false;
 	}
-	return closestOrientation(m);
-}
-
-#ifdef USE_ARMADILLO
-oID Orientator::closestOrientation (arma::mat  & m3x3){
-#else
-oID Orientator::closestOrientation (Eigen::Matrix3d  & m3x3){
-#endif
 	double M[9] = {
-	m3x3(0,0), m3x3(0,1), m3x3(0,2),
-	m3x3(1,0), m3x3(1,1), m3x3(1,2),
-	m3x3(2,0), m3x3(2,1), m3x3(2,2)
+	m(0,0), m(0,1), m(0,2),
+	m(1,0), m(1,1), m(1,2),
+	m(2,0), m(2,1), m(2,2)
 	};
-	return closestOrientation(M);
+	return closestQuaternion(M, q, inTierCounter);
 }
 
-oID Orientator::calcFCCOrientation_90Deg(double * v110, double * vm110){
-	double v001[3];
-	ori::crossProduct(v110,vm110,v001);
-	double M [9] = {
-	//row 0
-	HALFSQRT2 * (v110[0] - vm110[0]) ,//11-0
-	HALFSQRT2 * (v110[0] + vm110[0]) ,//12-1
-	v001[0] ,		//13-2
-	//row 1
-	HALFSQRT2 * (v110[1] - vm110[1]) ,//21-3
-	HALFSQRT2 * (v110[1] + vm110[1]) ,//22-4
-	v001[1],		//23-5
-	//row 2
-	HALFSQRT2 * (v110[2] - vm110[2]) ,//31-6
-	HALFSQRT2 * (v110[2] + vm110[2]) ,//32-7
-	v001[2]//33-8
-	};
-	return closestOrientation(M);
+QuaternionTier Orientator::matrixToClosestQuaternion(const double * M, double * q) const{
+	//deviation from orthonormality: max |M*M^T - I|
+	double deviation = 0.;
+	double element;
+	for (char i = 0; i < DIM; i++){
+		for (char j = i; j < DIM; j++){
+			element = M[DIM*i] * M[DIM*j] + M[DIM*i+1] * M[DIM*j+1] + M[DIM*i+2] * M[DIM*j+2];
+			if (i == j) element -= 1.;
+			if (fabs(element) > deviation) deviation = fabs(element);
+		}
+	}
+	if (deviation < ORTHONORMAL_TOLERANCE){
+		//perfect crystal: M is already a rotation matrix
+		ori::rotationMatrixToQuaternion(M, q);
+		return closedFormTier;
+	}
+	double R[9];
+	if (deviation < POLAR_TOLERANCE && polarDecomposition(M, R)){
+		//slightly distorted: the closest rotation matrix is the orthogonal factor of the polar decomposition
+		ori::rotationMatrixToQuaternion(R, q);
+		return polarTier;
+	}
+	eigenClosestQuaternion(M, q);
+	return eigenTier;
 }
 
-oID Orientator::calcFCCOrientation_60Deg(double * v110, double * v101){
-	double v1m1m1[3];
-	ori::crossProduct(v110,v101,v1m1m1);
-	for(char i = 0; i < DIM; i++){
-		v110[i] *= THIRDSQRT2;
-		v101[i] *= THIRDSQRT2;
-		v1m1m1[i] *= THIRD2;
+bool Orientator::polarDecomposition(const double * M, double * R) const{
+	//Newton iteration R = (R + R^-T)/2, converges quadratically for nearly orthonormal matrices
+	double cofactors[9];
+	double det, change, newElement;
+	for (char i = 0; i < 9; i++){
+		R[i] = M[i];
 	}
-	double M[9] = {
-	//row 0
-	v110[0] + v101[0] + v1m1m1[0],
-	2 * v110[0] - v101[0] - v1m1m1[0],
-	- v110[0] + 2* v101[0] - v1m1m1[0],
-	//row 1
-	v110[1] + v101[1] + v1m1m1[1],
-	2 * v110[1] - v101[1] - v1m1m1[1],
-	- v110[1] + 2* v101[1] - v1m1m1[1],
-	//row 2
-	v110[2] + v101[2] + v1m1m1[2],
-	2 * v110[2] - v101[2] - v1m1m1[2],
-	- v110[2] + 2* v101[2] - v1m1m1[2]
-	};
-	return closestOrientation(M);
+	for (int iIter = 0; iIter < POLAR_MAXITERATIONS; iIter++){
+		cofactors[0] = R[4] * R[8] - R[5] * R[7];
+		cofactors[1] = R[5] * R[6] - R[3] * R[8];
+		cofactors[2] = R[3] * R[7] - R[4] * R[6];
+		cofactors[3] = R[2] * R[7] - R[1] * R[8];
+		cofactors[4] = R[0] * R[8] - R[2] * R[6];
+		cofactors[5] = R[1] * R[6] - R[0] * R[7];
+		cofactors[6] = R[1] * R[5] - R[2] * R[4];
+		cofactors[7] = R[2] * R[3] - R[0] * R[5];
+		cofactors[8] = R[0] * R[4] - R[1] * R[3];
+		det = R[0] * cofactors[0] + R[1] * cofactors[1] + R[2] * cofactors[2];
+		if (det <= 0.){
+			//left-handed or singular, the result would not be a rotation
+			return false;
+		}
+		//R^-T = cofactor matrix / det
+		change = 0.;
+		for (char i = 0; i < 9; i++){
+			newElement = .5 * (R[i] + cofactors[i] / det);
+			if (fabs(newElement - R[i]) > change) change = fabs(newElement - R[i]);
+			R[i] = newElement;
+		}
+		if (change < POLAR_CONVERGENCE){
+			return true;
+		}
+	}
+	return false;
 }
 
-void Orientator::matrixToClosestQuaternion(const double * M, double * q){
+void Orientator::eigenClosestQuaternion(const double * M, double * q) const{
 	//see Itzhack 2000 " New Method for Extracting the Quaternion from a Rotation Matrix "
 #ifdef USE_ARMADILLO
 	arma::mat m(4,4);
@@ -281,17 +221,11 @@ void Orientator::matrixToClosestQuaternion(const double * M, double * q){
 	}
 }
 
-oID Orientator::closeOrientbyQuaternion(double * q){
-	double cubicQuat[4];
-	ori::uniqueCubicRotationQuaternion(q,cubicQuat);
-	return newOrientbyQuaternion(cubicQuat);
-}
-
 double Orientator::cubicCosHalfMisOrientation(const Atom* atom1, const Atom* atom2) const {
-	const double  * q1, * q2;
-		q1= orientations[atom1->getOrientationId()].getQuaternion();
-		q2= orientations[atom2->getOrientationId()].getQuaternion();
-		return ori::cubicCosHalfMisOrientation(q1,q2);
+	double q1[4], q2[4];
+	getQuaternion(atom1, q1);
+	getQuaternion(atom2, q2);
+	return ori::cubicCosHalfMisOrientation(q1,q2);
 }
 
 bool Orientator::haveCloseOrientations(const Atom *atom1, const Atom *atom2, double cosHalfThreshold) const{
@@ -301,71 +235,48 @@ bool Orientator::haveCloseOrientations(const Atom *atom1, const Atom *atom2, dou
 }
 
 double Orientator::cosHalfMisOrientation(const Atom *atom1, const Atom *atom2) const{
-	const double  * q1, * q2;
-	q1= orientations[atom1->getOrientationId()].getQuaternion();
-	q2= orientations[atom2->getOrientationId()].getQuaternion();
-	return ori::cosHalfMisOrientation(q1,q2);
+	return store.cosHalfMisOrientation(atom1 - atoms, atom2 - atoms);
 }
 
-const Orientation * Orientator::getOrientation(oID inOriId) const
-{
-	return orientations + inOriId;
+void Orientator::setOrientations(const Atom * inAtoms, long nAtoms, const double * quats, const bool * valid){
+	atoms = inAtoms;
+	store.assign(nAtoms, quats, valid);
 }
 
-oID Orientator::newOrientbyQuaternion(double * q){
-	if(nOrientations < orientSize){//space is sufficient
-		orientations[nOrientations].initbyQuaternion(q);
-		nOrientations ++;
-		return nOrientations - 1;
-	}
-	Orientation * oldOrients;
-	if (0 != nOrientations){//reallocation
-		 oldOrients = new Orientation [nOrientations];
-		for(long i = 0; i < nOrientations; i ++){
-				oldOrients[i] = orientations[i];
-		}
-		delete [] orientations;
-
-	}
-	orientSize += orientAlloc;
-    orientations = new Orientation[orientSize];
-
-    if(0 != nOrientations){
-		for (long i = 0; i < nOrientations; i ++){
-			orientations[i] = oldOrients[i];
-		}
-		delete [] oldOrients;
-    }
-
-	orientations[nOrientations].initbyQuaternion(q);
-	nOrientations ++;
-	return nOrientations - 1;
+void Orientator::reset(AtomBox * inBoxes){
+	boxes = inBoxes;
+	atoms = nullptr;
+	store.reset();
+	tierCounter = QuaternionTierCounter();
 }
 
 AtomBox * Orientator::getBoxes(){
 	return boxes;
 }
 
-oID Orientator::closestOrientation (const double * M){
-	double q[4];
+bool Orientator::closestQuaternion (const double * M, double * q, QuaternionTierCounter * inTierCounter) const{
+	double qMatrix[4];
+	QuaternionTier tier;
 	try{
-		matrixToClosestQuaternion(M, q);
+		tier = matrixToClosestQuaternion(M, qMatrix);
 	} catch (...){
-		return NO_ORIENTATION;
+		return false;
+	}
+	if (inTierCounter){
+		inTierCounter->add(tier);
 	}
-	oID ret;
-	 ret = closeOrientbyQuaternion(q);
-	return ret;
+	ori::uniqueCubicRotationQuaternion(qMatrix, q);
+	return true;
 }
 
-unsigned char Orientator::reduceAntiparallelVectors(doubleP &vects, unsigned char n){
-	double * v1, * v2;
-	bool * redundant = new bool [n];
+unsigned char Orientator::reduceAntiparallelVectors(const double * vects, unsigned char n, bool * redundant, double * outVects) const{
+	const double * v1, * v2;
 	for(unsigned char i = 0; i < n; i++ ){
 		redundant[i] = false;
 	}
 	unsigned char ii;
-	std::vector<double> v;
+	unsigned char nOut = 0;
+	double * v;
 
 	for(unsigned char i = 0; i < n; i++ ){
 			v1 = vects + i*DIM;
@@ -380,32 +291,25 @@ unsigned char Orientator::reduceAntiparallelVectors(doubleP &vects, unsigned cha
 							redundant[i] = true;
 							redundant[ii] = true;
 							//save the mean direction as vector
-							v.push_back(.5*(v1[0]-v2[0]));
-							v.push_back(.5*(v1[1]-v2[1]));
-							v.push_back(.5*(v1[2]-v2[2]));
+							v = outVects + DIM * nOut++;
+							v[0] = .5*(v1[0]-v2[0]);
+							v[1] = .5*(v1[1]-v2[1]);
+							v[2] = .5*(v1[2]-v2[2]);
 						}
 					}
 			}
 			//if no partner was found, remain single forever!
 			if(!redundant[i]){
-				v.push_back(v1[0]);
-				v.push_back(v1[1]);
-				v.push_back(v1[2]);
+				v = outVects + DIM * nOut++;
+				v[0] = v1[0];
+				v[1] = v1[1];
+				v[2] = v1[2];
 			}
 	}
-	//redundant information is no longer needed
-	delete [] redundant;
-	//initial vectors are no longer needed
-	delete [] vects;
-	//allocate for reduced vector list
-	vects = new double [v.size()];
-	for (unsigned char i = 0; i < v.size(); i ++){
-		vects[i] = v[i];
-	}
-	return static_cast<unsigned char> (v.size()/DIM);
+	return nOut;
 }
 
-bool Orientator::vectsArePerpend(double * v1, double * v2){
+bool Orientator::vectsArePerpend(const double * v1, const double * v2) const{
 	if ( fabs(ori::scalarProduct(v1, v2)) < SINTRESHOLD) return true;
 	return false;
 }
@@ -464,40 +368,12 @@ unsigned char Orientator::find60DegDirect(double * directs, unsigned char nDirec
 	return me;
 }
 
-bool sortVectsInSpace(double * vA, double  * vB){ return (7*vA[0] + 41*vA[1] + vA[2]) > (7*vB[0] + 41*vB[1] + vB[2]); }
-
-void Orientator::sortVectsList(double * vList, long nVects){
-	double ** vects = new double * [nVects];
-	double * sortedValues = new double [nVects * DIM];
-	for (long i = 0; i < nVects; i++){
-		vects[i] = vList + i*DIM;
-	}
-	std::sort(vects,vects + nVects,sortVectsInSpace);
-	long iP;
-	for (long i = 0; i < nVects; i++){
-	iP = i*DIM;
-	sortedValues[iP] = vects[i][0];
-	sortedValues[iP+1] = vects[i][1];
-	sortedValues[iP+2] = vects[i][2];
-	}
-	delete [] vects;
-	for (long i = 0; i < nVects; i++){
-	iP = i*DIM;
-	vList[iP] = sortedValues[iP];
-	iP++;
-	vList[iP] = sortedValues[iP];
-	iP++;
-	vList[iP] = sortedValues[iP];
-	}
-	delete [] sortedValues;
+void Orientator::addTierCounts(const QuaternionTierCounter & inTierCounter){
+	tierCounter.add(inTierCounter);
 }
 
 long Orientator::getNumOrientations() const{
-	return nOrientations;
-}
-
-Orientation * Orientator::getOrientations(){
-	return orientations;
+	return store.getNumValid();
 }
 
 OrientatorPrinter::OrientatorPrinter(const Orientator* inOrient,
@@ -514,8 +390,15 @@ OrientatorPrinter::OrientatorPrinter(const Orientator* inOrient,
 }
 
 void OrientatorPrinter::print() {
-	for (oID iO = 0; iO < orient->getNumOrientations(); iO++){
-		printOrientation(orient->getOrientation(iO));
+	//the orientations are printed in the order of their ids, which are numbered in atom order
+	const OrientationStore & store = orient->getStore();
+	Orientation ori;
+	double q[4];
+	for (long atomNum = 0; atomNum < store.size(); atomNum++){
+		if (!store.isValid(atomNum)) continue;
+		store.getQuaternion(atomNum, q);
+		ori.initbyQuaternion(q);
+		printOrientation(&ori);
 	}
 	writer.write();
 }
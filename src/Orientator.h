@@ -19,10 +19,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef ORIENTATOR_H_
 #define ORIENTATOR_H_
 
-#define ORIENTALLOC 10000
+//!number of nearest neighbors of an fcc atom
+#define FCC_NUMNEIGHBORS 12
+//!maximum deviation of |cos| from 1 of two antiparallel neighbor directions (5 degree)
+#define COSTRESHOLD (3.8053019082544677050E-3)
+//!maximum |cos| of two perpendicular neighbor directions
+#define SINTRESHOLD 2.e-1
+//!maximum deviation of M*M^T from the identity, up to which the quaternion is calculated directly
+#define ORTHONORMAL_TOLERANCE 1.e-12
+//!maximum deviation of M*M^T from the identity, up to which M is orthonormalized by the polar decomposition
+#define POLAR_TOLERANCE 1.
+#define POLAR_MAXITERATIONS 10
+#define POLAR_CONVERGENCE 1.e-14
 #include "GradeA_Defs.h"
 #include "Atom.h"
 #include "Orientation.h"
+#include "OrientationStore.h"
 
 #ifdef USE_ARMADILLO
 #include <armadillo>
@@ -36,50 +48,160 @@ class Atom;
 class AtomBox;
 class MeanOrientation;
 
+//!\brief Method by which a quaternion has been extracted from an orientation matrix.
+//! \c closedFormTier: the matrix is orthonormal, the quaternion is calculated directly.
+//! \c polarTier: the matrix is nearly orthonormal and is orthonormalized by a few Newton iterations of the polar decomposition.
+//! \c eigenTier: distorted matrix, the quaternion is the dominant eigenvector of a 4x4 matrix (eigen solver).
+enum QuaternionTier {closedFormTier, polarTier, eigenTier, NUM_QUATERNIONTIERS};
+
+//!\brief Counts the number of quaternion extractions of each \c QuaternionTier.
+struct QuaternionTierCounter {
+	long counts[NUM_QUATERNIONTIERS] = {0, 0, 0};
+	void add(QuaternionTier tier) { counts[tier]++;};
+	void add(const QuaternionTierCounter & other) {
+		for (int i = 0; i < NUM_QUATERNIONTIERS; i++) counts[i] += other.counts[i];
+	};
+};
+
 class Orientator {
 public:
 	Orientator(){};
 	Orientator(AtomBox * boxes);
-	Orientator(AtomBox * boxes, unsigned long initCapacity);
 	virtual ~Orientator();
-	oID orientateFCC(double * neighborPositions, unsigned char nNextNeighbors);
-#ifdef USE_ARMADILLO
-	oID closestOrientation (arma::mat  & m3x3);
-#else //use Eigen library
-	oID closestOrientation (Eigen::Matrix3d  & m3x3);
-#endif
-	oID closestOrientation (const double * M);
+	//!\brief Calculates the unique cubic quaternion of an fcc-atom without storing it.
+	//! Does not modify the object and may therefore be called concurrently by multiple threads.
+	//! Equal to \c fccQuaternion<FCC_NUMNEIGHBORS>().
+	//!\param[in,out] tierCounter Counts the method used for the quaternion extraction, may be \c nullptr.
+	//!\return \c false if no orientation could be determined.
+	bool fccQuaternion(const double * neighborPositions, unsigned char nNextNeighbors, double * q, QuaternionTierCounter * tierCounter = nullptr) const;
+	//!\brief Calculates the unique cubic quaternion of an atom with at most \c N nearest neighbors.
+	//! All intermediate data is kept in fixed-size buffers on the stack, no memory is allocated.
+	//!\return \c false if no orientation could be determined or more than \c N neighbors are given.
+	template<unsigned char N> bool fccQuaternion(const double * neighborPositions, unsigned char nNextNeighbors, double * q, QuaternionTierCounter * tierCounter = nullptr) const;
+	//!\brief Replaces the stored orientations by the ones of the atoms \c inAtoms.
+	//!\param[in] inAtoms Contiguous block of all atoms, the orientations are indexed by the position of an atom inside this block.
+	//!\param[in] nAtoms Number of atoms.
+	//!\param[in] quats Quaternion of each atom, 4 elements for each atom.
+	//!\param[in] valid Flag for each atom, whether it has an orientation.
+	void setOrientations(const Atom * inAtoms, long nAtoms, const double * quats, const bool * valid);
+	//!\brief Removes all orientations and tier counts and attaches the object to \c inBoxes.
+	//! The memory of the orientation store is kept for the next \c setOrientations().
+	void reset(AtomBox * inBoxes);
+	//!\return Whether an orientation has been found for the atom.
+	bool hasOrientation(const Atom * atom) const { return store.isValid(atom - atoms);};
+	//!\brief Copies the quaternion of an atom with orientation to \c q.
+	void getQuaternion(const Atom * atom, double * q) const { store.getQuaternion(atom - atoms, q);};
+	//!\return The orientations of all atoms.
+	const OrientationStore & getStore() const { return store;};
+	//!\return The number of atoms with an orientation.
 	long getNumOrientations() const;
-	void matrixToClosestQuaternion (const double * M, double * q);
-	void sortVectsList(double * vList, long nVects);
-	Orientation * getOrientations();
-	const Orientation * getOrientation(oID inOriId) const;
+	//!\brief Calculates the quaternion of the rotation closest to the matrix \c M.
+	//! Only distorted matrices are passed to the eigen solver, see \c QuaternionTier.
+	//!\return The method used.
+	QuaternionTier matrixToClosestQuaternion (const double * M, double * q) const;
+	//!\brief Calculates the quaternion of the rotation closest to the matrix \c M always by the eigen solver.
+	void eigenClosestQuaternion (const double * M, double * q) const;
+	bool closestQuaternion (const double * M, double * q, QuaternionTierCounter * tierCounter = nullptr) const;
+	//!\brief Adds the counts of quaternion extractions done outside of this object (e.g. by \c fccQuaternion()).
+	void addTierCounts(const QuaternionTierCounter & inTierCounter);
+	//!\return The number of quaternion extractions of each method.
+	const QuaternionTierCounter & getTierCounter() const { return tierCounter;};
+	//!\brief Sorts at most \c N vectors by a fixed linear combination of their coordinates (descending).
+	template<unsigned char N> void sortVectsList(double * vList, unsigned char nVects) const;
 	AtomBox * getBoxes();
 	double cosHalfMisOrientation(const Atom * atom1, const Atom * atom2) const;
 	double cubicCosHalfMisOrientation(const Atom *atom1, const Atom *atom2) const;
 	bool haveCloseOrientations(const Atom * atom1, const Atom * atom2, double cosHalfThreshold) const;
 
 private:
-	void init(AtomBox * boxes, unsigned long initCapacity);
-	oID calcOrientationFromThree100Directions(double * v100, double * v010, double * v001);
-	oID calcFCCOrientation_90Deg(double * v110, double * vm110);
-	oID calcFCCOrientation_60Deg(double * v110, double * v101);
+	bool quaternionFromThree100Directions(const double * v100, const double * v010, const double * v001, double * q, QuaternionTierCounter * tierCounter = nullptr) const;
+	bool polarDecomposition (const double * M, double * R) const;
 	//void inverseDirection(double * direct);
-	unsigned char reduceAntiparallelVectors(doubleP &vects, unsigned char n);
+	//!\brief Replaces each pair of (nearly) antiparallel vectors by their mean direction.
+	//!\param[in] vects The \c n vectors to reduce.
+	//!\param[out] redundant Flag for each vector, at least \c n elements must be accessible.
+	//!\param[out] outVects The reduced vectors, at least 3*\c n elements must be accessible.
+	//!\return The number of reduced vectors.
+	unsigned char reduceAntiparallelVectors(const double * vects, unsigned char n, bool * redundant, double * outVects) const;
 	unsigned char find60DegDirect(double * directs, unsigned char nDirects, unsigned char me);
 	unsigned char findPerpendDirect(double * directs, unsigned char nDirects, unsigned char me);
-	bool vectsArePerpend(double * v1, double * v2);
+	bool vectsArePerpend(const double * v1, const double * v2) const;
 	bool findBestPerpendPair(double * directs, unsigned char nDirects, unsigned char &v110Id, unsigned char &vm110Id);
-	oID closeOrientbyQuaternion(double * q);
-	oID newOrientbyQuaternion(double * q);
 	AtomBox * boxes = nullptr;
-	Orientation * orientations = nullptr;
-
-	unsigned long orientAlloc = ORIENTALLOC;
-	long nOrientations = 0;
-	long orientSize = 0;
+	//!atoms the orientations of the store belong to
+	const Atom * atoms = nullptr;
+	OrientationStore store;
+	QuaternionTierCounter tierCounter;
 };
 
+template<unsigned char N> bool Orientator::fccQuaternion(const double * neighborPositions, unsigned char nNextNeighbors, double * q, QuaternionTierCounter * inTierCounter) const{
+	if (nNextNeighbors > N) {
+		return false;
+	}
+	double unitVectors[N * DIM];
+	for(unsigned char i = 0; i < nNextNeighbors * DIM; i ++){
+		unitVectors[i] = neighborPositions[i];
+	}
+	ori::unitizeVectors(unitVectors, nNextNeighbors);
+	bool redundant[N];
+	double nextNborVects[N * DIM];
+	unsigned char nVects = reduceAntiparallelVectors(unitVectors, nNextNeighbors, redundant, nextNborVects);
+#ifndef DEBUGMODE
+	if (nVects < 6) {
+		return false;
+	}
+#else
+	if (nVects < 6) {
+	std::cout << "NO ORI BECAUSE OF nVects < 6" << std::endl;
+	return false;
+	}
+#endif
+	//each vector pair:
+	char iVec2;
+	char nPerpend = 0;
+	double normal100Vects[3*DIM];
+	//obtain <100> directions
+	//always 2 next-neighbor pairs which are perpendicular lay inside a {100} plane
+	//the normal vector is obtained by calculating the cross product
+	for (char iVec = 0; iVec < nVects; iVec++){
+		if (3 == nPerpend) break;
+		for (iVec2 = iVec + 1; iVec2 < nVects; iVec2++){
+			if( vectsArePerpend(nextNborVects + DIM * iVec, nextNborVects + DIM * iVec2) )
+			{
+				ori::crossProduct(nextNborVects + DIM * iVec, nextNborVects + DIM * iVec2, normal100Vects + DIM * nPerpend);
+				if(3 == ++nPerpend){
+					break;
+				}
+			}
+		}
+	}
+	if (nPerpend < 3) {
+		//not enough perpend directions found
+		return false;
+	}
+	return quaternionFromThree100Directions(normal100Vects, normal100Vects + DIM, normal100Vects + 2*DIM, q, inTierCounter);
+}
+
+template<unsigned char N> void Orientator::sortVectsList(double * vList, unsigned char nVects) const{
+	if (nVects > N) {
+		return;
+	}
+	double * vects[N];
+	double sortedValues[N * DIM];
+	for (unsigned char i = 0; i < nVects; i++){
+		vects[i] = vList + i*DIM;
+	}
+	std::sort(vects,vects + nVects,[](const double * vA, const double * vB){ return (7*vA[0] + 41*vA[1] + vA[2]) > (7*vB[0] + 41*vB[1] + vB[2]); });
+	for (unsigned char i = 0; i < nVects; i++){
+		sortedValues[i*DIM] = vects[i][0];
+		sortedValues[i*DIM+1] = vects[i][1];
+		sortedValues[i*DIM+2] = vects[i][2];
+	}
+	for (long i = 0; i < nVects * DIM; i++){
+		vList[i] = sortedValues[i];
+	}
+}
+
 class OrientatorPrinter {
 public:
 	OrientatorPrinter(const Orientator * inOrient, const std::string inFileName);
@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "OrientatorFileQueue.h"
+#include <map>
 
 OrientatorFileQueue::OrientatorFileQueue() {
 	curFileNum = 0;
@@ -84,6 +85,14 @@ void OrientatorFileQueue::setDirectory(std::string inDirName){
 
 void OrientatorFileQueue::decomposePostFix(std::string inPostFix) {
 	size_t dotPos = inPostFix.rfind('.');
+	//the ending of a compressed file includes the ending of the plain file, e.g. ".cfg.gz"
+	if(dotPos != std::string::npos && dotPos > 0) {
+		std::string compressionEnding = inPostFix.substr(dotPos, std::string::npos);
+		if(compressionEnding == ".gz" || compressionEnding == ".zst") {
+			size_t plainDotPos = inPostFix.rfind('.', dotPos - 1);
+			if(plainDotPos != std::string::npos) dotPos = plainDotPos;
+		}
+	}
 	fileNamePostFix = inPostFix.substr(0,dotPos);
 	fileNameEnding = inPostFix.substr(dotPos, std::string::npos);
 }
@@ -128,6 +137,136 @@ void OrientatorFileQueue::sortFilesByNumber(){
 	for(int i = 0; i < fileNameIds.size(); i++){
 		fileNameIds[i] = fileNumbers[i].prefix +  fileNumbers[i].number +  fileNumbers[i].postfix;
 	}
+	inputFileNameIds = fileNameIds;
+	frames.assign(fileNameIds.size(), FrameInfo());
+	shardFileNameIds.assign(fileNameIds.size(), std::vector<std::string>());
+}
+
+void OrientatorFileQueue::groupShards(){
+	std::vector<FileNameID> groupNumbers;
+	std::vector<std::string> groupNameIds;
+	std::vector<std::string> groupInputFileNameIds;
+	std::vector<std::vector<std::pair<long, std::string> > > groupShards;
+	std::map<std::string, int> groupOfTimeStep;
+	for(int i = 0; i < fileNameIds.size(); i++){
+		const FileNameID & id = fileNumbers[i];
+		//the postfix of the id of a shard consists of one separator and the rank
+		bool isShard = id.isNumber && id.postfix.length() > 1 && !isdigit(id.postfix[0])
+				&& id.postfix.find_first_not_of("0123456789", 1) == std::string::npos;
+		if(!isShard){
+			groupNumbers.push_back(id);
+			groupNameIds.push_back(fileNameIds[i]);
+			groupInputFileNameIds.push_back(inputFileNameIds[i]);
+			groupShards.push_back(std::vector<std::pair<long, std::string> >());
+			continue;
+		}
+		std::string timeStepId = id.prefix + id.number;
+		std::map<std::string, int>::iterator group = groupOfTimeStep.find(timeStepId);
+		if(group == groupOfTimeStep.end()){
+			group = groupOfTimeStep.insert(std::make_pair(timeStepId, int(groupNumbers.size()))).first;
+			FileNameID groupId = id;
+			groupId.postfix = "";
+			groupNumbers.push_back(groupId);
+			groupNameIds.push_back(timeStepId);
+			groupInputFileNameIds.push_back("");
+			groupShards.push_back(std::vector<std::pair<long, std::string> >());
+		}
+		groupShards[group->second].push_back(std::make_pair(atol(id.postfix.c_str() + 1), inputFileNameIds[i]));
+	}
+	shardFileNameIds.assign(groupNumbers.size(), std::vector<std::string>());
+	for(int iG = 0; iG < groupNumbers.size(); iG++){
+		if(groupShards[iG].empty()) continue;
+		std::sort(groupShards[iG].begin(), groupShards[iG].end());
+		groupInputFileNameIds[iG] = groupShards[iG].front().second;
+		if(groupShards[iG].size() == 1) continue;
+		for(int iS = 0; iS < groupShards[iG].size(); iS++){
+			shardFileNameIds[iG].push_back(groupShards[iG][iS].second);
+		}
+	}
+	fileNumbers.swap(groupNumbers);
+	fileNameIds.swap(groupNameIds);
+	inputFileNameIds.swap(groupInputFileNameIds);
+	frames.assign(fileNameIds.size(), FrameInfo());
+}
+
+int OrientatorFileQueue::getNumShards(int fileNum) const{
+	return std::max<int>(shardFileNameIds[fileNum].size(), 1);
+}
+
+std::string OrientatorFileQueue::shardFileName(int fileNum, int shardNum) const{
+	if(shardFileNameIds[fileNum].empty()){
+		return subDirectoryName + fileNamePreFix + inputFileNameIds[fileNum] + fileNamePostFix + fileNameEnding;
+	}
+	return subDirectoryName + fileNamePreFix + shardFileNameIds[fileNum][shardNum] + fileNamePostFix + fileNameEnding;
+}
+
+void OrientatorFileQueue::initStream(std::string streamName){
+	subDirectoryName = "";
+	fileNamePreFix = streamName;
+	fileNamePostFix = "";
+	fileNameEnding = "";
+}
+
+void OrientatorFileQueue::addStreamFrame(int frameNum){
+	std::string frameId = std::to_string(frameNum);
+	FileNameID frameFileId;
+	frameFileId.number = frameId;
+	frameFileId.isNumber = true;
+	fileNumbers.push_back(frameFileId);
+	fileNameIds.push_back(frameId);
+	//a frame has no file of its own, its "file name" is the stream followed by the number of the frame
+	inputFileNameIds.push_back(":" + frameId);
+	frames.push_back(FrameInfo());
+	shardFileNameIds.push_back(std::vector<std::string>());
+	curFileNum = fileNameIds.size() - 1;
+}
+
+void OrientatorFileQueue::splitIntoFrames(const std::vector<std::vector<FrameInfo> > & fileFrames){
+	bool hasSeveralFrames = false;
+	bool increasingTimeSteps = true;
+	bool isFirstFrame = true;
+	long long prevTimeStep = 0;
+	for(int iF = 0; iF < fileFrames.size(); iF++){
+		if(fileFrames[iF].size() > 1) hasSeveralFrames = true;
+		for(int iFrame = 0; iFrame < fileFrames[iF].size(); iFrame++){
+			if(!isFirstFrame && fileFrames[iF][iFrame].timeStep <= prevTimeStep) increasingTimeSteps = false;
+			prevTimeStep = fileFrames[iF][iFrame].timeStep;
+			isFirstFrame = false;
+		}
+	}
+	if(!hasSeveralFrames) return;
+	std::vector<FileNameID> frameNumbers;
+	std::vector<std::string> frameNameIds;
+	std::vector<std::string> frameInputFileNameIds;
+	std::vector<FrameInfo> fileFramesInQueue;
+	std::vector<std::vector<std::string> > frameShardFileNameIds;
+	long long frameNum = 0;
+	for(int iF = 0; iF < fileFrames.size(); iF++){
+		for(int iFrame = 0; iFrame < fileFrames[iF].size(); iFrame++, frameNum++){
+			long long frameId = increasingTimeSteps ? fileFrames[iF][iFrame].timeStep : frameNum;
+			if(frameId < startFileNum || frameId > endFileNum) continue;
+			FileNameID curFrameId;
+			curFrameId.prefix = "";
+			curFrameId.number = std::to_string(frameId);
+			curFrameId.postfix = "";
+			curFrameId.isNumber = true;
+			frameNumbers.push_back(curFrameId);
+			frameNameIds.push_back(curFrameId.number);
+			frameInputFileNameIds.push_back(inputFileNameIds[iF]);
+			frameShardFileNameIds.push_back(shardFileNameIds[iF]);
+			//a file with one frame is read completely
+			fileFramesInQueue.push_back(fileFrames[iF].size() > 1 ? fileFrames[iF][iFrame] : FrameInfo());
+		}
+	}
+	fileNumbers.swap(frameNumbers);
+	fileNameIds.swap(frameNameIds);
+	inputFileNameIds.swap(frameInputFileNameIds);
+	frames.swap(fileFramesInQueue);
+	shardFileNameIds.swap(frameShardFileNameIds);
+}
+
+const FrameInfo & OrientatorFileQueue::getFrame(int fileNum) const{
+	return frames[fileNum];
 }
 
 void OrientatorFileQueue::adjustSubDirectoryName(){
@@ -145,14 +284,14 @@ std::string OrientatorFileQueue::nextFileName()
 }
 
 std::string OrientatorFileQueue::curFileName() const {
-	return subDirectoryName + fileNamePreFix + fileNameIds[curFileNum] + fileNamePostFix + fileNameEnding;
+	return subDirectoryName + fileNamePreFix + inputFileNameIds[curFileNum] + fileNamePostFix + fileNameEnding;
 }
 
 std::string OrientatorFileQueue::previousFileName() const{
 	if (curFileNum == 0 ){
 		return "";
 	}
-	return subDirectoryName + fileNamePreFix + fileNameIds[curFileNum-1] + fileNamePostFix + fileNameEnding;
+	return subDirectoryName + fileNamePreFix + inputFileNameIds[curFileNum-1] + fileNamePostFix + fileNameEnding;
 }
 
 int OrientatorFileQueue::numFiles() const {
@@ -172,6 +311,9 @@ bool OrientatorFileQueue::addFile(std::string fileName, bool softMode) {
 	}
 	//fileName must end with postfix and ending
 	std::string totalPostFix = fileNamePostFix+fileNameEnding;
+	if(fileName.length() < fileNamePreFix.length() + totalPostFix.length()){
+		return false;
+	}
 	pos = fileName.rfind(totalPostFix);
 	if(pos != fileName.length() - totalPostFix.length()){
 		return false;
@@ -196,6 +338,9 @@ bool OrientatorFileQueue::addFile(std::string fileName, bool softMode) {
 	}
 	//Otherwise add file to list
 	fileNameIds.push_back(curFileIdString);
+	inputFileNameIds.push_back(curFileIdString);
+	frames.push_back(FrameInfo());
+	shardFileNameIds.push_back(std::vector<std::string>());
 	fileNumbers.push_back(curFileId);
 	return true;
 }
@@ -268,7 +413,7 @@ std::string OrientatorFileQueue::fileName(int fileNum){
 	if (fileNum < 0 ) return "";
 	if (fileNum >= fileNameIds.size()) return "";
 	curFileNum = fileNum;
-	return subDirectoryName + fileNamePreFix + fileNameIds[fileNum] + fileNamePostFix + fileNameEnding;
+	return subDirectoryName + fileNamePreFix + inputFileNameIds[fileNum] + fileNamePostFix + fileNameEnding;
 }
 
 std::string OrientatorFileQueue::getFileNamePreFix() const {
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef ORIENTATORFILEQUEUE_H_
 #define ORIENTATORFILEQUEUE_H_
 #include "GradeA_Defs.h"
+#include "io/FrameIndex.h"
 #ifdef _MSC_VER
 	#include <windows.h>
 #else
@@ -39,6 +40,24 @@ public:
 	void softFindFiles();
 	void autoFindFiles();
 	void sortFilesByNumber();
+	//!\brief Replaces the files with several frames by one entry per frame, \c fileFrames holds the frames of each file.
+	//! If any file has several frames, all frames are named by their time steps, if these increase over all files,
+	//! else by their number in the queue, and only frames with a name between startFileNum and endFileNum are kept.
+	void splitIntoFrames(const std::vector<std::vector<FrameInfo> > & fileFrames);
+	//!\return The frame of the entry \c fileNum, which covers the whole file, if the file has not been split.
+	const FrameInfo & getFrame(int fileNum) const;
+	//!\brief Merges the files of one frame written per rank (shards) into one entry.
+	//! A shard is a file, whose id is a number (the time step) followed by a separator and the rank, e.g. "dump.1000.3.cfg".
+	//! The shards of a time step are ordered by their rank, the entry is named by the time step.
+	void groupShards();
+	//!\return The number of shards of the entry \c fileNum, 1 for a single file.
+	int getNumShards(int fileNum) const;
+	//!\return The file name of the shard \c shardNum of the entry \c fileNum.
+	std::string shardFileName(int fileNum, int shardNum) const;
+	//!\brief Prepares the queue for the frames of a stream, the output files are named by \c streamName.
+	void initStream(std::string streamName);
+	//!\brief Appends the next frame of a stream, which is named by its number in the stream.
+	void addStreamFrame(int frameNum);
 	std::string nextFileName();
 	std::string curFileName() const;
 	std::string previousFileName() const;
@@ -73,6 +92,11 @@ private:
 	std::string fileNameEnding = "";
 	std::vector<FileNameID> fileNumbers;
 	std::vector<std::string> fileNameIds;
+	//id of the input file of each entry, which differs from fileNameIds for the frames of a file
+	std::vector<std::string> inputFileNameIds;
+	std::vector<FrameInfo> frames;
+	//ids of the input files of the entries, which consist of several shards, empty for a single file
+	std::vector<std::vector<std::string> > shardFileNameIds;
 	std::string subDirectoryName;
 	int curFileNum;
 	//
@@ -0,0 +1,193 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "RunPlan.h"
+#include "Atom.h"
+#include <algorithm>
+#include <iomanip>
+#if !defined(WINDOWS) || defined(CYGWIN)
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+RunPlan::RunPlan(const PropertySelection & inSelection, bool inUseNeighborList) {
+	selection = inSelection;
+	useNeighborList = inUseNeighborList;
+}
+
+void RunPlan::build(const OrientatorFileQueue & queue) {
+	entries.assign(queue.numFiles(), RunPlanEntry());
+	//the headers are small, reading them is limited by the latency of opening the files
+#pragma omp parallel for schedule(dynamic,1)
+	for (int iF = 0; iF < queue.numFiles(); iF++) {
+		RunPlanEntry & entry = entries[iF];
+		entry.fileName = queue.shardFileName(iF, 0);
+		entry.numShards = queue.getNumShards(iF);
+		if (queue.getFrame(iF).length >= 0) entry.frameName = queue.getFileNameId(iF);
+		try {
+			for (int iS = 0; iS < entry.numShards; iS++) {
+				InputHeader header;
+				readInputHeader(queue.shardFileName(iF, iS), queue.getFrame(iF), header);
+				if (iS == 0) {
+					//all shards share the box of the first shard
+					std::copy(header.size, header.size + DIM, entry.size);
+					entry.propertyNames = header.propertyNames;
+				} else if (header.propertyNames != entry.propertyNames) {
+					throw Exception("shard \"" + queue.shardFileName(iF, iS) + "\" has other properties than the first shard");
+				}
+				entry.numAtoms += header.numAtoms;
+			}
+			if (entry.numAtoms == 0) {
+				entry.error = "no atoms";
+			}
+		} catch (const std::exception & e) {
+			entry.error = e.what();
+		}
+		//the file of a frame is mapped only in the range of the frame
+		const FrameInfo & frame = queue.getFrame(iF);
+		for (int iS = 0; iS < entry.numShards; iS++) {
+			if (frame.length >= 0) {
+				entry.inputBytes += frame.length;
+				continue;
+			}
+#if !defined(WINDOWS) || defined(CYGWIN)
+			struct stat fileStat;
+			if (stat(queue.shardFileName(iF, iS).c_str(), &fileStat) == 0) entry.inputBytes += fileStat.st_size;
+#endif
+		}
+		estimate(entry);
+	}
+	//the properties of all entries are compared with the ones of the first readable entry
+	inconsistentEntries.clear();
+	int firstEntry = -1;
+	for (int iF = 0; iF < entries.size(); iF++) {
+		if (!entries[iF].error.empty()) continue;
+		if (firstEntry < 0) {
+			firstEntry = iF;
+		} else if (entries[iF].propertyNames != entries[firstEntry].propertyNames) {
+			inconsistentEntries.push_back(iF);
+		}
+	}
+	//longest processing time first: the expensive entries are started first, the cheap ones fill the gaps at the end
+	schedule.resize(entries.size());
+	for (int iF = 0; iF < entries.size(); iF++) schedule[iF] = iF;
+	std::stable_sort(schedule.begin(), schedule.end(), [this](int a, int b) {
+		return entries[a].cost > entries[b].cost;
+	});
+}
+
+void RunPlan::readInputHeader(std::string fileName, const FrameInfo & frame, InputHeader & header) const {
+	FileImporter * import = FileImporter::create(fileName, nullptr);
+	if (import == nullptr) {
+		throw Exception("unsupported format");
+	}
+	try {
+		import->setFrame(frame);
+		import->setPropertySelection(selection);
+		import->readHeader(header);
+	} catch (EndOfFile &) {
+		delete import;
+		throw Exception("incomplete header");
+	} catch (...) {
+		delete import;
+		throw;
+	}
+	delete import;
+}
+
+//the parts of the atom data: position columns, atom ids, permutation of the cell list,
+//quaternion and validity of the atom, orientation store and grain membership
+#define RUNPLAN_POSITIONBYTES (DIM * sizeof(posType))
+#define RUNPLAN_ORDERBYTES (2 * sizeof(long))
+#define RUNPLAN_ORIENTATIONBYTES (8 * sizeof(double) + sizeof(bool))
+#define RUNPLAN_MEMBERSHIPBYTES (sizeof(Atom *))
+
+long RunPlan::atomDataBytes() {
+	return RUNPLAN_POSITIONBYTES + sizeof(Atom) + RUNPLAN_ORDERBYTES + RUNPLAN_ORIENTATIONBYTES + RUNPLAN_MEMBERSHIPBYTES;
+}
+
+void RunPlan::printAtomDataBytes() {
+#ifdef COMPACT_MEMORY
+	std::cout << "Compact memory mode: ";
+#endif
+	std::cout << "Memory per atom: " << RUNPLAN_POSITIONBYTES << " B position + " << sizeof(Atom) << " B orientation and grain id + "
+		<< RUNPLAN_ORDERBYTES << " B cell list order + " << RUNPLAN_ORIENTATIONBYTES << " B orientation + "
+		<< RUNPLAN_MEMBERSHIPBYTES << " B grain membership = " << atomDataBytes() << " B" << std::endl;
+}
+
+void RunPlan::estimate(RunPlanEntry & entry) const {
+	double bytesPerAtom = RUNPLAN_BYTESPERATOM + atomDataBytes() + RUNPLAN_BYTESPERPROPERTY * entry.propertyNames.size();
+	if (useNeighborList) bytesPerAtom += RUNPLAN_NEIGHBORLISTBYTESPERATOM;
+	entry.memoryBytes = bytesPerAtom * entry.numAtoms + entry.inputBytes;
+	//the orientations and the grains are computed per atom
+	entry.cost = entry.numAtoms;
+}
+
+int RunPlan::getMaxFileThreads(int numThreads) const {
+	double availableBytes = 0.;
+#if !defined(WINDOWS) || defined(CYGWIN)
+	availableBytes = RUNPLAN_MEMORYFRACTION * double(sysconf(_SC_PHYS_PAGES)) * double(sysconf(_SC_PAGESIZE));
+#endif
+	if (availableBytes <= 0.) return numThreads;
+	//the largest entries might be computed at the same time, each by its own thread
+	std::vector<double> memory(entries.size());
+	for (int iF = 0; iF < entries.size(); iF++) memory[iF] = entries[iF].memoryBytes;
+	std::sort(memory.begin(), memory.end(), std::greater<double>());
+	int numFileThreads = 0;
+	double usedBytes = 0.;
+	while (numFileThreads < numThreads && numFileThreads < memory.size()
+			&& usedBytes + memory[numFileThreads] <= availableBytes) {
+		usedBytes += memory[numFileThreads];
+		numFileThreads++;
+	}
+	return std::max(numFileThreads, 1);
+}
+
+void RunPlan::print(bool listEntries) const {
+	long long totalAtoms = 0;
+	double maxMemory = 0.;
+	int numErrors = 0;
+	for (int iF = 0; iF < entries.size(); iF++) {
+		const RunPlanEntry & entry = entries[iF];
+		totalAtoms += entry.numAtoms;
+		maxMemory = std::max(maxMemory, entry.memoryBytes);
+		if (!entry.error.empty()) {
+			numErrors++;
+			std::cerr << "Header of file \"" << entry.fileName << "\" cannot be used: " << entry.error << std::endl;
+		}
+	}
+	for (int iF : inconsistentEntries) {
+		std::cerr << "File \"" << entries[iF].fileName << "\" has other atom properties than the first file." << std::endl;
+	}
+	if (listEntries) {
+		std::cout << "Run plan (in the order of computation):" << std::endl;
+		for (int iF : schedule) {
+			const RunPlanEntry & entry = entries[iF];
+			std::cout << std::setw(6) << iF << " \"" << entry.fileName << "\"";
+			if (!entry.frameName.empty()) std::cout << " frame " << entry.frameName;
+			if (entry.numShards > 1) std::cout << " (" << entry.numShards << " shards)";
+			std::cout << ": " << entry.numAtoms << " atoms, box " << entry.size[0] << " x " << entry.size[1] << " x " << entry.size[2]
+				<< ", " << entry.propertyNames.size() << " properties, ~" << std::fixed << std::setprecision(1)
+				<< entry.memoryBytes / 1.e6 << " MB" << std::defaultfloat << std::setprecision(6) << std::endl;
+		}
+	}
+	std::cout << "Planned " << entries.size() << " files with " << totalAtoms << " atoms, the largest needs ~"
+		<< std::fixed << std::setprecision(1) << maxMemory / 1.e6 << " MB" << std::defaultfloat << std::setprecision(6);
+	if (numErrors > 0) std::cout << ", " << numErrors << " files cannot be read";
+	std::cout << "." << std::endl;
+}
@@ -0,0 +1,88 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RUNPLAN_H_
+#define RUNPLAN_H_
+#include "GradeA_Defs.h"
+#include "OrientatorFileQueue.h"
+#include "io/FileImporter.h"
+
+//estimated memory of a computation per atom besides the atom data (see RunPlan::atomDataBytes()):
+//buffers for reading and sorting, orientation and grain identification, per stored property and of the neighbor list
+#define RUNPLAN_BYTESPERATOM 190
+#define RUNPLAN_BYTESPERPROPERTY 16
+#define RUNPLAN_NEIGHBORLISTBYTESPERATOM 410
+//part of the physical memory, which may be used by the files computed at the same time
+#define RUNPLAN_MEMORYFRACTION 0.8
+
+//!\brief Planned computation of one entry (file, frame or group of shards) of the file queue.
+struct RunPlanEntry {
+	//!name of the (first) input file and its number of shards
+	std::string fileName;
+	int numShards = 1;
+	//!name of the frame, if the entry is a frame of a file with several frames
+	std::string frameName;
+	long numAtoms = 0;
+	double size[DIM] = {0., 0., 0.};
+	std::vector<std::string> propertyNames;
+	//!bytes of the input, which are mapped while parsing
+	long long inputBytes = 0;
+	//!estimated peak memory of the computation in bytes
+	double memoryBytes = 0.;
+	//!estimated compute time, in units of the time per atom
+	double cost = 0.;
+	//!problem found in the headers, empty if there is none
+	std::string error;
+};
+
+//!\brief Plan of a run, which is built from the headers of all input files before any file is computed.
+//! The headers are read in parallel, without parsing the atoms. The plan holds the number of atoms,
+//! the estimated memory and compute cost of each entry, reports inconsistent headers before the computation
+//! and gives the order and the number of files computed at the same time.
+class RunPlan {
+public:
+	RunPlan(const PropertySelection & inSelection, bool inUseNeighborList);
+	~RunPlan(){};
+	//!\brief Reads the headers of all entries of the queue (of each shard and of each frame).
+	void build(const OrientatorFileQueue & queue);
+	//!\brief Prints the problems found in the headers and a summary of the plan.
+	//!\param[in] listEntries Whether each entry is printed, as done for a dry run.
+	void print(bool listEntries) const;
+	//!\return The entry numbers ordered by decreasing cost, so that the largest files are started first.
+	const std::vector<int> & getSchedule() const { return schedule;};
+	//!\return The number of files, which fit into the memory at the same time, at most \c numThreads.
+	int getMaxFileThreads(int numThreads) const;
+	const RunPlanEntry & getEntry(int fileNum) const { return entries[fileNum];};
+	//!\return The bytes stored for each atom during the whole computation: position, ids, order in the cell list, orientation and grain membership.
+	static long atomDataBytes();
+	//!\brief Prints the parts of \c atomDataBytes(), which depend on the memory mode of the build.
+	static void printAtomDataBytes();
+private:
+	//!\brief Reads the header of a single input file.
+	//! Throws an \c Exception if the file has an unsupported format or an invalid header.
+	void readInputHeader(std::string fileName, const FrameInfo & frame, InputHeader & header) const;
+	void estimate(RunPlanEntry & entry) const;
+	PropertySelection selection;
+	bool useNeighborList;
+	std::vector<RunPlanEntry> entries;
+	std::vector<int> schedule;
+	//!entries, whose properties differ from the ones of the first readable entry
+	std::vector<int> inconsistentEntries;
+};
+
+#endif /* RUNPLAN_H_ */
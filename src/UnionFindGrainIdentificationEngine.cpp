@@ -0,0 +1,330 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "UnionFindGrainIdentificationEngine.h"
+
+UnionFindGrainIdentificationEngine::UnionFindGrainIdentificationEngine(Orientator * inOrient, AtomBox * inBoxes, long inNumBoxes, unsigned char inNumMaxAtomNeighbors) {
+	orient = inOrient;
+	boxes = inBoxes;
+	numBoxes = inNumBoxes;
+	nMaxAtomNeighbors = inNumMaxAtomNeighbors;
+}
+
+UnionFindGrainIdentificationEngine::~UnionFindGrainIdentificationEngine() {
+	delete [] parents;
+}
+
+void UnionFindGrainIdentificationEngine::setSearchRadiiSquared(double inRsqrMin, double inRsqrMax) {
+	rSqrMin = inRsqrMin;
+	rSqrMax = inRsqrMax;
+}
+
+void UnionFindGrainIdentificationEngine::setContainerGeometry(const double * inSize, bool inPeriodic) {
+	size[0] = inSize[0];
+	size[1] = inSize[1];
+	size[2] = inSize[2];
+	periodic = inPeriodic;
+}
+
+void UnionFindGrainIdentificationEngine::setNeighborList(const NeighborList * inNeighborList) {
+	neighborList = inNeighborList;
+}
+
+void UnionFindGrainIdentificationEngine::init() {
+	//atoms are numbered box by box
+	atomOffsets.assign(numBoxes + 1, 0);
+	for (long iB = 0; iB < numBoxes; iB++) {
+		atomOffsets[iB + 1] = atomOffsets[iB] + boxes[iB].getNumAtoms();
+	}
+	numAtoms = atomOffsets[numBoxes];
+	delete [] parents;
+	parents = new std::atomic<long>[numAtoms];
+	for (long i = 0; i < numAtoms; i++) {
+		parents[i].store(i, std::memory_order_relaxed);
+	}
+	rejected.assign(numAtoms, false);
+}
+
+long UnionFindGrainIdentificationEngine::run(double angularThreshold, long minGrainSize, std::vector<Grain *> & outGrains) {
+	cosHalfThreshold = ori::cosHalfFromRad(angularThreshold);
+	bigCosHalfThreshold = ori::cosHalfFromRad(3 * angularThreshold);
+	init();
+	//local criterion: connect all similar oriented neighbors
+#pragma omp parallel for schedule(dynamic,16)
+	for (long iB = 0; iB < numBoxes; iB++) {
+		connectNeighbors(iB, false);
+	}
+	//global criterion: disconnect atoms deviating from their component's mean orientation
+	applyGlobalCriterion();
+	long numGrainsBefore = outGrains.size();
+	buildGrains(minGrainSize, outGrains);
+	delete [] parents;
+	parents = nullptr;
+	return outGrains.size() - numGrainsBefore;
+}
+
+void UnionFindGrainIdentificationEngine::connectNeighbors(long iB, bool restricted) {
+	AtomBox * box = boxes + iB;
+	AtomBoxP nborBoxes[12];
+	long nborAtomIds[12];
+	double nborPositions[12*DIM];
+	unsigned char nNeighbors;
+	long curNum, nborNum;
+	long nborNums[12];
+	Atom * atom;
+	Atom * nborAtom;
+	for (long iA = 0; iA < box->getNumAtoms(); iA++) {
+		atom = box->getAtom(iA);
+		if (!orient->hasOrientation(atom)) {
+			continue;
+		}
+		curNum = atomNum(box, iA);
+		if (restricted && (rejected[curNum] || components[curNum] == NO_GRAIN)) {
+			continue;
+		}
+		//the atom numbers of the neighbor list are equal to the ones used here
+		if (neighborList) {
+			nNeighbors = neighborList->getShellNeighbors(curNum, nMaxAtomNeighbors, nborNums);
+		} else {
+			nNeighbors = box->atomNeighbors(iA, rSqrMin, rSqrMax, nMaxAtomNeighbors, nborBoxes, nborAtomIds, nborPositions);
+			for (unsigned char iN = 0; iN < nNeighbors; iN++) {
+				nborNums[iN] = atomNum(nborBoxes[iN], nborAtomIds[iN]);
+			}
+		}
+		for (unsigned char iN = 0; iN < nNeighbors; iN++) {
+			//pairs are tested from both sides, as an atom with too many neighbors has an empty neighbor list
+			nborNum = nborNums[iN];
+			nborAtom = neighborList ? neighborList->getAtom(nborNum) : nborBoxes[iN]->getAtom(nborAtomIds[iN]);
+			if (!orient->hasOrientation(nborAtom)) {
+				continue;
+			}
+			if (restricted && (rejected[nborNum] || components[nborNum] != components[curNum])) {
+				continue;
+			}
+			if (orient->haveCloseOrientations(atom, nborAtom, cosHalfThreshold)) {
+				unite(curNum, nborNum);
+			}
+		}
+	}
+}
+
+void UnionFindGrainIdentificationEngine::applyGlobalCriterion() {
+	components.resize(numAtoms);
+	//dense numbering of the components, roots are always the atoms with the lowest number
+	std::vector<long> componentNums(numAtoms, NO_GRAIN);
+	long numComponents = 0;
+	for (long i = 0; i < numAtoms; i++) {
+		long root = find(i);
+		if (root == i) {
+			componentNums[i] = numComponents++;
+		}
+		components[i] = componentNums[root];
+	}
+	//sum up the quaternions of each component
+	std::vector<double> qSums(4 * numComponents, 0.);
+	double q[4];
+	for (long iB = 0; iB < numBoxes; iB++) {
+		for (long iA = 0; iA < boxes[iB].getNumAtoms(); iA++) {
+			const Atom * atom = boxes[iB].getAtom(iA);
+			if (!orient->hasOrientation(atom)) {
+				continue;
+			}
+			orient->getQuaternion(atom, q);
+			double * qSum = qSums.data() + 4 * components[atomOffsets[iB] + iA];
+			qSum[0] += q[0];
+			qSum[1] += q[1];
+			qSum[2] += q[2];
+			qSum[3] += q[3];
+		}
+	}
+	for (long iC = 0; iC < numComponents; iC++) {
+		double * qSum = qSums.data() + 4 * iC;
+		double length = sqrt(SQR(qSum[0]) + SQR(qSum[1]) + SQR(qSum[2]) + SQR(qSum[3]));
+		if (length > 0.) {
+			qSum[0] /= length;
+			qSum[1] /= length;
+			qSum[2] /= length;
+			qSum[3] /= length;
+		}
+	}
+	//reject atoms deviating too much from the mean orientation
+	std::vector<char> isAffected(numComponents, false);
+	long numRejected = 0;
+#pragma omp parallel for schedule(dynamic,16) reduction(+:numRejected)
+	for (long iB = 0; iB < numBoxes; iB++) {
+		double q[4];
+		for (long iA = 0; iA < boxes[iB].getNumAtoms(); iA++) {
+			const Atom * atom = boxes[iB].getAtom(iA);
+			if (!orient->hasOrientation(atom)) {
+				continue;
+			}
+			long curNum = atomOffsets[iB] + iA;
+			orient->getQuaternion(atom, q);
+			if (!ori::haveCloseOrientations(qSums.data() + 4 * components[curNum], q, bigCosHalfThreshold)) {
+				rejected[curNum] = true;
+				isAffected[components[curNum]] = true;
+				numRejected++;
+			}
+		}
+	}
+	if (numRejected == 0) {
+		return;
+	}
+	//rebuild the affected components without the rejected atoms, they may split up
+	for (long i = 0; i < numAtoms; i++) {
+		if (isAffected[components[i]]) {
+			parents[i].store(i, std::memory_order_relaxed);
+		} else {
+			components[i] = NO_GRAIN;
+		}
+	}
+#pragma omp parallel for schedule(dynamic,16)
+	for (long iB = 0; iB < numBoxes; iB++) {
+		connectNeighbors(iB, true);
+	}
+}
+
+void UnionFindGrainIdentificationEngine::buildGrains(long minGrainSize, std::vector<Grain *> & outGrains) {
+	std::vector<long> componentSizes(numAtoms, 0);
+	for (long i = 0; i < numAtoms; i++) {
+		componentSizes[find(i)]++;
+	}
+	//grain id for each root atom
+	std::vector<gID> grainIds(numAtoms, NO_GRAIN);
+	long firstGrain = outGrains.size();
+	Atom * atom;
+	for (long iB = 0; iB < numBoxes; iB++) {
+		for (long iA = 0; iA < boxes[iB].getNumAtoms(); iA++) {
+			long curNum = atomOffsets[iB] + iA;
+			long root = find(curNum);
+			if (componentSizes[root] <= minGrainSize || rejected[curNum]) {
+				continue;
+			}
+			if (grainIds[root] == NO_GRAIN) {
+				grainIds[root] = outGrains.size();
+				outGrains.push_back(new Grain());
+				//the size of the grain is known, so that its atom list is not grown by doubling
+				outGrains.back()->reserve(componentSizes[root]);
+			}
+			atom = boxes[iB].getAtom(iA);
+			atom->setGrainId(grainIds[root]);
+			outGrains[grainIds[root]]->add(atom, orient);
+		}
+	}
+	calculateCenters(firstGrain, outGrains);
+	for (long iG = firstGrain; iG < outGrains.size(); iG++) {
+		outGrains[iG]->recalculateMeanOrientation();
+		std::cout << "Thread " << omp_get_thread_num() << ": Found grain " << iG << " with " << outGrains[iG]->getNumberOfAtoms() << " atoms" << std::endl;
+	}
+}
+
+void UnionFindGrainIdentificationEngine::calculateCenters(long firstGrain, std::vector<Grain *> & grains) const {
+	long numNewGrains = grains.size() - firstGrain;
+	//reference position of each grain, to which the atom positions are unwrapped
+	std::vector<double> refPositions(DIM * numNewGrains, 0.);
+	double pos[DIM];
+	double d;
+	gID grainId;
+	if (periodic) {
+		//circular mean in each direction, which does not depend on the order of the atoms
+		std::vector<double> trigSums(2 * DIM * numNewGrains, 0.);
+		for (long iB = 0; iB < numBoxes; iB++) {
+			for (long iA = 0; iA < boxes[iB].getNumAtoms(); iA++) {
+				grainId = boxes[iB].getAtom(iA)->getGrainId();
+				if (grainId < firstGrain) {
+					continue;
+				}
+				boxes[iB].obtainGlobalAtomPos(iA, pos);
+				double * trigSum = trigSums.data() + 2 * DIM * (grainId - firstGrain);
+				for (char i = 0; i < DIM; i++) {
+					trigSum[2 * i] += cos(2. * PI * pos[i] / size[i]);
+					trigSum[2 * i + 1] += sin(2. * PI * pos[i] / size[i]);
+				}
+			}
+		}
+		for (long iG = 0; iG < numNewGrains; iG++) {
+			for (char i = 0; i < DIM; i++) {
+				refPositions[DIM * iG + i] = size[i] / (2. * PI)
+						* atan2(trigSums[2 * DIM * iG + 2 * i + 1], trigSums[2 * DIM * iG + 2 * i]);
+			}
+		}
+	}
+	for (long iB = 0; iB < numBoxes; iB++) {
+		for (long iA = 0; iA < boxes[iB].getNumAtoms(); iA++) {
+			grainId = boxes[iB].getAtom(iA)->getGrainId();
+			if (grainId < firstGrain) {
+				continue;
+			}
+			boxes[iB].obtainGlobalAtomPos(iA, pos);
+			if (periodic) {
+				const double * refPos = refPositions.data() + DIM * (grainId - firstGrain);
+				for (char i = 0; i < DIM; i++) {
+					d = pos[i] - refPos[i];
+					pos[i] = refPos[i] + d - size[i] * floor(d / size[i] + .5);
+				}
+			}
+			grains[grainId]->addToCenter(pos);
+		}
+	}
+	for (long iG = firstGrain; iG < grains.size(); iG++) {
+		grains[iG]->calcAverageCenter();
+	}
+}
+
+long UnionFindGrainIdentificationEngine::find(long i) {
+	//path halving, concurrent updates only shorten paths and are therefore allowed to fail
+	long parent, grandParent;
+	while (true) {
+		parent = parents[i].load(std::memory_order_relaxed);
+		if (parent == i) {
+			return i;
+		}
+		grandParent = parents[parent].load(std::memory_order_relaxed);
+		if (grandParent == parent) {
+			return parent;
+		}
+		parents[i].compare_exchange_weak(parent, grandParent, std::memory_order_relaxed);
+		i = grandParent;
+	}
+}
+
+void UnionFindGrainIdentificationEngine::unite(long i1, long i2) {
+	//the root with the higher number is linked to the one with the lower number,
+	//hence the result does not depend on the order of the unions
+	long root1, root2;
+	while (true) {
+		root1 = find(i1);
+		root2 = find(i2);
+		if (root1 == root2) {
+			return;
+		}
+		if (root1 < root2) {
+			std::swap(root1, root2);
+		}
+		//only succeeds if root1 is still a root
+		if (parents[root1].compare_exchange_strong(root1, root2, std::memory_order_relaxed)) {
+			return;
+		}
+		i1 = root1;
+		i2 = root2;
+	}
+}
+
+long UnionFindGrainIdentificationEngine::atomNum(const AtomBox * box, long iA) const {
+	return atomOffsets[box - boxes] + iA;
+}
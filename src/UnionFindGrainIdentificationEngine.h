@@ -0,0 +1,77 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef UNIONFINDGRAINIDENTIFICATIONENGINE_H_
+#define UNIONFINDGRAINIDENTIFICATIONENGINE_H_
+#include <atomic>
+#include <cmath>
+#include "GradeA_Defs.h"
+#include "Orientator.h"
+#include "AtomBox.h"
+#include "Grain.h"
+#include "NeighborList.h"
+
+//!\brief Grain identification engine, which builds the grains as connected components of similar oriented neighbor atoms.
+//! Two neighboring atoms are connected if their misorientation is below the local threshold.
+//! The components are built by a lock-free concurrent union-find over all boxes in parallel.
+//! The global criterion (misorientation to the grain's mean orientation below three times the local threshold)
+//! is applied afterwards to each component, rejected atoms are left for the orphan atom adoption.
+class UnionFindGrainIdentificationEngine {
+public:
+	UnionFindGrainIdentificationEngine(Orientator * inOrient, AtomBox * inBoxes, long inNumBoxes, unsigned char inNumMaxAtomNeighbors);
+	virtual ~UnionFindGrainIdentificationEngine();
+	void setSearchRadiiSquared(double inRsqrMin, double inRsqrMax);
+	//!\brief Sets the container geometry used to unwrap the grain centers across periodic boundaries.
+	void setContainerGeometry(const double * inSize, bool inPeriodic);
+	//!\brief Sets a prebuilt neighbor list, which replaces the neighbor search. \c nullptr disables it.
+	void setNeighborList(const NeighborList * inNeighborList);
+	//!\brief Identifies all grains.
+	//!\param[in] angularThreshold Maximum angular misorientation of two neighboring atoms in rad.
+	//!\param[in] minGrainSize Only components with more atoms than \c minGrainSize become grains.
+	//!\param[out] outGrains List to which the found grains are appended, ordered by their first atom.
+	//!\return The number of found grains.
+	long run(double angularThreshold, long minGrainSize, std::vector<Grain *> & outGrains);
+private:
+	void init();
+	void connectNeighbors(long iB, bool restricted);
+	void applyGlobalCriterion();
+	void buildGrains(long minGrainSize, std::vector<Grain *> & outGrains);
+	//!\brief Calculates the centers of the new grains, periodic grains are unwrapped around the circular mean of their atom positions.
+	void calculateCenters(long firstGrain, std::vector<Grain *> & grains) const;
+	inline long find(long i);
+	inline void unite(long i1, long i2);
+	inline long atomNum(const AtomBox * box, long iA) const;
+	AtomBox * boxes = nullptr;
+	Orientator * orient = nullptr;
+	long numBoxes = 0;
+	long numAtoms = 0;
+	unsigned char nMaxAtomNeighbors = 12;
+	double rSqrMin = 0., rSqrMax = 0.;
+	double cosHalfThreshold = 1., bigCosHalfThreshold = 1.;
+	double size[DIM] = {0., 0., 0.};
+	bool periodic = false;
+	const NeighborList * neighborList = nullptr;
+	std::vector<long> atomOffsets;
+	std::atomic<long> * parents = nullptr;
+	//!first-pass component of each atom, only used by the global criterion
+	std::vector<long> components;
+	//!atoms which failed the global criterion
+	std::vector<char> rejected;
+};
+
+#endif /* UNIONFINDGRAINIDENTIFICATIONENGINE_H_ */
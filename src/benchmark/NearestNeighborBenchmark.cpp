@@ -0,0 +1,200 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+//Microbenchmark of the nearest-neighbor search.
+//Compares the former search (collect all atoms of the box neighborhood, sort them completely)
+//with the bounded selection kernel for every instruction set supported by the cpu.
+//Afterwards the boxes and atoms are stored along a Morton curve instead of row by row and the search is compared with both memory orders,
+//as well as with the search reading a ghost halo of the periodic images.
+//Usage: nn-benchmark [unitCellsPerDirection(20)] [repetitions(3)]
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include "../AtomContainer.h"
+#include "../StopWatch.h"
+
+static bool sortLengthAscending(double * vA, double * vB) { return SQR(vA[0])+SQR(vA[1])+SQR(vA[2]) < SQR(vB[0])+SQR(vB[1])+SQR(vB[2]); }
+
+//!\brief The former implementation of AtomBox::nearestAtomNeighbors(), used as reference.
+unsigned char referenceNearestAtomNeighbors(AtomBox * box, const long atomId, const unsigned char nAtomNeighbors, double * outNborPositions){
+	double atomPos[DIM];
+	box->getAtomPos(atomId, atomPos);
+	double nborAtomPos[DIM];
+	std::vector<double> nborAtomPosList;
+	for (long iA = 0; iA < box->getNumAtoms(); iA++){
+		if( iA != atomId){
+			box->getAtomPos(iA, nborAtomPos);
+			nborAtomPosList.push_back(nborAtomPos[0] - atomPos[0]);
+			nborAtomPosList.push_back(nborAtomPos[1] - atomPos[1]);
+			nborAtomPosList.push_back(nborAtomPos[2] - atomPos[2]);
+		}
+	}
+	const double * size = box->getSize();
+	double relAtomPos [DIM];
+	for (long iBoxes = 0; iBoxes < box->getNumNeighbors(); iBoxes ++ ){
+		ABoxNeighbor & neighbor = box->getNeighbors()[iBoxes];
+		relAtomPos[0] = atomPos[0] - neighbor.coord[0] * size[0];
+		relAtomPos[1] = atomPos[1] - neighbor.coord[1] * size[1];
+		relAtomPos[2] = atomPos[2] - neighbor.coord[2] * size[2];
+		for(long iA = 0; iA < neighbor.box->getNumAtoms(); iA++){
+			neighbor.box->getAtomPos(iA, nborAtomPos);
+			nborAtomPosList.push_back( nborAtomPos[0] - relAtomPos[0]);
+			nborAtomPosList.push_back( nborAtomPos[1] - relAtomPos[1]);
+			nborAtomPosList.push_back( nborAtomPos[2] - relAtomPos[2]);
+		}
+	}
+	long nFoundNeighbors = nborAtomPosList.size()/DIM;
+	double ** nborAtomList = new double * [nFoundNeighbors];
+	for(long iN = 0; iN < nFoundNeighbors; iN++){
+		nborAtomList[iN] = &nborAtomPosList.front() + iN * DIM;
+	}
+	std::sort(nborAtomList, nborAtomList+nFoundNeighbors, sortLengthAscending);
+	if (nFoundNeighbors > nAtomNeighbors) nFoundNeighbors = nAtomNeighbors;
+	for(unsigned char iN = 0; iN < nFoundNeighbors; iN++){
+		outNborPositions[iN*DIM] = nborAtomList[iN][0];
+		outNborPositions[iN*DIM+1] = nborAtomList[iN][1];
+		outNborPositions[iN*DIM+2] = nborAtomList[iN][2];
+	}
+	delete [] nborAtomList;
+	return nFoundNeighbors;
+}
+
+//!\brief Fills a periodic container with the atoms at \c positions and sorts them into the boxes.
+void fillContainer(AtomContainer & container, const double * size, const std::vector<double> & positions){
+	double origin[DIM] = {0., 0., 0.};
+	std::vector<std::string> noProperties;
+	container.setSize(size);
+	container.setOrigin(origin);
+	container.generate(positions.size() / DIM);
+	for (long i = 0; i < positions.size() / DIM; i++){
+		container.addAtom(positions.data() + i * DIM, noProperties);
+	}
+	container.sortAtoms();
+}
+
+//!\return The median distance in memory (in atoms) between the atoms of a box and the atoms of its neighbor boxes.
+//! The smaller the distance, the more of the neighbor atoms are found in cache lines loaded before.
+long medianNeighborBoxDistance(AtomBox * boxes, long numBoxes){
+	std::vector<long> distances;
+	for (long iB = 0; iB < numBoxes; iB++){
+		if (boxes[iB].getNumAtoms() == 0) continue;
+		for (long iN = 0; iN < boxes[iB].getNumNeighbors(); iN++){
+			AtomBox * nborBox = boxes[iB].getNeighbors()[iN].box;
+			if (nborBox->getNumAtoms() == 0) continue;
+			distances.push_back(std::abs(nborBox->getAtom(0) - boxes[iB].getAtom(0)));
+		}
+	}
+	if (distances.empty()) return 0;
+	std::nth_element(distances.begin(), distances.begin() + distances.size() / 2, distances.end());
+	return distances[distances.size() / 2];
+}
+
+//!\brief Runs a search over all atoms and returns the time per atom in nanoseconds.
+template <typename SearchFunction>
+double timeSearch(AtomBox * boxes, long numBoxes, long numAtoms, int repetitions, double & checkSum, SearchFunction search){
+	double nborPositions[12*DIM];
+	double bestDuration = 0.;
+	for (int iR = 0; iR < repetitions; iR++){
+		checkSum = 0.;
+		StopWatch watch;
+		watch.trigger();
+		for (long iB = 0; iB < numBoxes; iB++){
+			for (long iA = 0; iA < boxes[iB].getNumAtoms(); iA++){
+				unsigned char n = search(boxes + iB, iA, nborPositions);
+				for (unsigned char iN = 0; iN < n; iN++){
+					checkSum += SQR(nborPositions[iN*DIM]) + SQR(nborPositions[iN*DIM+1]) + SQR(nborPositions[iN*DIM+2]);
+				}
+			}
+		}
+		watch.trigger();
+		if (iR == 0 || watch.getDuration() < bestDuration) bestDuration = watch.getDuration();
+	}
+	return 1.e9 * bestDuration / numAtoms;
+}
+
+int main(int argc, char** argv){
+	int numCells = argc > 1 ? atoi(argv[1]) : 20;
+	int repetitions = argc > 2 ? atoi(argv[2]) : 3;
+	if (numCells <= 0 || repetitions <= 0){
+		std::cerr << "Usage: nn-benchmark [unitCellsPerDirection(20)] [repetitions(3)]" << std::endl;
+		return -1;
+	}
+	//fcc aluminium with thermal noise in a periodic container
+	const double a = 4.05;
+	const double basis[4][DIM] = {{0.,0.,0.},{.5,.5,0.},{.5,0.,.5},{0.,.5,.5}};
+	double size[DIM] = {numCells * a, numCells * a, numCells * a};
+	long numAtoms = 4L * numCells * numCells * numCells;
+	double rSqrMax = SQR(1.1 * HALFSQRT2 * a);
+	std::mt19937 generator(42);
+	std::normal_distribution<double> noise(0., 0.05);
+	std::vector<double> positions;
+	positions.reserve(DIM * numAtoms);
+	for (int ix = 0; ix < numCells; ix++)
+	for (int iy = 0; iy < numCells; iy++)
+	for (int iz = 0; iz < numCells; iz++)
+	for (int iBasis = 0; iBasis < 4; iBasis++){
+		positions.push_back(fmod((ix + basis[iBasis][0]) * a + noise(generator) + size[0], size[0]));
+		positions.push_back(fmod((iy + basis[iBasis][1]) * a + noise(generator) + size[1], size[1]));
+		positions.push_back(fmod((iz + basis[iBasis][2]) * a + noise(generator) + size[2], size[2]));
+	}
+	PeriodicAtomContainer periodicContainer(1.1 * sqrt(rSqrMax));
+	AtomContainer & container = periodicContainer;
+	fillContainer(container, size, positions);
+	//the searches only read the boxes
+	AtomBox * boxes = const_cast<AtomBox *>(container.getBoxes());
+	long numBoxes = container.getNumBoxes();
+	std::cout << "Nearest-neighbor search (12 neighbors) for " << container.getNumAtoms() << " atoms in " << numBoxes << " boxes, best of " << repetitions << " runs" << std::endl;
+
+	double refCheckSum, checkSum;
+	double refTime = timeSearch(boxes, numBoxes, numAtoms, repetitions, refCheckSum,
+			[](AtomBox * box, long iA, double * out) { return referenceNearestAtomNeighbors(box, iA, 12, out); });
+	std::cout << "full sort (former):  " << refTime << " ns/atom" << std::endl;
+	nnk::InstructionSet sets[3] = {nnk::scalarSet, nnk::avx2Set, nnk::avx512Set};
+	for (int iS = 0; iS < 3; iS++){
+		if (!nnk::setInstructionSet(sets[iS])){
+			std::cout << "bounded selection " << nnk::instructionSetName(sets[iS]) << ": not supported by this cpu" << std::endl;
+			continue;
+		}
+		double time = timeSearch(boxes, numBoxes, numAtoms, repetitions, checkSum,
+				[](AtomBox * box, long iA, double * out) { return box->nearestAtomNeighbors(iA, 12, out); });
+		std::cout << "bounded selection " << nnk::instructionSetName(sets[iS]) << ": " << time << " ns/atom, speedup " << refTime / time
+				<< (checkSum == refCheckSum ? "" : " (RESULTS DIFFER)") << std::endl;
+	}
+	//the same atoms with the boxes and the atoms inside each box stored along a Morton curve
+	nnk::setInstructionSet(nnk::scalarSet);
+	PeriodicAtomContainer mortonContainer(1.1 * sqrt(rSqrMax));
+	mortonContainer.setMortonOrder(true);
+	fillContainer(mortonContainer, size, positions);
+	AtomBox * mortonBoxes = const_cast<AtomBox *>(mortonContainer.getBoxes());
+	double gridTime = timeSearch(boxes, numBoxes, numAtoms, repetitions, refCheckSum,
+			[](AtomBox * box, long iA, double * out) { return box->nearestAtomNeighbors(iA, 12, out); });
+	double mortonTime = timeSearch(mortonBoxes, numBoxes, numAtoms, repetitions, checkSum,
+			[](AtomBox * box, long iA, double * out) { return box->nearestAtomNeighbors(iA, 12, out); });
+	std::cout << "grid order:   " << gridTime << " ns/atom, neighbor boxes " << medianNeighborBoxDistance(boxes, numBoxes) << " atoms apart in memory" << std::endl;
+	std::cout << "morton order: " << mortonTime << " ns/atom, neighbor boxes " << medianNeighborBoxDistance(mortonBoxes, numBoxes) << " atoms apart in memory"
+			<< ", speedup " << gridTime / mortonTime
+			<< (std::abs(checkSum - refCheckSum) <= 1.e-9 * refCheckSum ? "" : " (RESULTS DIFFER)") << std::endl;
+	//the same atoms read from a ghost halo of the periodic images instead of the neighbor boxes
+	PeriodicAtomContainer haloContainer(1.1 * sqrt(rSqrMax));
+	haloContainer.setGhostHalo(true);
+	fillContainer(haloContainer, size, positions);
+	double haloTime = timeSearch(const_cast<AtomBox *>(haloContainer.getBoxes()), numBoxes, numAtoms, repetitions, checkSum,
+			[](AtomBox * box, long iA, double * out) { return box->nearestAtomNeighbors(iA, 12, out); });
+	std::cout << "ghost halo:   " << haloTime << " ns/atom, speedup " << gridTime / haloTime
+			<< (std::abs(checkSum - refCheckSum) <= 1.e-9 * refCheckSum ? "" : " (RESULTS DIFFER)") << std::endl;
+	return 0;
+}
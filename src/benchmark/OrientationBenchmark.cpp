@@ -0,0 +1,232 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Microbenchmark of the orientation calculation of a single fcc atom.
+//Compares the former implementation (heap buffers allocated for each atom)
+//with the fixed-size kernel Orientator::fccQuaternion<FCC_NUMNEIGHBORS>() and its tiered quaternion extraction,
+//and the batched kernel ork::fccQuaternions() on each instruction set, whose quaternions are compared bitwise to the scalar kernel.
+//Usage: ori-benchmark [numAtoms(200000)] [repetitions(3)]
+#include <cstdlib>
+#include <random>
+#include <cstring>
+#include "../Orientator.h"
+#include "../OrientationKernel.h"
+#include "../StopWatch.h"
+
+//!\brief The former implementation of Orientator::reduceAntiparallelVectors(), used as reference.
+unsigned char referenceReduceAntiparallelVectors(double * &vects, unsigned char n){
+	double * v1, * v2;
+	bool * redundant = new bool [n];
+	for(unsigned char i = 0; i < n; i++ ){
+		redundant[i] = false;
+	}
+	std::vector<double> v;
+	for(unsigned char i = 0; i < n; i++ ){
+		v1 = vects + i*DIM;
+		for(unsigned char ii = i+1; ii < n; ii++){
+			if(!redundant[i] && !redundant[ii]){
+				v2 = vects + ii*DIM;
+				if (fabs(fabs(ori::scalarProduct(v1, v2)) - 1 )< COSTRESHOLD ){
+					redundant[i] = true;
+					redundant[ii] = true;
+					v.push_back(.5*(v1[0]-v2[0]));
+					v.push_back(.5*(v1[1]-v2[1]));
+					v.push_back(.5*(v1[2]-v2[2]));
+				}
+			}
+		}
+		if(!redundant[i]){
+			v.push_back(v1[0]);
+			v.push_back(v1[1]);
+			v.push_back(v1[2]);
+		}
+	}
+	delete [] redundant;
+	delete [] vects;
+	vects = new double [v.size()];
+	for (unsigned char i = 0; i < v.size(); i ++){
+		vects[i] = v[i];
+	}
+	return static_cast<unsigned char> (v.size()/DIM);
+}
+
+//!\brief The former implementation of Orientator::fccQuaternion(), used as reference.
+bool referenceFccQuaternion(const Orientator & orient, const double * neighborPositions, unsigned char nNextNeighbors, double * q){
+	if (nNextNeighbors > 12) {
+		return false;
+	}
+	double * unitVectors = new double [nNextNeighbors * DIM];
+	for(unsigned char i = 0; i < nNextNeighbors * DIM; i ++){
+		unitVectors[i] = neighborPositions[i];
+	}
+	ori::unitizeVectors(unitVectors, nNextNeighbors);
+	unsigned char nVects = referenceReduceAntiparallelVectors(unitVectors, nNextNeighbors);
+	double * nextNborVects = new double [nVects*DIM];
+	for(long i = 0; i < nVects*DIM; i++){
+		nextNborVects[i] = unitVectors[i];
+	}
+	delete [] unitVectors;
+	if (nVects < 6) {
+		delete [] nextNborVects;
+		return false;
+	}
+	char nPerpend = 0;
+	double normal100Vects[3*DIM];
+	for (char iVec = 0; iVec < nVects; iVec++){
+		if (3 == nPerpend) break;
+		for (char iVec2 = iVec + 1; iVec2 < nVects; iVec2++){
+			if(fabs(ori::scalarProduct(nextNborVects + DIM * iVec, nextNborVects + DIM * iVec2)) < SINTRESHOLD){
+				ori::crossProduct(nextNborVects + DIM * iVec, nextNborVects + DIM * iVec2, normal100Vects + DIM * nPerpend);
+				if(3 == ++nPerpend){
+					break;
+				}
+			}
+		}
+	}
+	delete [] nextNborVects;
+	if (nPerpend < 3) {
+		return false;
+	}
+	//right-handed orientation matrix
+	double cross[DIM];
+	ori::crossProduct(normal100Vects + DIM, normal100Vects + 2*DIM, cross);
+	if (ori::scalarProduct(normal100Vects, cross) < 0.){
+		normal100Vects[0] *= -1.;
+		normal100Vects[1] *= -1.;
+		normal100Vects[2] *= -1.;
+	}
+	double qMatrix[4];
+	orient.eigenClosestQuaternion(normal100Vects, qMatrix);
+	ori::uniqueCubicRotationQuaternion(qMatrix, q);
+	return true;
+}
+
+//!\brief Runs the calculation for all atoms and returns the time per atom in nanoseconds.
+template <typename OrientationFunction>
+double timeOrientation(const std::vector<double> & nborPositions, int repetitions, double & checkSum, long & nValid, OrientationFunction calculate){
+	long numAtoms = nborPositions.size() / (FCC_NUMNEIGHBORS * DIM);
+	double q[4];
+	double bestDuration = 0.;
+	for (int iR = 0; iR < repetitions; iR++){
+		checkSum = 0.;
+		nValid = 0;
+		StopWatch watch;
+		watch.trigger();
+		for (long iA = 0; iA < numAtoms; iA++){
+			if (calculate(nborPositions.data() + iA * FCC_NUMNEIGHBORS * DIM, q)){
+				checkSum += fabs(q[0]) + fabs(q[1]) + fabs(q[2]) + fabs(q[3]);
+				nValid++;
+			}
+		}
+		watch.trigger();
+		if (iR == 0 || watch.getDuration() < bestDuration) bestDuration = watch.getDuration();
+	}
+	return 1.e9 * bestDuration / numAtoms;
+}
+
+int main(int argc, char** argv){
+	long numAtoms = argc > 1 ? atol(argv[1]) : 200000;
+	int repetitions = argc > 2 ? atoi(argv[2]) : 3;
+	if (numAtoms <= 0 || repetitions <= 0){
+		std::cerr << "Usage: ori-benchmark [numAtoms(200000)] [repetitions(3)]" << std::endl;
+		return -1;
+	}
+	//12 nearest neighbors of randomly rotated fcc atoms with thermal noise
+	const double fccNeighbors[FCC_NUMNEIGHBORS][DIM] = {
+		{1.,1.,0.},{-1.,-1.,0.},{1.,-1.,0.},{-1.,1.,0.},
+		{1.,0.,1.},{-1.,0.,-1.},{1.,0.,-1.},{-1.,0.,1.},
+		{0.,1.,1.},{0.,-1.,-1.},{0.,1.,-1.},{0.,-1.,1.}};
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<double> angle(0., 2. * PI);
+	std::normal_distribution<double> noise(0., 0.05);
+	std::vector<double> nborPositions(numAtoms * FCC_NUMNEIGHBORS * DIM);
+	double euler[DIM], M[9], q[4];
+	for (long iA = 0; iA < numAtoms; iA++){
+		euler[0] = angle(generator);
+		euler[1] = .5 * angle(generator);
+		euler[2] = angle(generator);
+		ori::bungeToMatrix(euler, M);
+		double * out = nborPositions.data() + iA * FCC_NUMNEIGHBORS * DIM;
+		for (int iN = 0; iN < FCC_NUMNEIGHBORS; iN++){
+			for (int i = 0; i < DIM; i++){
+				out[iN*DIM+i] = 2.025 * (M[3*i] * fccNeighbors[iN][0] + M[3*i+1] * fccNeighbors[iN][1] + M[3*i+2] * fccNeighbors[iN][2]) + noise(generator);
+			}
+		}
+	}
+	Orientator orient;
+	std::cout << "Orientation calculation (" << FCC_NUMNEIGHBORS << " neighbors) for " << numAtoms << " atoms, best of " << repetitions << " runs" << std::endl;
+	double refCheckSum, checkSum;
+	long refValid, nValid;
+	double refTime = timeOrientation(nborPositions, repetitions, refCheckSum, refValid,
+			[&orient](const double * nbors, double * q) { return referenceFccQuaternion(orient, nbors, FCC_NUMNEIGHBORS, q); });
+	std::cout << "heap buffers, eigen solver (former): " << refTime << " ns/atom, " << refValid << " orientations" << std::endl;
+	double time = timeOrientation(nborPositions, repetitions, checkSum, nValid,
+			[&orient](const double * nbors, double * q) { return orient.fccQuaternion<FCC_NUMNEIGHBORS>(nbors, FCC_NUMNEIGHBORS, q); });
+	std::cout << "fixed-size kernel, tiered:           " << time << " ns/atom, " << nValid << " orientations, speedup " << refTime / time
+			<< (nValid == refValid && fabs(checkSum - refCheckSum) <= 1.e-9 * refCheckSum ? "" : " (RESULTS DIFFER)") << std::endl;
+	QuaternionTierCounter tierCounter;
+	for (long iA = 0; iA < numAtoms; iA++){
+		orient.fccQuaternion<FCC_NUMNEIGHBORS>(nborPositions.data() + iA * FCC_NUMNEIGHBORS * DIM, FCC_NUMNEIGHBORS, q, &tierCounter);
+	}
+	std::cout << "quaternions extracted by closed form: " << tierCounter.counts[closedFormTier]
+			<< ", polar decomposition: " << tierCounter.counts[polarTier]
+			<< ", eigen solver: " << tierCounter.counts[eigenTier] << std::endl;
+
+	//batched kernel, compared bitwise to the fixed-size kernel
+	std::vector<double> scalarQuats(4 * numAtoms), batchQuats(4 * numAtoms);
+	std::vector<char> scalarValid(numAtoms);
+	for (long iA = 0; iA < numAtoms; iA++){
+		scalarValid[iA] = orient.fccQuaternion<FCC_NUMNEIGHBORS>(nborPositions.data() + iA * FCC_NUMNEIGHBORS * DIM, FCC_NUMNEIGHBORS, scalarQuats.data() + 4 * iA);
+	}
+	std::vector<const double *> nborPtrs(numAtoms);
+	std::vector<unsigned char> nNbors(numAtoms, FCC_NUMNEIGHBORS);
+	for (long iA = 0; iA < numAtoms; iA++){
+		nborPtrs[iA] = nborPositions.data() + iA * FCC_NUMNEIGHBORS * DIM;
+	}
+	bool * batchValid = new bool [numAtoms];
+	nnk::InstructionSet sets[4] = {nnk::scalarSet, nnk::sse2Set, nnk::avx2Set, nnk::avx512Set};
+	for (int iS = 0; iS < 4; iS++){
+		if (!ork::setInstructionSet(sets[iS])){
+			std::cout << "batched kernel " << nnk::instructionSetName(sets[iS]) << ": not supported by this cpu" << std::endl;
+			continue;
+		}
+		double bestDuration = 0.;
+		QuaternionTierCounter batchTierCounter;
+		for (int iR = 0; iR < repetitions; iR++){
+			StopWatch watch;
+			watch.trigger();
+			nValid = ork::fccQuaternions(orient, nborPtrs.data(), nNbors.data(), numAtoms, batchQuats.data(), batchValid, iR == 0 ? &batchTierCounter : nullptr);
+			watch.trigger();
+			if (iR == 0 || watch.getDuration() < bestDuration) bestDuration = watch.getDuration();
+		}
+		long nDiffering = 0;
+		for (long iA = 0; iA < numAtoms; iA++){
+			if (batchValid[iA] != (bool)scalarValid[iA] || (batchValid[iA] && memcmp(batchQuats.data() + 4 * iA, scalarQuats.data() + 4 * iA, 4 * sizeof(double)))){
+				nDiffering++;
+			}
+		}
+		double batchTime = 1.e9 * bestDuration / numAtoms;
+		std::cout << "batched kernel " << nnk::instructionSetName(sets[iS]) << ": " << batchTime << " ns/atom, " << nValid << " orientations, speedup " << refTime / batchTime
+				<< " (" << time / batchTime << " over fixed-size kernel), eigen solver: " << batchTierCounter.counts[eigenTier]
+				<< (nDiffering == 0 ? ", bit-identical" : ", RESULTS DIFFER for ") ;
+		if (nDiffering) std::cout << nDiffering << " atoms";
+		std::cout << std::endl;
+	}
+	delete [] batchValid;
+	return 0;
+}
@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "CFGHeaderData.h"
+#include <cstring>
 
 CFGHeaderData::CFGHeaderData() {
 	H0.setIdentity();
@@ -57,6 +58,24 @@ void CFGHeaderData::parse(TextReader* reader) {
 		throw Exception("Invalid file header. This is not a valid CFG file.");
 }
 
+const char * CFGHeaderData::parse(const char * text, const char * textEnd) {
+	numParticles = -1;	//indicates an error if value is
+						//not overwritten during header-parsing
+	bool isDone = false;
+	std::string line;
+	const char * lineBegin = text;
+	while(lineBegin != textEnd && !isDone) {
+		const char * lineEnd = static_cast<const char *>(memchr(lineBegin, '\n', textEnd - lineBegin));
+		if(lineEnd == nullptr) lineEnd = textEnd;
+		line.assign(lineBegin, lineEnd);
+		parseLine(line, isDone);
+		if(!isDone) lineBegin = (lineEnd == textEnd) ? textEnd : lineEnd + 1;
+	}
+	if(numParticles < 0)
+		throw Exception("Invalid file header. This is not a valid CFG file.");
+	return lineBegin;
+}
+
 int CFGHeaderData::getNumAuxFields() const{
 	return auxFields.size();
 }
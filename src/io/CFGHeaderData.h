@@ -26,6 +26,8 @@ public:
 	~CFGHeaderData(){};
 	void parse(FileEditor * editor);
 	void parse(TextReader * reader);
+	//parses the header at the beginning of a text buffer and returns the beginning of the first line behind the header
+	const char * parse(const char * text, const char * textEnd);
 	long getNumLines() const {
 		return numLines;
 	}
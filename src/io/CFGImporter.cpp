@@ -18,14 +18,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //This file has been taken from Ovito
 
 #include "../io/CFGImporter.h"
-
-bool isNewType(const std::string & line){
-	//if a new type is introduced, the line contains only a single column
-	//<number>< \t>*<\n>
-	//        |<- trimPos
-	size_t trimPos = line.find_first_of(" \t");
-	return line.find_first_not_of(" \t",trimPos) == std::string::npos;
-}
+#include "../io/MappedFile.h"
+#include "../io/TextTokenizer.h"
+#include "../StopWatch.h"
+#include <cstring>
 
 /******************************************************************************
 * Checks if the given file has format that can be read by this importer.
@@ -48,143 +44,231 @@ bool CFGImporter::checkFileFormat()
 
 
 /******************************************************************************
-* Parses the given input file and stores the data in the given container object.
+* Locates the frames of a file, which holds several CFG files one after another.
 ******************************************************************************/
-void CFGImporter::parseFile()
+void CFGImporter::scanFrames(std::vector<FrameInfo> & frames)
 {
-	reader = new TextReader(filename);
-	header.parse(reader);
-	//atomPositions = new double[header.getNumParticles()*DIM];
-	//add all corresponding auxFields
-	for(int i = 0; i < header.getNumAuxFields(); i++){
-		data->addAtomProperty(header.getAuxField(i));
-	}
-	// Create particle mass and type properties.
-	int currentAtomType = 0;
-	double currentMass = 0;
-
-		double trVec[3] = {
-		 0.,0.,0.
-		};
-		//AffineTransformation H((header.transform * header.H0).transposed());
-		transform = header.getTransform()->multiply(header.getH0()).transposed();
-		//H.translation() = H * Vector3(-0.5f, -0.5f, -0.5f);
-		transform.multiply(trVec, translate);
-		//simulationCell().setMatrix(H);
-		double v100[3] = {1.,0.,0.};
-		double v010[3] = {0.,1.,0.};
-		double v001[3] = {0.,0.,1.};
-		transform.multiplyAndTranslate(v100,translate,v100);
-		transform.multiplyAndTranslate(v010,translate,v010);
-		transform.multiplyAndTranslate(v001,translate,v001);
-		double max[3] = {v100[0], v100[1], v100[2]};
-		double min[3] = {v100[0], v100[1], v100[2]};
-		for (char i=0; i < 3; i++){
-			if( v010[i] > max[i]) max[i] = v010[i];
-			if( v001[i] > max[i]) max[i] = v001[i];
-			if( v010[i] < min[i]) min[i] = v010[i];
-			if( v001[i] < min[i]) min[i] = v001[i];
-		}
-		double size[3] ={max[0]-min[0], max[1]-min[1], max[2]-min[2]};
-		double origin[3] = {0.,0.,0.};
-		data->setSize(size);
-		data->setOrigin(origin);
-		data->generate(header.getNumParticles());
-		// Read per-particle data.
-
-	bool isFirstLine = true;
-	double position [DIM];
-	for(int particleIndex = 0; particleIndex < header.getNumParticles(); ) {
-		if(!isFirstLine) {
-			reader->readLine();
-		} else {
-			isFirstLine = false;
-		}
-		try {
-			readAtom();
-			particleIndex++;
-		}
-		catch(Exception& ex) {
-			std::cerr << "Parsing error in line "  << reader->getLineNumber()  << " of CFG file."<< std::endl;
-		}
-		if(curAtomData.size() >= DIM){
-			position[0] = atof(curAtomData[0].c_str());
-			position[1] = atof(curAtomData[1].c_str());
-			position[2] = atof(curAtomData[2].c_str());
-			curAtomData.erase(curAtomData.begin(),curAtomData.begin()+DIM);
-			transform.multiplyAndTranslate(position,translate,position);
-			data->addAtom(position, curAtomData);
-		}
+	MappedFile file(filename);
+	std::vector<const char *> frameBegins;
+	FrameIndex::findLines(file.begin(), file.end(), "Number of particles", frameBegins);
+	frames.resize(frameBegins.size());
+	for(size_t iF = 0; iF < frameBegins.size(); iF++){
+		const char * frameEnd = (iF + 1 < frameBegins.size()) ? frameBegins[iF + 1] : file.end();
+		CFGHeaderData frameHeader;
+		frameHeader.parse(frameBegins[iF], frameEnd);
+		frames[iF].offset = frameBegins[iF] - file.begin();
+		frames[iF].length = frameEnd - frameBegins[iF];
+		frames[iF].numAtoms = frameHeader.getNumParticles();
+		frames[iF].timeStep = iF;
 	}
-	delete reader;
+	if(frames.empty()){
+		throw EndOfFile();
+	}
+}
+
+/******************************************************************************
+* Parses the given text of a file and stores the data in the given container object.
+******************************************************************************/
+void CFGImporter::parseText(const char * text, const char * textEnd)
+{
+	const char * atomText = header.parse(text, textEnd);
+	std::vector<std::string> propertyNames;
+	double size[3];
+	readHeaderData(propertyNames, size);
+	double origin[3] = {0.,0.,0.};
+	setupContainer(size, origin, header.getNumParticles(), propertyNames);
+	// Read per-particle data.
+	StopWatch parseWatch;
+	parseWatch.trigger();
+	parseAtoms(atomText, textEnd);
+	parseWatch.trigger();
+	printParseStatistics((textEnd - atomText) / 1.e6, parseWatch.getDuration());
+	//sort all atoms into the boxes at once
+	sortAtoms();
 }
 
-void CFGImporter::readAtom() {
-	curAtomData.clear();
-	skipExtendedLines();
-	const std::string & line  = reader->getLineStr();
-	size_t fieldBegin = 0;
-	size_t fieldEnd = line.find_first_of(" \t",fieldBegin);
-	while (fieldEnd != std::string::npos){
-		if(fieldBegin != fieldEnd){
-			curAtomData.push_back(line.substr(fieldBegin,fieldEnd-fieldBegin));
+/******************************************************************************
+* Reads only the header of the file, which is extended until its end is found.
+******************************************************************************/
+void CFGImporter::readHeader(InputHeader & inputHeader)
+{
+	parseBeginning([this](const char * text, const char * textEnd, bool isComplete) {
+		header = CFGHeaderData();
+		//the header is complete, if the first data line has been found
+		if(header.parse(text, textEnd) == textEnd && !isComplete){
+			throw EndOfFile();
 		}
-		fieldBegin = fieldEnd + 1;
-		fieldEnd = line.find_first_of(" \t",fieldBegin);
+	}, true);
+	inputHeader.numAtoms = header.getNumParticles();
+	readHeaderData(inputHeader.propertyNames, inputHeader.size);
+}
+
+void CFGImporter::readHeaderData(std::vector<std::string> & propertyNames, double * size)
+{
+	if(!header.isExtendedFormat()){
+		throw Exception("Only the extended CFG format is supported.");
 	}
-	//parse last field
-	if(fieldBegin != line.size()){
-		curAtomData.push_back(line.substr(fieldBegin));
+	//add all selected auxFields, the others are skipped while parsing
+	propertyNames.clear();
+	propertyColumns.clear();
+	propertyTypes.clear();
+	for(int i = 0; i < header.getNumAuxFields(); i++){
+		if(!selection.isSelected(header.getAuxField(i))) continue;
+		propertyNames.push_back(header.getAuxField(i));
+		propertyColumns.push_back(DIM + i);
+		propertyTypes.push_back(selection.getType(header.getAuxField(i)));
 	}
-	//indicate an error if the number of entries is not valid
-	if(curAtomData.size() != header.getEntryCount()){
-		throw Exception("Data line in input file does not contain the right number of columns. Expected " +
-				std::to_string(header.getEntryCount())+ " file columns, but found only " + std::to_string(curAtomData.size()));
-
+	double trVec[3] = {
+	 0.,0.,0.
+	};
+	//AffineTransformation H((header.transform * header.H0).transposed());
+	transform = header.getTransform()->multiply(header.getH0()).transposed();
+	//H.translation() = H * Vector3(-0.5f, -0.5f, -0.5f);
+	transform.multiply(trVec, translate);
+	//simulationCell().setMatrix(H);
+	double v100[3] = {1.,0.,0.};
+	double v010[3] = {0.,1.,0.};
+	double v001[3] = {0.,0.,1.};
+	transform.multiplyAndTranslate(v100,translate,v100);
+	transform.multiplyAndTranslate(v010,translate,v010);
+	transform.multiplyAndTranslate(v001,translate,v001);
+	double max[3] = {v100[0], v100[1], v100[2]};
+	double min[3] = {v100[0], v100[1], v100[2]};
+	for (char i=0; i < 3; i++){
+		if( v010[i] > max[i]) max[i] = v010[i];
+		if( v001[i] > max[i]) max[i] = v001[i];
+		if( v010[i] < min[i]) min[i] = v010[i];
+		if( v001[i] < min[i]) min[i] = v001[i];
+	}
+	for (char i=0; i < 3; i++){
+		size[i] = max[i] - min[i];
 	}
-	curAtomNum++;
 }
 
-void CFGImporter::skipExtendedLines() {
-	if(!header.isExtendedFormat()) {
-		return;
+void CFGImporter::parseAtoms(const char * text, const char * textEnd) {
+	long nAtoms = header.getNumParticles();
+	int nProperties = propertyColumns.size();
+	//split the atom section into newline-aligned chunks
+	long nBytes = textEnd - text;
+	long nChunks = 1;
+	if (omp_get_max_threads() > 1) {
+		nChunks = std::max<long>(std::min<long>(omp_get_max_threads() * CFG_CHUNKSPERTHREAD, nBytes / CFG_MINCHUNKSIZE), 1);
 	}
-	if( isNewType(reader->getLineStr()) ){
-		//new type means skipping two lines (mass and name info)
-		reader->readLine();
-		reader->readLine();
+	std::vector<const char *> chunkBegins;
+	tok::splitChunks(text, textEnd, nChunks, chunkBegins);
+	std::vector<CFGChunk> chunks(nChunks);
+	for (long iC = 0; iC < nChunks; iC++) {
+		chunks[iC].begin = chunkBegins[iC];
+		chunks[iC].end = chunkBegins[iC + 1];
 	}
-}
-
-void CFGImporter::readAtomPositions(int particleIndex, const char* s)
-{
-	int columnIndex = 0;
-	while(columnIndex < DIM) {
-		while(*s == ' ' || *s == '\t')
-			++s;
-		const char* token = s;
-		while(*s > ' ')
-			++s;
-		if(s != token) {
-			atomPositions[particleIndex*DIM+columnIndex] = parseField(particleIndex, columnIndex, token, s);
-			columnIndex++;
+	//the header ends with the first data line
+	chunks[0].firstLine = header.getNumLines();
+	if (nChunks > 1) {
+		//1st pass: count the lines and the atoms of each chunk
+		//a chunk may start with the name line of a new type (after the mass line at the end of the previous chunk),
+		//therefore both cases are counted and the right one is chosen afterwards
+#pragma omp parallel for schedule(dynamic,1)
+		for (long iC = 0; iC < nChunks; iC++) {
+			prescanChunk(chunks[iC]);
+		}
+		for (long iC = 1; iC < nChunks; iC++) {
+			const CFGChunk & previous = chunks[iC - 1];
+			chunks[iC].startsWithName = previous.endsBeforeName[previous.startsWithName];
+			chunks[iC].firstLine = previous.firstLine + previous.numLines;
+			chunks[iC].firstAtom = previous.firstAtom + previous.numAtoms[previous.startsWithName];
 		}
-		if(*s == '\0') break;
-		s++;
 	}
-	if(columnIndex < DIM){
-		throw Exception("Data line in input file does not contain enough columns. Expected" + std::to_string(DIM)+ " file columns, but found only " + std::to_string(columnIndex));
+	//2nd pass: each chunk writes the atoms at their input index
+	std::vector<double> positions(DIM * nAtoms);
+	std::vector<double> propertyValues(nProperties * nAtoms);
+	long nParsed = 0;
+#pragma omp parallel for schedule(dynamic,1) reduction(+:nParsed)
+	for (long iC = 0; iC < nChunks; iC++) {
+		nParsed += parseChunk(chunks[iC], nAtoms, positions.data(), propertyValues.data());
+	}
+	if (nParsed < nAtoms) {
+		throw EndOfFile();
+	}
+	std::vector<bool> propertyIsFloat(nProperties, false);
+	for (int iP = 0; iP < nProperties; iP++) {
+		propertyIsFloat[iP] = (propertyTypes[iP] == floatProperty);
+	}
+	for (long iC = 0; iC < nChunks; iC++) {
+		for (int iP = 0; iP < nProperties; iP++) {
+			if (chunks[iC].propertyIsFloat[iP]) propertyIsFloat[iP] = true;
+		}
 	}
-	transform.multiplyAndTranslate(atomPositions+particleIndex*DIM,translate,atomPositions+particleIndex*DIM);
+	addAtoms(positions, nAtoms, propertyValues, propertyIsFloat);
 }
 
+void CFGImporter::prescanChunk(CFGChunk & chunk) const {
+	int nEntries = header.getEntryCount();
+	bool beforeName[2] = {false, true};
+	for (const char * lineBegin = chunk.begin; lineBegin != chunk.end; chunk.numLines++) {
+		const char * lineEnd = tok::lineEnd(lineBegin, chunk.end);
+		int nFields = tok::countFields(lineBegin, lineEnd, nEntries + 1);
+		lineBegin = tok::nextLine(lineEnd, chunk.end);
+		for (int iState = 0; iState < 2; iState++) {
+			if (beforeName[iState]) {
+				beforeName[iState] = false;
+			} else if (nFields == 1) {
+				beforeName[iState] = true;
+			} else if (nFields == nEntries) {
+				chunk.numAtoms[iState]++;
+			}
+		}
+	}
+	chunk.endsBeforeName[0] = beforeName[0];
+	chunk.endsBeforeName[1] = beforeName[1];
+}
 
-double CFGImporter::parseField(int particleIndex, int columnIndex, const char* token, const char* token_end)
+long CFGImporter::parseChunk(CFGChunk & chunk, long nAtoms, double * positions, double * propertyValues) {
+	int nEntries = header.getEntryCount();
+	int nProperties = propertyColumns.size();
+	//one more field than expected is stored, so that too long lines are detected
+	std::vector<const char *> fieldBegins(nEntries + 1);
+	std::vector<const char *> fieldEnds(nEntries + 1);
+	chunk.propertyIsFloat.assign(nProperties, false);
+	bool beforeName = chunk.startsWithName;
+	long atomNum = chunk.firstAtom;
+	long lineNumber = chunk.firstLine;
+	for (const char * lineBegin = chunk.begin; lineBegin != chunk.end && atomNum < nAtoms; lineNumber++) {
+		const char * lineEnd = tok::lineEnd(lineBegin, chunk.end);
+		int nFields = tok::splitFields(lineBegin, lineEnd, fieldBegins.data(), fieldEnds.data(), nEntries + 1);
+		lineBegin = tok::nextLine(lineEnd, chunk.end);
+		if(beforeName) {
+			beforeName = false;
+			continue;
+		}
+		if(nFields == 0) {
+			continue;
+		}
+		if(nFields == 1) {
+			//a new type is introduced by a line with its mass followed by a line with its name
+			beforeName = true;
+			continue;
+		}
+		if(nFields != nEntries) {
+#pragma omp critical
 {
-	const char *c;
-	std::string fieldString;
-	for(c = token; c != token_end; c++){
-		fieldString += *c;
+			std::cerr << "Parsing error in line "  << lineNumber  << " of CFG file. Expected " << nEntries
+					<< " columns, but found " << nFields << "." << std::endl;
+}
+			continue;
+		}
+		double * position = positions + DIM * atomNum;
+		position[0] = tok::parseDouble(fieldBegins[0], fieldEnds[0]);
+		position[1] = tok::parseDouble(fieldBegins[1], fieldEnds[1]);
+		position[2] = tok::parseDouble(fieldBegins[2], fieldEnds[2]);
+		transform.multiplyAndTranslate(position,translate,position);
+		//only the selected aux fields are converted
+		for(int iP = 0; iP < nProperties; iP++) {
+			bool isFloat = false;
+			propertyValues[iP * nAtoms + atomNum] = parsePropertyField(fieldBegins[propertyColumns[iP]], fieldEnds[propertyColumns[iP]],
+					propertyTypes[iP], isFloat);
+			if(isFloat) chunk.propertyIsFloat[iP] = true;
+		}
+		atomNum++;
 	}
-	return atof(fieldString.c_str());
+	return atomNum - chunk.firstAtom;
 }
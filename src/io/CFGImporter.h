@@ -22,6 +22,33 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "FileImporter.h"
 #include "CFGHeaderData.h"
+
+/// Number of chunks per thread, into which the atom section of a file is split for parsing.
+#define CFG_CHUNKSPERTHREAD 4
+#ifndef CFG_MINCHUNKSIZE
+/// Minimum size of a chunk in bytes.
+#define CFG_MINCHUNKSIZE (1 << 20)
+#endif
+
+/**
+ * \brief A newline-aligned byte range of the atom section of a CFG file, which is parsed by one thread.
+ */
+struct CFGChunk {
+	const char * begin = nullptr;
+	const char * end = nullptr;
+	/// Number of lines of the chunk.
+	long numLines = 0;
+	/// Number of atom lines, if the chunk starts with a regular line [0] or with the name line of a new type [1].
+	long numAtoms[2] = {0, 0};
+	/// Whether the name line of a new type follows the chunk, for both starting states.
+	bool endsBeforeName[2] = {false, false};
+	/// Starting state, number of the first line and index of the first atom, known after all chunks are prescanned.
+	bool startsWithName = false;
+	long firstLine = 0;
+	long firstAtom = 0;
+	/// Whether a value of each aux field has been given as floating point number.
+	std::vector<bool> propertyIsFloat;
+};
 /**
  * \brief File parser for AtomEye CFG files.
  */
@@ -33,18 +60,26 @@ public:
 	CFGImporter(std::string &filename, AtomContainer * inData) : FileImporter(filename, inData, cfg){}
 	/// \brief Checks if the given file has format that can be read by this importer.
 	virtual bool checkFileFormat();
-	virtual void parseFile();
-	void readAtomPositions(int particleIndex, const char* s);
-	double parseField(int particleIndex, int columnIndex, const char* token, const char* token_end);
+	virtual void parseText(const char * text, const char * textEnd);
+	virtual void readHeader(InputHeader & inputHeader);
+	/// \brief Each frame of a CFG file begins with the line "Number of particles", a CFG file has no time steps.
+	virtual void scanFrames(std::vector<FrameInfo> & frames);
 private:
-	void skipExtendedLines();
-	void readAtom();
-	std::vector<std::string> curAtomData;
-	long curAtomNum = -1;
+	/// \brief Selects the stored aux fields and computes the transformation and the box size from the parsed header.
+	void readHeaderData(std::vector<std::string> & propertyNames, double * size);
+	/// \brief Parses the atom lines of the text [text, textEnd) in parallel and adds the atoms to the container.
+	void parseAtoms(const char * text, const char * textEnd);
+	/// \brief Counts the lines and the atoms of a chunk for both starting states.
+	void prescanChunk(CFGChunk & chunk) const;
+	/// \brief Parses the atoms of a chunk into the positions and the property columns of all nAtoms atoms.
+	/// \return The number of parsed atoms.
+	long parseChunk(CFGChunk & chunk, long nAtoms, double * positions, double * propertyValues);
 	Matrix3 transform;
 	double translate[3];
-	double * atomPositions = nullptr;
 	CFGHeaderData header;
+	/// Entry (column) and type of each stored aux field.
+	std::vector<int> propertyColumns;
+	std::vector<PropertyType> propertyTypes;
 };
 
 #endif // CFG_FILE_IMPORTER_H
@@ -0,0 +1,154 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Decompressor.h"
+#include "FileImporter.h"
+#include <cstring>
+#include <climits>
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+//magic numbers at the beginning of compressed files
+const unsigned char gzipMagic[2] = {0x1f, 0x8b};
+const unsigned char zstdMagic[4] = {0x28, 0xb5, 0x2f, 0xfd};
+
+bool startsWith(const char * data, size_t numBytes, const unsigned char * magic, size_t numMagicBytes) {
+	return numBytes >= numMagicBytes && memcmp(data, magic, numMagicBytes) == 0;
+}
+}
+
+Decompressor::Format Decompressor::detectFormat(const char * data, size_t numBytes) {
+	if (startsWith(data, numBytes, gzipMagic, sizeof(gzipMagic))) return GZIP;
+	if (startsWith(data, numBytes, zstdMagic, sizeof(zstdMagic))) return ZSTD;
+	return NONE;
+}
+
+size_t Decompressor::estimateSize(Format format, const char * data, size_t numBytes) {
+	size_t guess = 4 * numBytes;
+	if (format == GZIP && numBytes >= 4) {
+		//the last four bytes hold the size of the last member modulo 2^32, which is exact for most files
+		const unsigned char * trailer = reinterpret_cast<const unsigned char *>(data + numBytes - 4);
+		guess = std::max(guess, size_t(trailer[0]) | size_t(trailer[1]) << 8 | size_t(trailer[2]) << 16 | size_t(trailer[3]) << 24);
+	}
+#ifdef USE_ZSTD
+	if (format == ZSTD) {
+		unsigned long long contentSize = ZSTD_getFrameContentSize(data, numBytes);
+		if (contentSize != ZSTD_CONTENTSIZE_UNKNOWN && contentSize != ZSTD_CONTENTSIZE_ERROR) {
+			guess = std::max<size_t>(guess, contentSize);
+		}
+	}
+#endif
+	//one more byte, so that the output is not full after the last step
+	return guess + 1;
+}
+
+Decompressor::Decompressor(Format inFormat, const std::string & inFileName) {
+	format = inFormat;
+	fileName = inFileName;
+	if (format == GZIP) {
+#ifdef USE_ZLIB
+		z_stream * gzipStream = new z_stream;
+		memset(gzipStream, 0, sizeof(z_stream));
+		//maximum window size, the gzip header is detected automatically
+		if (inflateInit2(gzipStream, 15 + 32) != Z_OK) {
+			delete gzipStream;
+			throw Exception("Decompressor failed to initialize for \"" + fileName + "\"");
+		}
+		stream = gzipStream;
+#else
+		throw Exception("\"" + fileName + "\" is compressed with gzip, but GraDe-A has been built without zlib");
+#endif
+	} else if (format == ZSTD) {
+#ifdef USE_ZSTD
+		ZSTD_DStream * zstdStream = ZSTD_createDStream();
+		if (zstdStream == nullptr || ZSTD_isError(ZSTD_initDStream(zstdStream))) {
+			ZSTD_freeDStream(zstdStream);
+			throw Exception("Decompressor failed to initialize for \"" + fileName + "\"");
+		}
+		stream = zstdStream;
+#else
+		throw Exception("\"" + fileName + "\" is compressed with zstd, but GraDe-A has been built without zstd");
+#endif
+	}
+}
+
+Decompressor::~Decompressor() {
+#ifdef USE_ZLIB
+	if (format == GZIP) {
+		inflateEnd(static_cast<z_stream *>(stream));
+		delete static_cast<z_stream *>(stream);
+	}
+#endif
+#ifdef USE_ZSTD
+	if (format == ZSTD) ZSTD_freeDStream(static_cast<ZSTD_DStream *>(stream));
+#endif
+}
+
+void Decompressor::decompress(const char *& in, const char * inEnd, char *& out, char * outEnd) {
+	while (out != outEnd) {
+		const char * inBefore = in;
+		const char * outBefore = out;
+		step(in, inEnd, out, outEnd);
+		if (in == inBefore && out == outBefore) break;
+	}
+}
+
+void Decompressor::step(const char *& in, const char * inEnd, char *& out, char * outEnd) {
+#ifdef USE_ZLIB
+	if (format == GZIP) {
+		z_stream * gzipStream = static_cast<z_stream *>(stream);
+		if (complete) {
+			if (in == inEnd) return;
+			//the next member of a concatenated file (as written by e.g. pigz) begins
+			inflateReset(gzipStream);
+			complete = false;
+		}
+		gzipStream->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in));
+		gzipStream->avail_in = std::min<size_t>(inEnd - in, UINT_MAX);
+		gzipStream->next_out = reinterpret_cast<Bytef *>(out);
+		gzipStream->avail_out = std::min<size_t>(outEnd - out, UINT_MAX);
+		int status = inflate(gzipStream, Z_NO_FLUSH);
+		in = reinterpret_cast<const char *>(gzipStream->next_in);
+		out = reinterpret_cast<char *>(gzipStream->next_out);
+		if (status == Z_STREAM_END) {
+			complete = true;
+		} else if (status != Z_OK && status != Z_BUF_ERROR) {
+			throw Exception("Decompressor failed to decompress \"" + fileName + "\", the data is corrupt");
+		}
+	}
+#endif
+#ifdef USE_ZSTD
+	if (format == ZSTD) {
+		ZSTD_inBuffer input = {in, size_t(inEnd - in), 0};
+		ZSTD_outBuffer output = {out, size_t(outEnd - out), 0};
+		size_t status = ZSTD_decompressStream(static_cast<ZSTD_DStream *>(stream), &output, &input);
+		if (ZSTD_isError(status)) {
+			throw Exception("Decompressor failed to decompress \"" + fileName + "\": " + ZSTD_getErrorName(status));
+		}
+		in += input.pos;
+		out += output.pos;
+		//a frame is completely decoded and flushed
+		if (input.pos > 0 || output.pos > 0) complete = (status == 0);
+	}
+#endif
+}
@@ -0,0 +1,53 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IO_DECOMPRESSOR_H_
+#define IO_DECOMPRESSOR_H_
+#include "../GradeA_Defs.h"
+
+//!\brief Incremental decompression of gzip and zstd data.
+//! Concatenated gzip members and zstd frames are decompressed one after another, as done by gunzip and unzstd.
+class Decompressor {
+public:
+	enum Format {NONE, GZIP, ZSTD};
+	//!\return The compression format recognized by the magic number at the beginning of \c data.
+	static Format detectFormat(const char * data, size_t numBytes);
+	//!\return A guess of the decompressed size of the complete compressed data [data, data + numBytes).
+	static size_t estimateSize(Format format, const char * data, size_t numBytes);
+	//!\brief Prepares the decompression of the file \c inFileName.
+	//! Throws an \c Exception if the format is not supported by this build.
+	Decompressor(Format inFormat, const std::string & inFileName);
+	virtual ~Decompressor();
+	//!\brief Decompresses as much of [in, inEnd) into [out, outEnd) as possible and advances \c in and \c out.
+	//! Throws an \c Exception if the data is corrupt.
+	void decompress(const char *& in, const char * inEnd, char *& out, char * outEnd);
+	//!\return Whether the data decompressed so far ends with a complete gzip member or zstd frame.
+	bool isComplete() const { return complete;};
+private:
+	Decompressor(const Decompressor &);
+	Decompressor & operator=(const Decompressor &);
+	//!\brief Runs one step of the decompression.
+	void step(const char *& in, const char * inEnd, char *& out, char * outEnd);
+	Format format;
+	std::string fileName;
+	//z_stream or ZSTD_DStream, the library headers are only included by the implementation
+	void * stream = nullptr;
+	bool complete = false;
+};
+
+#endif /* IO_DECOMPRESSOR_H_ */
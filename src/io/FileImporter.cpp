@@ -17,6 +17,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "../io/FileImporter.h"
+#include "../io/Decompressor.h"
+#include "../io/CFGImporter.h"
+#include "../io/LAMMPSTextImporter.h"
+#include "../io/LAMMPSBinaryImporter.h"
+#include "../io/MappedFile.h"
+#include <cstring>
 FileImporter::FileImporter(std::string &inFilename, AtomContainer * inData, FileType inFileType){
 	filename = inFilename;
 	data = inData;
@@ -26,6 +32,115 @@ FileImporter::FileImporter(std::string &inFilename, AtomContainer * inData, File
 FileImporter::~FileImporter() {
 }
 
+FileImporter * FileImporter::create(std::string & filename, AtomContainer * inData) {
+	FileImporter * importers[] = {
+		new CFGImporter(filename, inData),
+		new LAMMPSTextImporter(filename, inData),
+		new LAMMPSBinaryImporter(filename, inData)
+	};
+	const int numImporters = sizeof(importers) / sizeof(importers[0]);
+	FileImporter * importer = nullptr;
+	try {
+		for (int i = 0; i < numImporters && importer == nullptr; i++) {
+			if (importers[i]->checkFileFormat()) importer = importers[i];
+		}
+	} catch (...) {
+		for (int i = 0; i < numImporters; i++) delete importers[i];
+		throw;
+	}
+	for (int i = 0; i < numImporters; i++) {
+		if (importers[i] != importer) delete importers[i];
+	}
+	return importer;
+}
+
+FileImporter * FileImporter::create(FileType type, std::string & filename, AtomContainer * inData) {
+	switch (type) {
+	case cfg:
+		return new CFGImporter(filename, inData);
+	case lammpsText:
+		return new LAMMPSTextImporter(filename, inData);
+	case lammpsBinary:
+		return new LAMMPSBinaryImporter(filename, inData);
+	}
+	return nullptr;
+}
+
+void FileImporter::parseFile() {
+	//the file is mapped into memory and tokenized in place, no line is copied
+	MappedFile file(filename, frame.offset, frame.length);
+	parseText(file.begin(), file.end());
+}
+
+void FileImporter::scanFrames(std::vector<FrameInfo> & frames) {
+	frames.assign(1, FrameInfo());
+}
+
+void FileImporter::setupContainer(const double * size, const double * origin, long nAtoms, const std::vector<std::string> & propertyNames) {
+	if (shard != nullptr) {
+		std::copy(size, size + DIM, shard->size);
+		std::copy(origin, origin + DIM, shard->origin);
+		shard->propertyNames = propertyNames;
+		return;
+	}
+	for (int iP = 0; iP < propertyNames.size(); iP++) {
+		data->addAtomProperty(propertyNames[iP]);
+	}
+	double containerOrigin[DIM] = {origin[0], origin[1], origin[2]};
+	data->setSize(size);
+	data->setOrigin(containerOrigin);
+	data->generate(nAtoms);
+}
+
+void FileImporter::addAtoms(std::vector<double> & positions, long nAtoms, std::vector<double> & propertyValues, const std::vector<bool> & propertyIsFloat) {
+	if (shard != nullptr) {
+		shard->numAtoms = nAtoms;
+		shard->positions.swap(positions);
+		shard->propertyValues.swap(propertyValues);
+		shard->propertyIsFloat = propertyIsFloat;
+		return;
+	}
+	data->addAtoms(positions.data(), nAtoms, propertyValues.data(), propertyIsFloat);
+	if (cache != nullptr) cache->save(data, positions.data(), nAtoms, propertyValues.data(), propertyIsFloat);
+}
+
+void FileImporter::sortAtoms() {
+	if (shard == nullptr) data->sortAtoms();
+}
+
+void FileImporter::parseBeginning(const std::function<void(const char *, const char *, bool)> & parse, bool isText) {
+	//the beginning of the frame is read through a TextReader, which decompresses only the read part of a compressed file
+	TextReader stream(filename, true);
+	stream.skipBytes(frame.offset);
+	std::vector<char> text;
+	size_t numBytes = 0;
+	for (size_t textSize = FILEIMPORTER_HEADERBYTES; ; textSize *= 2) {
+		if (frame.length >= 0 && textSize > size_t(frame.length)) textSize = frame.length;
+		text.resize(textSize);
+		numBytes += stream.readBytes(text.data() + numBytes, textSize - numBytes);
+		bool isComplete = (numBytes < textSize || (frame.length >= 0 && numBytes == size_t(frame.length)));
+		const char * textEnd = text.data() + numBytes;
+		if (isText && !isComplete) {
+			//a line cut at the end might be parsed as a shorter valid line
+			while (textEnd != text.data() && textEnd[-1] != '\n') textEnd--;
+		}
+		try {
+			parse(text.data(), textEnd, isComplete);
+			return;
+		} catch (EndOfFile &) {
+			if (isComplete) throw;
+		}
+	}
+}
+
+void FileImporter::printParseStatistics(double megaBytes, double duration) const {
+#pragma omp critical
+{
+	std::cout << "Thread " << omp_get_thread_num() << ": Parsed " << (shard != nullptr ? shard->numAtoms : data->getNumAtoms()) << " atoms (" << megaBytes << " MB) in "
+		<< duration << " s (" << megaBytes / duration << " MB/s)" << std::endl;
+}
+}
+
 const char* TextReader::readLine()
 {
 	lineNumber++;
@@ -36,6 +151,7 @@ const char* TextReader::readLine()
 
 bool TextReader::eof()
 {
+ if(decompressor != nullptr) return endOfText;
  return fileStream->eof();
 }
 
@@ -44,14 +160,34 @@ long TextReader::getLineNumber()
 	return lineNumber;
 }
 
-TextReader::TextReader(std::string & inFileName)
+TextReader::TextReader(std::string & inFileName, bool binaryMode)
 {
 	filename = inFileName;
 	lineNumber = 0;
 	fileStream = new std::ifstream;
-	fileStream->open(filename.c_str());
+	//compressed files are recognized by their magic number and decompressed block by block while reading
+	char magic[4];
+	std::streamsize numMagicBytes = 0;
+	{
+		std::ifstream magicStream(filename.c_str(), std::ios::binary);
+		magicStream.read(magic, sizeof(magic));
+		numMagicBytes = magicStream.gcount();
+	}
+	Decompressor::Format format = Decompressor::detectFormat(magic, numMagicBytes);
+	fileStream->open(filename.c_str(), (format == Decompressor::NONE && !binaryMode) ? std::ios::in : std::ios::in | std::ios::binary);
 	if(fileStream->fail())
 			throw Exception("TextReader-FileStream failed to open \"" + filename + "\"");
+	if(format != Decompressor::NONE) {
+		try {
+			decompressor = new Decompressor(format, filename);
+		} catch (...) {
+			fileStream->close();
+			delete fileStream;
+			throw;
+		}
+		compressedBuffer.resize(TEXTREADER_BUFFERSIZE);
+		textBuffer.resize(TEXTREADER_BUFFERSIZE);
+	}
 }
 
 TextReader::~TextReader()
@@ -63,6 +199,7 @@ TextReader::~TextReader()
 	if(fileStream->fail())
 		throw Exception("TextReader-FileStream failed to close \"" + filename +"\"");
 	delete fileStream;
+	delete decompressor;
 }
 
 std::string TextReader::lineString()
@@ -72,10 +209,96 @@ std::string TextReader::lineString()
 
 int TextReader::getline()
 {
-	std::getline(*fileStream, line_str);
+	if(decompressor == nullptr) {
+		std::getline(*fileStream, line_str);
+		return line_str.length()+1;
+	}
+	line_str.clear();
+	while(true) {
+		if(textPos == textEnd && !fillTextBuffer()) {
+			endOfText = true;
+			break;
+		}
+		const char * begin = textBuffer.data() + textPos;
+		const char * end = textBuffer.data() + textEnd;
+		const char * newLine = static_cast<const char *>(memchr(begin, '\n', end - begin));
+		if(newLine != nullptr) {
+			line_str.append(begin, newLine);
+			textPos = newLine + 1 - textBuffer.data();
+			break;
+		}
+		line_str.append(begin, end);
+		textPos = textEnd;
+	}
 	return line_str.length()+1;
 }
 
+size_t TextReader::readBytes(char * out, size_t numBytes)
+{
+	if(decompressor == nullptr) {
+		fileStream->read(out, numBytes);
+		size_t numRead = fileStream->gcount();
+		//keep the stream in a good state, the destructor checks it
+		if(fileStream->eof()) fileStream->clear();
+		return numRead;
+	}
+	size_t numRead = 0;
+	while(numRead < numBytes) {
+		if(textPos == textEnd && !fillTextBuffer()) break;
+		size_t numCopied = std::min(numBytes - numRead, textEnd - textPos);
+		memcpy(out + numRead, textBuffer.data() + textPos, numCopied);
+		textPos += numCopied;
+		numRead += numCopied;
+	}
+	return numRead;
+}
+
+void TextReader::skipBytes(long long numBytes)
+{
+	if(decompressor == nullptr) {
+		fileStream->seekg(numBytes, std::ios::cur);
+		return;
+	}
+	//the skipped text of a compressed file is decompressed block by block and dropped
+	while(numBytes > 0) {
+		if(textPos == textEnd && !fillTextBuffer()) break;
+		size_t numSkipped = std::min<long long>(numBytes, textEnd - textPos);
+		textPos += numSkipped;
+		numBytes -= numSkipped;
+	}
+}
+
+bool TextReader::fillTextBuffer()
+{
+	char * out = textBuffer.data();
+	while(true) {
+		if(compressedBegin == compressedEnd && !endOfCompressedFile) {
+			fileStream->read(compressedBuffer.data(), compressedBuffer.size());
+			compressedBegin = compressedBuffer.data();
+			compressedEnd = compressedBegin + fileStream->gcount();
+			if(fileStream->eof()) {
+				//keep the stream in a good state, the destructor checks it
+				fileStream->clear();
+				endOfCompressedFile = true;
+			}
+		}
+		const char * inBefore = compressedBegin;
+		decompressor->decompress(compressedBegin, compressedEnd, out, textBuffer.data() + textBuffer.size());
+		if(out != textBuffer.data()) {
+			textPos = 0;
+			textEnd = out - textBuffer.data();
+			return true;
+		}
+		if(compressedBegin == inBefore && (compressedBegin != compressedEnd || endOfCompressedFile)) {
+			//no progress is possible: either the file ends or it is truncated
+			if(compressedBegin != compressedEnd || !decompressor->isComplete()) {
+				throw Exception("TextReader failed to decompress \"" + filename + "\", the file is truncated or corrupt");
+			}
+			return false;
+		}
+	}
+}
+
 
 
 
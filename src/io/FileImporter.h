@@ -20,12 +20,21 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define FILEIMPORTER_H_
 #include "../GradeA_Defs.h"
 #include "../AtomContainer.h"
+#include "FrameIndex.h"
+#include "PropertySelection.h"
+#include "SnapshotCache.h"
 #include <string>
 #include <exception>
-//PH: All currently supported filetypes (only cfg)
-enum FileType{cfg};
+#include <functional>
+//PH: All currently supported filetypes
+enum FileType{cfg, lammpsText, lammpsBinary};
 //PH: replace Ovito-Matrix3 class with lightweight counterpart
 class TextReader;
+class Decompressor;
+//size of the buffers for the compressed and the decompressed text of a compressed file
+#define TEXTREADER_BUFFERSIZE (1 << 16)
+//size of the first part of a file, which is read to parse its header; it is doubled until the header is complete
+#define FILEIMPORTER_HEADERBYTES (1 << 14)
 class Matrix3{
 public:
 	double get(char i,char j) const{
@@ -107,21 +116,95 @@ struct EndOfFile : public std::exception
 };
 
 
+//!\brief Data of the header of an input file (or of a frame of it), which is read without parsing the atoms.
+struct InputHeader {
+	long numAtoms = 0;
+	double size[DIM] = {0., 0., 0.};
+	//!names of the selected atom properties
+	std::vector<std::string> propertyNames;
+};
+
+//!\brief Parsed atoms of one shard (the file written by one rank) of a frame.
+//! The shards of a frame are parsed in parallel into their own arrays, which are added to the container afterwards.
+struct ParsedShard {
+	double size[DIM] = {0., 0., 0.};
+	double origin[DIM] = {0., 0., 0.};
+	long numAtoms = 0;
+	std::vector<std::string> propertyNames;
+	//!positions of the atoms, property iP of atom i is at iP * numAtoms + i
+	std::vector<double> positions;
+	std::vector<double> propertyValues;
+	std::vector<bool> propertyIsFloat;
+};
+
 class FileImporter {
 public:
 	FileImporter(std::string &filename, AtomContainer * inData, FileType inFileType);
 	virtual ~FileImporter();
+	//!\brief Creates the importer of the first file type, whose format check accepts the file.
+	//!\return The importer (to be deleted by the caller) or nullptr, if the format of the file is not supported.
+	//! Throws an exception if the file cannot be read.
+	static FileImporter * create(std::string & filename, AtomContainer * inData);
+	//!\brief Creates the importer of the given file type, e.g. for the text of a stream, which cannot be checked in advance.
+	static FileImporter * create(FileType type, std::string & filename, AtomContainer * inData);
+	//!\brief Checks if the given file has format that can be read by this importer.
+	virtual bool checkFileFormat() = 0;
+	//!\brief Parses the file (or its frame) and stores the atoms in the container.
+	//! The file is mapped into memory and parsed by parseText().
+	virtual void parseFile();
+	//!\brief Parses the text [text, textEnd) of a whole frame, which has been read already (e.g. from a stream),
+	//! and stores the atoms in the container.
+	virtual void parseText(const char * text, const char * textEnd) = 0;
+	//!\brief Reads only the header of the file (or of its frame), the container is not changed.
+	//! Throws an exception if the header cannot be read or is invalid.
+	virtual void readHeader(InputHeader & inputHeader) = 0;
+	//!\brief Locates the frames of a file with several frames (snapshots).
+	//! The default is a single frame covering the whole file.
+	virtual void scanFrames(std::vector<FrameInfo> & frames);
+	//!\brief Restricts parseFile to one frame of the file.
+	void setFrame(const FrameInfo & inFrame) { frame = inFrame;};
+	//!\brief Sets the columns, which are stored as atom properties, and their types. All columns are stored by default.
+	void setPropertySelection(const PropertySelection & inSelection) { selection = inSelection;};
+	//!\brief Sets the cache, into which the parsed atoms are written, none by default.
+	void setCache(SnapshotCache * inCache) { cache = inCache;};
+	//!\brief Parses the file into \c inShard instead of the container.
+	void setShard(ParsedShard * inShard) { shard = inShard;};
+	FileType getFileType() const { return fileType;};
 protected:
+	//!\brief Prints the number of parsed atoms and the parsing throughput.
+	void printParseStatistics(double megaBytes, double duration) const;
+	//!\brief Adds the properties to the container, sets its size and origin and generates it for \c nAtoms atoms.
+	void setupContainer(const double * size, const double * origin, long nAtoms, const std::vector<std::string> & propertyNames);
+	//!\brief Adds the parsed atoms to the container (see AtomContainer::addAtoms()) and writes them into the cache, if one is set.
+	//! If a shard is set, the arrays are moved into it instead.
+	void addAtoms(std::vector<double> & positions, long nAtoms, std::vector<double> & propertyValues, const std::vector<bool> & propertyIsFloat);
+	//!\brief Sorts all atoms of the container into its boxes.
+	void sortAtoms();
+	//!\brief Calls \c parse with the beginning of the frame, which is extended until \c parse does not throw EndOfFile.
+	//! The third argument of \c parse tells whether the whole frame is given.
+	//!\param[in] isText Whether the beginning of a text file is cut behind its last complete line.
+	void parseBeginning(const std::function<void(const char *, const char *, bool)> & parse, bool isText);
 	std::string filename;
 	FileType fileType;
 	AtomContainer * data;
 	TextReader * reader = nullptr;
+	//!the frame to be parsed, the whole file by default
+	FrameInfo frame;
+	PropertySelection selection;
+	SnapshotCache * cache = nullptr;
+	ParsedShard * shard = nullptr;
 };
 
 class TextReader{
 public:
-	TextReader(std::string & inFileName);
+	//!\param[in] binaryMode Opens a plain file in binary mode, as needed by readBytes.
+	TextReader(std::string & inFileName, bool binaryMode = false);
 	~TextReader();
+	//!\brief Reads up to \c numBytes raw (decompressed) bytes.
+	//!\return The number of bytes read, which is less than \c numBytes only at the end of the file.
+	size_t readBytes(char * out, size_t numBytes);
+	//!\brief Skips \c numBytes raw (decompressed) bytes, a plain file is not read but repositioned.
+	void skipBytes(long long numBytes);
 	bool eof();
 	long getLineNumber();
 	const char* getLine() const { return line_str.c_str(); }
@@ -137,6 +220,9 @@ public:
 	std::string lineString();
 private:
 	int getline();
+	//!\brief Decompresses the next block of a compressed file into textBuffer.
+	//!\return Whether any text has been decompressed.
+	bool fillTextBuffer();
 	// The name of the input file (if known).
 	std::string filename;
 	/// Buffer holding the current text line.
@@ -145,6 +231,17 @@ private:
 	std::ifstream * fileStream = nullptr;
 	/// The current line number.
 	long lineNumber;
+	/// Decompressor of gzip or zstd files, nullptr for plain text files.
+	Decompressor * decompressor = nullptr;
+	/// Bounded buffers of a compressed file, which are refilled while the lines are read.
+	std::vector<char> compressedBuffer;
+	std::vector<char> textBuffer;
+	const char * compressedBegin = nullptr;
+	const char * compressedEnd = nullptr;
+	size_t textPos = 0;
+	size_t textEnd = 0;
+	bool endOfCompressedFile = false;
+	bool endOfText = false;
 	/// The current position in the uncompressed data stream.
 	//long byteOffset;
 
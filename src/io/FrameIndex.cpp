@@ -0,0 +1,128 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FrameIndex.h"
+#include "FileImporter.h"
+#include "TextTokenizer.h"
+#include <sys/stat.h>
+#include <fstream>
+#include <cstring>
+
+#define FRAMEINDEX_HEADER "GraDe-A frame index"
+
+FrameIndex::FrameIndex(const std::string & inFileName) {
+	fileName = inFileName;
+	indexFileName = fileName + ".frames";
+}
+
+void FrameIndex::load() {
+	struct stat fileStatus;
+	if (stat(fileName.c_str(), &fileStatus) != 0) {
+		throw Exception("FrameIndex failed to read the size of \"" + fileName + "\"");
+	}
+	fileSize = fileStatus.st_size;
+	modificationTime = fileStatus.st_mtime;
+	if (read()) return;
+	scan();
+	write();
+}
+
+bool FrameIndex::read() {
+	std::ifstream stream(indexFileName.c_str());
+	if (stream.fail()) return false;
+	std::string header;
+	std::getline(stream, header);
+	if (header != FRAMEINDEX_HEADER) return false;
+	//the index belongs to a former version of the file, if its size or modification time differ
+	long long indexedFileSize, indexedModificationTime;
+	long numFrames;
+	stream >> indexedFileSize >> indexedModificationTime >> numFrames;
+	if (stream.fail() || indexedFileSize != fileSize || indexedModificationTime != modificationTime || numFrames <= 0) {
+		return false;
+	}
+	frames.resize(numFrames);
+	for (long iF = 0; iF < numFrames; iF++) {
+		stream >> frames[iF].offset >> frames[iF].length >> frames[iF].numAtoms >> frames[iF].timeStep;
+	}
+	if (stream.fail()) {
+		frames.clear();
+		return false;
+	}
+	return true;
+}
+
+void FrameIndex::write() const {
+	std::ofstream stream(indexFileName.c_str());
+	if (!stream.fail()) {
+		stream << FRAMEINDEX_HEADER << "\n";
+		stream << fileSize << " " << modificationTime << " " << frames.size() << "\n";
+		for (size_t iF = 0; iF < frames.size(); iF++) {
+			stream << frames[iF].offset << " " << frames[iF].length << " " << frames[iF].numAtoms << " " << frames[iF].timeStep << "\n";
+		}
+		stream.close();
+	}
+	if (stream.fail()) {
+		//the index is only an optimization, the file is scanned again by the next run
+#pragma omp critical
+{
+		std::cerr << "Could not write the frame index \"" << indexFileName << "\"." << std::endl;
+}
+	}
+}
+
+void FrameIndex::scan() {
+	std::string name = fileName;
+	FileImporter * importer = FileImporter::create(name, nullptr);
+	if (importer == nullptr) {
+		throw Exception("File \"" + fileName + "\" has an unsupported format");
+	}
+	try {
+		importer->scanFrames(frames);
+	} catch (...) {
+		delete importer;
+		throw;
+	}
+	delete importer;
+	scanned = true;
+}
+
+void FrameIndex::findLines(const char * text, const char * textEnd, const char * prefix, std::vector<const char *> & lines) {
+	size_t prefixLength = strlen(prefix);
+	long nChunks = 1;
+	if (omp_get_max_threads() > 1) {
+		nChunks = std::max<long>(std::min<long>(omp_get_max_threads() * FRAMEINDEX_CHUNKSPERTHREAD, (textEnd - text) / FRAMEINDEX_MINCHUNKSIZE), 1);
+	}
+	std::vector<const char *> chunkBegins;
+	tok::splitChunks(text, textEnd, nChunks, chunkBegins);
+	std::vector<std::vector<const char *> > chunkLines(nChunks);
+#pragma omp parallel for schedule(dynamic,1)
+	for (long iC = 0; iC < nChunks; iC++) {
+		const char * chunkEnd = chunkBegins[iC + 1];
+		for (const char * lineBegin = chunkBegins[iC]; lineBegin != chunkEnd;) {
+			const char * lineEnd = tok::lineEnd(lineBegin, chunkEnd);
+			if (size_t(lineEnd - lineBegin) >= prefixLength && memcmp(lineBegin, prefix, prefixLength) == 0) {
+				chunkLines[iC].push_back(lineBegin);
+			}
+			lineBegin = tok::nextLine(lineEnd, chunkEnd);
+		}
+	}
+	lines.clear();
+	for (long iC = 0; iC < nChunks; iC++) {
+		lines.insert(lines.end(), chunkLines[iC].begin(), chunkLines[iC].end());
+	}
+}
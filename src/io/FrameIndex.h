@@ -0,0 +1,68 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IO_FRAMEINDEX_H_
+#define IO_FRAMEINDEX_H_
+#include "../GradeA_Defs.h"
+
+//! Number of chunks per thread, into which a file is split to search the beginnings of its frames.
+#define FRAMEINDEX_CHUNKSPERTHREAD 4
+//! Minimum size of a chunk in bytes.
+#define FRAMEINDEX_MINCHUNKSIZE (1 << 20)
+
+//!\brief Location of one frame (snapshot) inside a file, which holds several frames.
+struct FrameInfo {
+	//!first byte of the frame in the (decompressed) file
+	long long offset = 0;
+	//!size of the frame in bytes, -1 for the rest of the file
+	long long length = -1;
+	long numAtoms = 0;
+	//!time step of the frame as written in the file, the number of the frame if the file has no time steps
+	long long timeStep = 0;
+};
+
+//!\brief Index of the frames of a file, which is stored in the sidecar file "<file>.frames" next to it.
+//! The file is scanned once by its importer, later runs read the sidecar file instead,
+//! as long as the size and the modification time of the file are unchanged.
+class FrameIndex {
+public:
+	FrameIndex(const std::string & inFileName);
+	~FrameIndex(){};
+	//!\brief Reads the index from the sidecar file or scans the file and writes the sidecar file.
+	//! Throws an exception if the file cannot be read or has an unsupported format.
+	void load();
+	const std::vector<FrameInfo> & getFrames() const { return frames;};
+	//!\return Whether the file has been scanned, instead of reading the sidecar file.
+	bool isScanned() const { return scanned;};
+	//!\brief Finds all lines of [\c text, \c textEnd), which begin with \c prefix. The text is searched in parallel chunks.
+	//!\param[out] lines The beginnings of the lines in ascending order.
+	static void findLines(const char * text, const char * textEnd, const char * prefix, std::vector<const char *> & lines);
+private:
+	//!\return Whether a sidecar file matching the file has been read.
+	bool read();
+	void write() const;
+	void scan();
+	std::string fileName;
+	std::string indexFileName;
+	long long fileSize = -1;
+	long long modificationTime = -1;
+	std::vector<FrameInfo> frames;
+	bool scanned = false;
+};
+
+#endif /* IO_FRAMEINDEX_H_ */
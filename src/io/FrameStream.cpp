@@ -0,0 +1,154 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FrameStream.h"
+#include "CFGHeaderData.h"
+#include "TextTokenizer.h"
+#include <cstring>
+#if !defined(WINDOWS) || defined(CYGWIN)
+#include <sys/stat.h>
+#endif
+
+FrameStream::FrameStream(const std::string & inName) {
+	name = inName;
+	if (name == "-") {
+		file = stdin;
+	} else {
+		file = fopen(name.c_str(), "rb");
+		if (file == nullptr) {
+			throw Exception("FrameStream failed to open \"" + name + "\"");
+		}
+	}
+	lineBuffer.resize(FRAMESTREAM_LINEBYTES);
+}
+
+FrameStream::~FrameStream() {
+	if (file != nullptr && file != stdin) {
+		fclose(file);
+	}
+}
+
+bool FrameStream::isStream(const std::string & name) {
+	if (name == "-") return true;
+#if !defined(WINDOWS) || defined(CYGWIN)
+	struct stat fileStatus;
+	return stat(name.c_str(), &fileStatus) == 0 && S_ISFIFO(fileStatus.st_mode);
+#else
+	return false;
+#endif
+}
+
+std::string FrameStream::getName() const {
+	if (name == "-") return "stdin";
+	size_t dirPos = name.rfind(DIRCHAR);
+	return (dirPos == std::string::npos) ? name : name.substr(dirPos + 1);
+}
+
+bool FrameStream::readLine(std::vector<char> & text, size_t & lineBegin) {
+	lineBegin = text.size();
+	//fgets returns as soon as a line has arrived, a long line is read in several pieces
+	while (fgets(lineBuffer.data(), lineBuffer.size(), file) != nullptr) {
+		size_t numBytes = strlen(lineBuffer.data());
+		text.insert(text.end(), lineBuffer.data(), lineBuffer.data() + numBytes);
+		if (numBytes > 0 && lineBuffer[numBytes - 1] == '\n') return true;
+	}
+	//the last line of the stream may lack its newline
+	return text.size() > lineBegin;
+}
+
+bool FrameStream::nextFrame(std::vector<char> & text) {
+	//empty lines between the frames are skipped
+	do {
+		text.clear();
+		size_t lineBegin;
+		if (!readLine(text, lineBegin)) return false;
+	} while (tok::countFields(text.data(), tok::lineEnd(text.data(), text.data() + text.size()), 1) == 0);
+	const char * cfgStart = "Number of particles";
+	const char * lammpsStart = "ITEM:";
+	if (text.size() >= strlen(cfgStart) && strncmp(text.data(), cfgStart, strlen(cfgStart)) == 0) {
+		fileType = cfg;
+		readCFGFrame(text);
+	} else if (text.size() >= strlen(lammpsStart) && strncmp(text.data(), lammpsStart, strlen(lammpsStart)) == 0) {
+		fileType = lammpsText;
+		readLAMMPSFrame(text);
+	} else {
+		throw Exception("Stream \"" + getName() + "\" contains a frame, which is neither a CFG file nor a LAMMPS text dump");
+	}
+	return true;
+}
+
+void FrameStream::readCFGFrame(std::vector<char> & text) {
+	size_t lineBegin = 0;
+	//the header ends in front of the first line, which is no header line
+	CFGHeaderData header;
+	const char * dataBegin;
+	while (true) {
+		header = CFGHeaderData();
+		dataBegin = header.parse(text.data(), text.data() + text.size());
+		if (dataBegin != text.data() + text.size()) break;
+		if (!readLine(text, lineBegin)) return;
+	}
+	if (!header.isExtendedFormat()) {
+		throw Exception("Only the extended CFG format is supported.");
+	}
+	//the atom lines are counted as in the CFG importer: each type begins with a mass line and a name line
+	long numAtoms = 0;
+	int nEntries = header.getEntryCount();
+	bool beforeName = false;
+	size_t pos = dataBegin - text.data();
+	while (true) {
+		while (pos < text.size()) {
+			const char * textEnd = text.data() + text.size();
+			const char * lineEnd = tok::lineEnd(text.data() + pos, textEnd);
+			int nFields = tok::countFields(text.data() + pos, lineEnd, nEntries + 1);
+			pos = tok::nextLine(lineEnd, textEnd) - text.data();
+			if (beforeName) {
+				beforeName = false;
+			} else if (nFields == 1) {
+				beforeName = true;
+			} else if (nFields == nEntries) {
+				numAtoms++;
+			}
+		}
+		if (numAtoms >= header.getNumParticles()) return;
+		if (!readLine(text, lineBegin)) return;
+	}
+}
+
+void FrameStream::readLAMMPSFrame(std::vector<char> & text) {
+	size_t lineBegin = 0;
+	long numAtoms = -1;
+	//the items of the header are read up to the ATOMS item, which is followed by one line per atom
+	while (true) {
+		const char * textEnd = text.data() + text.size();
+		std::vector<std::string> item = tok::fieldStrings(text.data() + lineBegin, tok::lineEnd(text.data() + lineBegin, textEnd));
+		if (item.size() >= 2 && item[0] == "ITEM:") {
+			if (item[1] == "ATOMS") break;
+			if (item[1] == "NUMBER") {
+				if (!readLine(text, lineBegin)) return;
+				std::vector<std::string> values = tok::fieldStrings(text.data() + lineBegin,
+						tok::lineEnd(text.data() + lineBegin, text.data() + text.size()));
+				if (values.size() > 0) numAtoms = atol(values[0].c_str());
+			}
+		}
+		if (!readLine(text, lineBegin)) return;
+	}
+	for (long iA = 0; iA < numAtoms; iA++) {
+		if (!readLine(text, lineBegin)) return;
+	}
+}
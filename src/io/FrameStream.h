@@ -0,0 +1,63 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IO_FRAMESTREAM_H_
+#define IO_FRAMESTREAM_H_
+#include "FileImporter.h"
+#include <cstdio>
+
+//size of the pieces, in which the lines of a stream are read
+#define FRAMESTREAM_LINEBYTES (1 << 16)
+
+//!\brief Sequential reader of the frames of a stream, i.e. the standard input or a named pipe (FIFO).
+//! The frames (CFG files or LAMMPS text dumps written one after another) are read line by line as they arrive.
+//! A frame is complete as soon as its last atom line has been read, so it is computed before the next frame is written.
+class FrameStream {
+public:
+	//!\param[in] inName "-" for the standard input, else the path of a named pipe.
+	//! Throws an \c Exception if the pipe cannot be opened.
+	FrameStream(const std::string & inName);
+	~FrameStream();
+	//!\return Whether \c name is read as a stream, i.e. it is "-" or a named pipe.
+	static bool isStream(const std::string & name);
+	//!\brief Reads the next frame into \c text.
+	//!\return false at the end of the stream. A frame cut by the end of the stream is returned incomplete.
+	//! Throws an \c Exception if the frame is neither a CFG file nor a LAMMPS text dump or has an invalid CFG header.
+	bool nextFrame(std::vector<char> & text);
+	//!\return The format of the frame read last.
+	FileType getFileType() const { return fileType;};
+	//!\return "stdin" or the file name of the pipe without its directory, which names the output files.
+	std::string getName() const;
+private:
+	FrameStream(const FrameStream &);
+	FrameStream & operator=(const FrameStream &);
+	//!\brief Appends the next line (with its newline) to \c text.
+	//!\param[out] lineBegin Index of the first character of the line in \c text.
+	//!\return false at the end of the stream.
+	bool readLine(std::vector<char> & text, size_t & lineBegin);
+	//!\brief Reads the lines of a CFG frame up to its last atom, the first line is in \c text.
+	void readCFGFrame(std::vector<char> & text);
+	//!\brief Reads the lines of a LAMMPS text dump frame up to its last atom, the first line is in \c text.
+	void readLAMMPSFrame(std::vector<char> & text);
+	std::string name;
+	FILE * file = nullptr;
+	std::vector<char> lineBuffer;
+	FileType fileType = cfg;
+};
+
+#endif /* IO_FRAMESTREAM_H_ */
@@ -0,0 +1,221 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LAMMPSBinaryImporter.h"
+#include "MappedFile.h"
+#include "TextTokenizer.h"
+#include "../StopWatch.h"
+#include <cstring>
+#include <cmath>
+
+namespace {
+//sequential reader of the values of a binary file, which throws EndOfFile at the end of the data
+class BinaryReader {
+public:
+	BinaryReader(const char * inPos, const char * inEnd) : pos(inPos), end(inEnd){};
+	template<typename T> T read() {
+		T value;
+		memcpy(&value, advance(sizeof(T)), sizeof(T));
+		return value;
+	}
+	std::string readString(size_t length) {
+		const char * begin = advance(length);
+		return std::string(begin, begin + length);
+	}
+	//!\return The current position, which is moved by numBytes.
+	const char * advance(size_t numBytes) {
+		if (size_t(end - pos) < numBytes) throw EndOfFile();
+		const char * begin = pos;
+		pos += numBytes;
+		return begin;
+	}
+	const char * position() const { return pos;};
+private:
+	const char * pos;
+	const char * end;
+};
+
+//magic strings of the current format, written after the negative length of the string
+const char * magicPrefix = "DUMP";
+const size_t maxMagicLength = 32;
+
+bool endsWith(const std::string & s, const std::string & ending) {
+	return s.length() >= ending.length() && s.compare(s.length() - ending.length(), ending.length(), ending) == 0;
+}
+}
+
+bool LAMMPSBinaryImporter::checkFileFormat() {
+	TextReader stream(filename, true);
+	char start[sizeof(int64_t) + maxMagicLength];
+	size_t numBytes = stream.readBytes(start, sizeof(start));
+	if (numBytes < sizeof(int64_t)) return false;
+	int64_t firstValue;
+	memcpy(&firstValue, start, sizeof(int64_t));
+	if (firstValue < 0) {
+		size_t magicLength = -firstValue;
+		return magicLength <= maxMagicLength && numBytes >= sizeof(int64_t) + magicLength
+				&& strncmp(start + sizeof(int64_t), magicPrefix, strlen(magicPrefix)) == 0;
+	}
+	//the former format has no magic string, LAMMPS writes binary dumps to files ending with .bin
+	std::string plainName = filename;
+	if (endsWith(plainName, ".gz")) plainName.resize(plainName.length() - 3);
+	if (endsWith(plainName, ".zst")) plainName.resize(plainName.length() - 4);
+	return endsWith(plainName, ".bin");
+}
+
+void LAMMPSBinaryImporter::parseText(const char * fileBegin, const char * fileEnd) {
+	const char * atomData = parseHeader(fileBegin, fileEnd);
+	initContainer();
+	StopWatch parseWatch;
+	parseWatch.trigger();
+	parseAtoms(atomData, fileEnd);
+	parseWatch.trigger();
+	printParseStatistics((fileEnd - atomData) / 1.e6, parseWatch.getDuration());
+	//sort all atoms into the boxes at once
+	sortAtoms();
+}
+
+void LAMMPSBinaryImporter::readHeader(InputHeader & inputHeader) {
+	parseBeginning([this](const char * fileBegin, const char * fileEnd, bool) {
+		parseHeader(fileBegin, fileEnd);
+	}, false);
+	getInputHeader(inputHeader);
+}
+
+void LAMMPSBinaryImporter::scanFrames(std::vector<FrameInfo> & frames) {
+	MappedFile file(filename);
+	frames.clear();
+	const char * frameBegin = file.begin();
+	while (frameBegin != file.end()) {
+		const char * frameEnd;
+		try {
+			//the chunks are skipped by their sizes, without reading the values
+			BinaryReader reader(parseHeader(frameBegin, file.end()), file.end());
+			int nChunks = reader.read<int>();
+			for (int iC = 0; iC < nChunks; iC++) {
+				reader.advance(reader.read<int>() * sizeof(double));
+			}
+			frameEnd = reader.position();
+		} catch (EndOfFile &) {
+			break;
+		}
+		FrameInfo frameInfo;
+		frameInfo.offset = frameBegin - file.begin();
+		frameInfo.length = frameEnd - frameBegin;
+		frameInfo.numAtoms = numAtoms;
+		frameInfo.timeStep = timeStep;
+		frames.push_back(frameInfo);
+		frameBegin = frameEnd;
+	}
+	if (frames.empty()) throw EndOfFile();
+}
+
+const char * LAMMPSBinaryImporter::parseHeader(const char * fileBegin, const char * fileEnd) {
+	BinaryReader reader(fileBegin, fileEnd);
+	timeStep = reader.read<int64_t>();
+	bool hasMagic = (timeStep < 0);
+	int revision = 1;
+	if (hasMagic) {
+		reader.advance(-timeStep);
+		if (reader.read<int>() != 1) {
+			throw Exception("Binary LAMMPS dump \"" + filename + "\" has been written with a different byte order");
+		}
+		revision = reader.read<int>();
+		timeStep = reader.read<int64_t>();
+	}
+	numAtoms = reader.read<int64_t>();
+	int triclinic = reader.read<int>();
+	//boundary flags
+	reader.advance(6 * sizeof(int));
+	double boundsLo[DIM], boundsHi[DIM], tilt[DIM] = {0., 0., 0.};
+	for (int d = 0; d < DIM; d++) {
+		boundsLo[d] = reader.read<double>();
+		boundsHi[d] = reader.read<double>();
+	}
+	if (triclinic) {
+		for (int d = 0; d < DIM; d++) tilt[d] = reader.read<double>();
+	}
+	int valuesPerAtom = reader.read<int>();
+	std::string columns;
+	if (hasMagic && revision > 1) {
+		//units, time and column names have been added with revision 2
+		reader.advance(reader.read<int>());
+		if (reader.read<char>()) reader.read<double>();
+		columns = reader.readString(reader.read<int>());
+	}
+	if (columns.empty()) {
+		if (valuesPerAtom == 5) columns = "id type xs ys zs";
+		else if (valuesPerAtom == 8) columns = "id type xs ys zs ix iy iz";
+		else throw Exception("Binary LAMMPS dump \"" + filename + "\" has no column names");
+	}
+	setColumns(tok::fieldStrings(columns.data(), columns.data() + columns.length()));
+	if (numColumns != valuesPerAtom) {
+		throw Exception("Binary LAMMPS dump \"" + filename + "\" has more column names than values per atom");
+	}
+	setBox(boundsLo, boundsHi, tilt);
+	return reader.position();
+}
+
+void LAMMPSBinaryImporter::parseAtoms(const char * dataBegin, const char * fileEnd) {
+	int nProperties = propertyColumns.size();
+	//each processor has written a chunk of atoms, the chunks are located first to parse them in parallel
+	BinaryReader reader(dataBegin, fileEnd);
+	int nChunks = reader.read<int>();
+	std::vector<const char *> chunkValues(nChunks);
+	std::vector<long> chunkFirstAtom(nChunks + 1, 0);
+	for (int iC = 0; iC < nChunks; iC++) {
+		int nValues = reader.read<int>();
+		chunkValues[iC] = reader.advance(nValues * sizeof(double));
+		chunkFirstAtom[iC + 1] = chunkFirstAtom[iC] + nValues / numColumns;
+	}
+	if (chunkFirstAtom[nChunks] < numAtoms) {
+		throw EndOfFile();
+	}
+	std::vector<double> positions(DIM * numAtoms);
+	std::vector<double> propertyValues(nProperties * numAtoms);
+	//a property is an integer property, if all its values are integral
+	std::vector<char> propertyIsFloatPerChunk(nChunks * nProperties, false);
+#pragma omp parallel for schedule(dynamic,1)
+	for (int iC = 0; iC < nChunks; iC++) {
+		long lastAtom = std::min(chunkFirstAtom[iC + 1], numAtoms);
+		const char * values = chunkValues[iC];
+		for (long atomNum = chunkFirstAtom[iC]; atomNum < lastAtom; atomNum++, values += numColumns * sizeof(double)) {
+			//the values are not aligned inside the file
+			double * position = positions.data() + DIM * atomNum;
+			for (int d = 0; d < DIM; d++) {
+				memcpy(position + d, values + positionColumns[d] * sizeof(double), sizeof(double));
+			}
+			toContainerPosition(position);
+			for (int iP = 0; iP < nProperties; iP++) {
+				double value;
+				memcpy(&value, values + propertyColumns[iP] * sizeof(double), sizeof(double));
+				//the values of an int property are truncated as by the conversion of a text field
+				if (propertyTypes[iP] == intProperty) value = std::trunc(value);
+				propertyValues[iP * numAtoms + atomNum] = value;
+				if (propertyTypes[iP] == inferredProperty && value != std::floor(value)) propertyIsFloatPerChunk[iC * nProperties + iP] = true;
+			}
+		}
+	}
+	std::vector<bool> propertyIsFloat(nProperties, false);
+	for (int iC = 0; iC < nChunks; iC++) {
+		for (int iP = 0; iP < nProperties; iP++) {
+			if (propertyIsFloatPerChunk[iC * nProperties + iP]) propertyIsFloat[iP] = true;
+		}
+	}
+	addParsedAtoms(positions, propertyValues, propertyIsFloat);
+}
@@ -0,0 +1,47 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IO_LAMMPSBINARYIMPORTER_H_
+#define IO_LAMMPSBINARYIMPORTER_H_
+#include "LAMMPSDumpImporter.h"
+
+//!\brief Importer of binary LAMMPS dumps (dump atom or dump custom to a file ending with .bin).
+//! The per-atom values are copied from the mapped file into the container, without any conversion to text.
+//! The file has to be written with the byte order of this machine and with 64-bit bigints (the LAMMPS default).
+//! Files of the former format without column names are read as dump atom files (id type xs ys zs [ix iy iz]).
+class LAMMPSBinaryImporter : public LAMMPSDumpImporter {
+public:
+	LAMMPSBinaryImporter(std::string & inFilename, AtomContainer * inData) : LAMMPSDumpImporter(inFilename, inData, lammpsBinary){};
+	virtual ~LAMMPSBinaryImporter(){};
+	//!\brief A binary dump begins with the magic string of the current format.
+	//! Files of the former format are recognized by the file name ending .bin.
+	virtual bool checkFileFormat();
+	virtual void parseText(const char * text, const char * textEnd);
+	virtual void readHeader(InputHeader & inputHeader);
+	//!\brief Walks through the headers and chunks of all frames. An incomplete last frame is left out.
+	virtual void scanFrames(std::vector<FrameInfo> & frames);
+private:
+	//!\brief Reads the header of the first frame, sets up the columns and the box.
+	//!\return The position of the number of per-processor chunks.
+	const char * parseHeader(const char * fileBegin, const char * fileEnd);
+	//!\brief Reads the per-processor chunks of the first frame and adds the atoms to the container.
+	void parseAtoms(const char * dataBegin, const char * fileEnd);
+	int64_t timeStep = 0;
+};
+
+#endif /* IO_LAMMPSBINARYIMPORTER_H_ */
@@ -0,0 +1,91 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LAMMPSDumpImporter.h"
+
+void LAMMPSDumpImporter::setColumns(const std::vector<std::string> & columnNames) {
+	//position columns in the order of preference: wrapped before unwrapped, Cartesian before scaled
+	const char * positionNames[4][DIM] = {
+		{"x", "y", "z"}, {"xu", "yu", "zu"}, {"xs", "ys", "zs"}, {"xsu", "ysu", "zsu"}
+	};
+	numColumns = columnNames.size();
+	for (int iSet = 0; iSet < 4 && positionColumns[0] < 0; iSet++) {
+		int columns[DIM] = {-1, -1, -1};
+		for (int iC = 0; iC < numColumns; iC++) {
+			for (int d = 0; d < DIM; d++) {
+				if (columnNames[iC] == positionNames[iSet][d]) columns[d] = iC;
+			}
+		}
+		if (columns[0] >= 0 && columns[1] >= 0 && columns[2] >= 0) {
+			std::copy(columns, columns + DIM, positionColumns);
+			scaledPositions = (iSet >= 2);
+		}
+	}
+	if (positionColumns[0] < 0) {
+		throw Exception("LAMMPS dump \"" + filename + "\" contains no atom positions");
+	}
+	propertyColumns.clear();
+	propertyNames.clear();
+	propertyTypes.clear();
+	for (int iC = 0; iC < numColumns; iC++) {
+		if (iC == positionColumns[0] || iC == positionColumns[1] || iC == positionColumns[2]) continue;
+		//the chemical element is the only non-numeric column
+		if (columnNames[iC] == "element") continue;
+		//columns, which are not selected, are skipped while parsing
+		if (!selection.isSelected(columnNames[iC])) continue;
+		propertyColumns.push_back(iC);
+		propertyNames.push_back(columnNames[iC]);
+		propertyTypes.push_back(selection.getType(columnNames[iC]));
+	}
+}
+
+void LAMMPSDumpImporter::setBox(const double * inBoundsLo, const double * inBoundsHi, const double * inTilt) {
+	std::copy(inBoundsLo, inBoundsLo + DIM, boundsLo);
+	std::copy(inBoundsHi, inBoundsHi + DIM, boundsHi);
+	std::copy(inTilt, inTilt + DIM, tilt);
+	//the bounding box of a triclinic cell is extended by the tilt factors (see the LAMMPS documentation of dump)
+	double xy = tilt[0], xz = tilt[1], yz = tilt[2];
+	lo[0] = boundsLo[0] - std::min(std::min(0., xy), std::min(xz, xy + xz));
+	lo[1] = boundsLo[1] - std::min(0., yz);
+	lo[2] = boundsLo[2];
+	cellLength[0] = boundsHi[0] - std::max(std::max(0., xy), std::max(xz, xy + xz)) - lo[0];
+	cellLength[1] = boundsHi[1] - std::max(0., yz) - lo[1];
+	cellLength[2] = boundsHi[2] - lo[2];
+}
+
+void LAMMPSDumpImporter::initContainer() {
+	double size[DIM] = {boundsHi[0] - boundsLo[0], boundsHi[1] - boundsLo[1], boundsHi[2] - boundsLo[2]};
+	double origin[DIM] = {0., 0., 0.};
+	setupContainer(size, origin, numAtoms, propertyNames);
+}
+
+void LAMMPSDumpImporter::getInputHeader(InputHeader & inputHeader) const {
+	inputHeader.numAtoms = numAtoms;
+	for (int d = 0; d < DIM; d++) {
+		inputHeader.size[d] = boundsHi[d] - boundsLo[d];
+	}
+	inputHeader.propertyNames = propertyNames;
+}
+
+void LAMMPSDumpImporter::addParsedAtoms(std::vector<double> & positions, std::vector<double> & propertyValues,
+		std::vector<bool> propertyIsFloat) {
+	for (int iP = 0; iP < propertyTypes.size(); iP++) {
+		if (propertyTypes[iP] == floatProperty) propertyIsFloat[iP] = true;
+	}
+	addAtoms(positions, numAtoms, propertyValues, propertyIsFloat);
+}
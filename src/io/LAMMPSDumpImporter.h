@@ -0,0 +1,78 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IO_LAMMPSDUMPIMPORTER_H_
+#define IO_LAMMPSDUMPIMPORTER_H_
+#include "FileImporter.h"
+
+//!\brief Base class of the importers of LAMMPS dump files (text and binary).
+//! It maps the dump columns to positions and atom properties and sets up the container from the box bounds.
+//! Positions are stored relative to the lower corner of the (bounding) box, so that the origin of the container is 0 as for CFG files.
+class LAMMPSDumpImporter : public FileImporter {
+public:
+	LAMMPSDumpImporter(std::string & inFilename, AtomContainer * inData, FileType inFileType) : FileImporter(inFilename, inData, inFileType){};
+	virtual ~LAMMPSDumpImporter(){};
+protected:
+	//!\brief Assigns the columns: x y z (or the unwrapped xu yu zu) are Cartesian positions,
+	//! xs ys zs (or xsu ysu zsu) are scaled positions, all other numeric columns become atom properties, if they are selected.
+	//! Throws an \c Exception if no complete set of position columns is found.
+	void setColumns(const std::vector<std::string> & columnNames);
+	//!\brief Sets the box from the bounds as written by LAMMPS.
+	//! For a triclinic box the bounds are the ones of the bounding box and \c tilt holds xy, xz, yz.
+	void setBox(const double * boundsLo, const double * boundsHi, const double * tilt);
+	//!\brief Adds the atom properties to the container, sets its size and generates it for \c numAtoms atoms.
+	void initContainer();
+	//!\brief Copies the number of atoms, the box size and the selected properties of the parsed header.
+	void getInputHeader(InputHeader & inputHeader) const;
+	//!\brief Converts the values of the position columns into a position relative to the lower corner of the bounding box.
+	inline void toContainerPosition(double * pos) const {
+		if (scaledPositions) {
+			//scaled coordinates are given in the basis of the (triclinic) cell vectors
+			pos[0] = lo[0] + pos[0] * cellLength[0] + pos[1] * tilt[0] + pos[2] * tilt[1];
+			pos[1] = lo[1] + pos[1] * cellLength[1] + pos[2] * tilt[2];
+			pos[2] = lo[2] + pos[2] * cellLength[2];
+		}
+		pos[0] -= boundsLo[0];
+		pos[1] -= boundsLo[1];
+		pos[2] -= boundsLo[2];
+	}
+	//!\brief Adds the parsed atoms to the container.
+	//!\param[in] positions Positions of all atoms converted by toContainerPosition.
+	//!\param[in] propertyValues Values of the property columns, property iP of atom i is at iP * numAtoms + i.
+	//!\param[in] propertyIsFloat Whether a value of a property has been a floating point number, a float property is always stored as float.
+	//! The arrays may be moved into a shard.
+	void addParsedAtoms(std::vector<double> & positions, std::vector<double> & propertyValues,
+			std::vector<bool> propertyIsFloat);
+	long numAtoms = 0;
+	//number of columns per atom, index of the x, y and z column and of the property columns
+	int numColumns = 0;
+	int positionColumns[DIM] = {-1, -1, -1};
+	bool scaledPositions = false;
+	std::vector<int> propertyColumns;
+	std::vector<std::string> propertyNames;
+	std::vector<PropertyType> propertyTypes;
+private:
+	//bounding box, lower corner of the (triclinic) cell, lengths of the cell vectors along their axis and tilt factors xy, xz, yz
+	double boundsLo[DIM] = {0., 0., 0.};
+	double boundsHi[DIM] = {0., 0., 0.};
+	double lo[DIM] = {0., 0., 0.};
+	double cellLength[DIM] = {0., 0., 0.};
+	double tilt[DIM] = {0., 0., 0.};
+};
+
+#endif /* IO_LAMMPSDUMPIMPORTER_H_ */
@@ -0,0 +1,217 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LAMMPSTextImporter.h"
+#include "MappedFile.h"
+#include "TextTokenizer.h"
+#include "../StopWatch.h"
+
+bool LAMMPSTextImporter::checkFileFormat() {
+	TextReader stream(filename);
+	stream.readLine();
+	return stream.lineStartsWith("ITEM:");
+}
+
+void LAMMPSTextImporter::parseText(const char * text, const char * textEnd) {
+	const char * atomText = parseHeader(text, textEnd);
+	initContainer();
+	StopWatch parseWatch;
+	parseWatch.trigger();
+	parseAtoms(atomText, textEnd);
+	parseWatch.trigger();
+	printParseStatistics((textEnd - atomText) / 1.e6, parseWatch.getDuration());
+	//sort all atoms into the boxes at once
+	sortAtoms();
+}
+
+void LAMMPSTextImporter::readHeader(InputHeader & inputHeader) {
+	parseBeginning([this](const char * text, const char * textEnd, bool) {
+		numHeaderLines = 0;
+		parseHeader(text, textEnd);
+	}, true);
+	getInputHeader(inputHeader);
+}
+
+void LAMMPSTextImporter::scanFrames(std::vector<FrameInfo> & frames) {
+	MappedFile file(filename);
+	std::vector<const char *> frameBegins;
+	FrameIndex::findLines(file.begin(), file.end(), "ITEM: TIMESTEP", frameBegins);
+	frames.clear();
+	for (size_t iF = 0; iF < frameBegins.size(); iF++) {
+		const char * frameEnd = (iF + 1 < frameBegins.size()) ? frameBegins[iF + 1] : file.end();
+		FrameInfo frameInfo;
+		try {
+			parseHeader(frameBegins[iF], frameEnd);
+		} catch (EndOfFile &) {
+			if (iF + 1 == frameBegins.size()) break;
+			throw;
+		}
+		frameInfo.offset = frameBegins[iF] - file.begin();
+		frameInfo.length = frameEnd - frameBegins[iF];
+		frameInfo.numAtoms = numAtoms;
+		frameInfo.timeStep = timeStep;
+		frames.push_back(frameInfo);
+	}
+	if (frames.empty()) throw EndOfFile();
+}
+
+namespace {
+//returns the fields of the line at lineBegin and moves lineBegin to the next line
+std::vector<std::string> readHeaderLine(const char *& lineBegin, const char * textEnd, long & numLines) {
+	if (lineBegin == textEnd) throw EndOfFile();
+	const char * lineEnd = tok::lineEnd(lineBegin, textEnd);
+	std::vector<std::string> fields = tok::fieldStrings(lineBegin, lineEnd);
+	lineBegin = tok::nextLine(lineEnd, textEnd);
+	numLines++;
+	return fields;
+}
+
+double toDouble(const std::string & field) {
+	return tok::parseDouble(field.data(), field.data() + field.size());
+}
+}
+
+const char * LAMMPSTextImporter::parseHeader(const char * text, const char * textEnd) {
+	const char * lineBegin = text;
+	numAtoms = -1;
+	bool hasBox = false;
+	while (lineBegin != textEnd) {
+		std::vector<std::string> item = readHeaderLine(lineBegin, textEnd, numHeaderLines);
+		//lines, which do not begin an item, belong to an item that is not needed (e.g. UNITS or TIME)
+		if (item.size() < 2 || item[0] != "ITEM:") continue;
+		if (item[1] == "TIMESTEP") {
+			std::vector<std::string> values = readHeaderLine(lineBegin, textEnd, numHeaderLines);
+			if (values.size() > 0) timeStep = atol(values[0].c_str());
+		} else if (item[1] == "NUMBER") {
+			std::vector<std::string> values = readHeaderLine(lineBegin, textEnd, numHeaderLines);
+			if (values.size() > 0) numAtoms = atol(values[0].c_str());
+		} else if (item[1] == "BOX") {
+			//"ITEM: BOX BOUNDS xy xz yz pp pp pp" for a triclinic box, then one line "lo hi [tilt]" per dimension
+			bool triclinic = (item.size() > 3 && item[3] == "xy");
+			double boundsLo[DIM], boundsHi[DIM], tilt[DIM] = {0., 0., 0.};
+			for (int d = 0; d < DIM; d++) {
+				std::vector<std::string> values = readHeaderLine(lineBegin, textEnd, numHeaderLines);
+				if (values.size() < (triclinic ? 3 : 2)) {
+					throw Exception("LAMMPS dump \"" + filename + "\" has incomplete box bounds");
+				}
+				boundsLo[d] = toDouble(values[0]);
+				boundsHi[d] = toDouble(values[1]);
+				if (triclinic) tilt[d] = toDouble(values[2]);
+			}
+			setBox(boundsLo, boundsHi, tilt);
+			hasBox = true;
+		} else if (item[1] == "ATOMS") {
+			if (numAtoms < 0 || !hasBox) {
+				throw Exception("LAMMPS dump \"" + filename + "\" lacks the number of atoms or the box bounds");
+			}
+			setColumns(std::vector<std::string>(item.begin() + 2, item.end()));
+			return lineBegin;
+		}
+	}
+	throw EndOfFile();
+}
+
+void LAMMPSTextImporter::parseAtoms(const char * text, const char * textEnd) {
+	int nProperties = propertyColumns.size();
+	long nChunks = 1;
+	if (omp_get_max_threads() > 1) {
+		nChunks = std::max<long>(std::min<long>(omp_get_max_threads() * LAMMPS_CHUNKSPERTHREAD, (textEnd - text) / LAMMPS_MINCHUNKSIZE), 1);
+	}
+	std::vector<const char *> chunkBegins;
+	tok::splitChunks(text, textEnd, nChunks, chunkBegins);
+	std::vector<LAMMPSTextChunk> chunks(nChunks);
+	for (long iC = 0; iC < nChunks; iC++) {
+		chunks[iC].begin = chunkBegins[iC];
+		chunks[iC].end = chunkBegins[iC + 1];
+	}
+	if (nChunks > 1) {
+		//each line holds one atom, so the index of the first atom of a chunk is given by the number of lines before it
+		//(later frames of the file are counted as well, but their lines are skipped by the atom index)
+#pragma omp parallel for schedule(dynamic,1)
+		for (long iC = 0; iC < nChunks; iC++) {
+			LAMMPSTextChunk & chunk = chunks[iC];
+			for (const char * c = chunk.begin; c != chunk.end; chunk.numLines++) {
+				c = tok::nextLine(tok::lineEnd(c, chunk.end), chunk.end);
+			}
+		}
+		for (long iC = 1; iC < nChunks; iC++) {
+			chunks[iC].firstAtom = chunks[iC - 1].firstAtom + chunks[iC - 1].numLines;
+		}
+	}
+	std::vector<double> positions(DIM * numAtoms);
+	std::vector<double> propertyValues(nProperties * numAtoms);
+	long nParsed = 0;
+#pragma omp parallel for schedule(dynamic,1) reduction(+:nParsed)
+	for (long iC = 0; iC < nChunks; iC++) {
+		nParsed += parseChunk(chunks[iC], positions.data(), propertyValues.data());
+	}
+	std::vector<bool> propertyIsFloat(nProperties, false);
+	for (long iC = 0; iC < nChunks; iC++) {
+		if (chunks[iC].errorLine >= 0) {
+#pragma omp critical
+{
+			std::cerr << "Parsing error in line " << chunks[iC].errorLine << " of LAMMPS dump. Expected " << numColumns
+					<< " columns, but found " << chunks[iC].errorColumns << "." << std::endl;
+}
+			throw Exception("LAMMPS dump \"" + filename + "\" has a wrong number of columns");
+		}
+		for (int iP = 0; iP < nProperties; iP++) {
+			if (chunks[iC].propertyIsFloat[iP]) propertyIsFloat[iP] = true;
+		}
+	}
+	if (nParsed < numAtoms) {
+		throw EndOfFile();
+	}
+	addParsedAtoms(positions, propertyValues, propertyIsFloat);
+}
+
+long LAMMPSTextImporter::parseChunk(LAMMPSTextChunk & chunk, double * positions, double * propertyValues) const {
+	int nProperties = propertyColumns.size();
+	//one more field than expected is stored, so that too long lines are detected
+	std::vector<const char *> fieldBegins(numColumns + 1);
+	std::vector<const char *> fieldEnds(numColumns + 1);
+	chunk.propertyIsFloat.assign(nProperties, false);
+	long atomNum = chunk.firstAtom;
+	const char * lineBegin = chunk.begin;
+	for (; lineBegin != chunk.end && atomNum < numAtoms; atomNum++) {
+		const char * lineEnd = tok::lineEnd(lineBegin, chunk.end);
+		int nFields = tok::splitFields(lineBegin, lineEnd, fieldBegins.data(), fieldEnds.data(), numColumns + 1);
+		lineBegin = tok::nextLine(lineEnd, chunk.end);
+		if (nFields != numColumns) {
+			if (chunk.errorLine < 0) {
+				//the header ends with the ATOMS item, line numbers start with 1
+				chunk.errorLine = numHeaderLines + atomNum + 1;
+				chunk.errorColumns = nFields;
+			}
+			continue;
+		}
+		double * position = positions + DIM * atomNum;
+		for (int d = 0; d < DIM; d++) {
+			position[d] = tok::parseDouble(fieldBegins[positionColumns[d]], fieldEnds[positionColumns[d]]);
+		}
+		toContainerPosition(position);
+		//only the selected columns are converted
+		for (int iP = 0; iP < nProperties; iP++) {
+			bool isFloat = false;
+			propertyValues[iP * numAtoms + atomNum] = parsePropertyField(fieldBegins[propertyColumns[iP]], fieldEnds[propertyColumns[iP]],
+					propertyTypes[iP], isFloat);
+			if (isFloat) chunk.propertyIsFloat[iP] = true;
+		}
+	}
+	return atomNum - chunk.firstAtom;
+}
@@ -0,0 +1,68 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IO_LAMMPSTEXTIMPORTER_H_
+#define IO_LAMMPSTEXTIMPORTER_H_
+#include "LAMMPSDumpImporter.h"
+
+//! Number of chunks per thread, into which the atom section of a dump is split for parsing.
+#define LAMMPS_CHUNKSPERTHREAD 4
+#ifndef LAMMPS_MINCHUNKSIZE
+//! Minimum size of a chunk in bytes.
+#define LAMMPS_MINCHUNKSIZE (1 << 20)
+#endif
+
+//!\brief A line-aligned byte range of the atom section of a text dump, which is parsed by one thread.
+struct LAMMPSTextChunk {
+	const char * begin = nullptr;
+	const char * end = nullptr;
+	long numLines = 0;
+	//!index of the atom in the first line of the chunk
+	long firstAtom = 0;
+	//!number of the first line with a wrong number of columns, -1 if there is none
+	long errorLine = -1;
+	int errorColumns = 0;
+	std::vector<bool> propertyIsFloat;
+};
+
+//!\brief Importer of LAMMPS text dumps as written by dump atom and dump custom.
+//! The first frame of the file (or the frame set by setFrame) is read, a triclinic box and scaled or unwrapped coordinates are supported.
+class LAMMPSTextImporter : public LAMMPSDumpImporter {
+public:
+	LAMMPSTextImporter(std::string & inFilename, AtomContainer * inData) : LAMMPSDumpImporter(inFilename, inData, lammpsText){};
+	virtual ~LAMMPSTextImporter(){};
+	//!\brief A text dump begins with an ITEM line.
+	virtual bool checkFileFormat();
+	virtual void parseText(const char * text, const char * textEnd);
+	virtual void readHeader(InputHeader & inputHeader);
+	//!\brief Each frame begins with the item TIMESTEP. An incomplete last frame, e.g. of a dump still being written, is left out.
+	virtual void scanFrames(std::vector<FrameInfo> & frames);
+private:
+	//!\brief Parses the items up to the ATOMS item of the first frame.
+	//!\return The beginning of the first atom line.
+	const char * parseHeader(const char * text, const char * textEnd);
+	//!\brief Parses the atom lines of the text [text, textEnd) in parallel and adds the atoms to the container.
+	void parseAtoms(const char * text, const char * textEnd);
+	//!\brief Parses the atoms of a chunk into the positions and the property columns.
+	//!\return The number of atom lines of the chunk.
+	long parseChunk(LAMMPSTextChunk & chunk, double * positions, double * propertyValues) const;
+	long numHeaderLines = 0;
+	long timeStep = 0;
+};
+
+#endif /* IO_LAMMPSTEXTIMPORTER_H_ */
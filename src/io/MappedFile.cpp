@@ -0,0 +1,173 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MappedFile.h"
+#include "FileImporter.h"
+#include "Decompressor.h"
+
+void MappedFile::decompress() {
+	Decompressor::Format format = Decompressor::detectFormat(text, numBytes);
+	if (format == Decompressor::NONE) return;
+	Decompressor decompressor(format, fileName);
+	std::vector<char> decompressed(Decompressor::estimateSize(format, text, numBytes));
+	const char * in = text;
+	size_t outBytes = 0;
+	while (true) {
+		if (outBytes == decompressed.size()) decompressed.resize(2 * decompressed.size());
+		char * out = decompressed.data() + outBytes;
+		decompressor.decompress(in, text + numBytes, out, decompressed.data() + decompressed.size());
+		outBytes = out - decompressed.data();
+		//the output is only left unfilled, if no progress is possible
+		if (outBytes < decompressed.size()) break;
+	}
+	if (in != text + numBytes || !decompressor.isComplete()) {
+		throw Exception("MappedFile failed to decompress \"" + fileName + "\", the file is truncated or corrupt");
+	}
+	decompressed.resize(outBytes);
+	unmap();
+	buffer.swap(decompressed);
+	compressed = true;
+	text = buffer.data();
+	numBytes = buffer.size();
+}
+
+namespace {
+//!\return The length of the range [offset, offset + length) of a text of size numBytes, a range reaching beyond the text ends with it.
+size_t rangeLength(long long offset, long long length, size_t numBytes, const std::string & fileName) {
+	if (offset < 0 || size_t(offset) > numBytes) {
+		throw Exception("MappedFile failed to map a range beyond the end of \"" + fileName + "\"");
+	}
+	if (length < 0 || size_t(offset + length) > numBytes) return numBytes - offset;
+	return length;
+}
+}
+
+void MappedFile::selectRange(long long offset, long long length) {
+	size_t rangeBytes = rangeLength(offset, length, numBytes, fileName);
+	text += offset;
+	numBytes = rangeBytes;
+}
+
+#if !defined(WINDOWS) || defined(CYGWIN)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string & inFileName, long long offset, long long length) {
+	fileName = inFileName;
+	fileDescriptor = open(fileName.c_str(), O_RDONLY);
+	if (fileDescriptor < 0) {
+		throw Exception("MappedFile failed to open \"" + fileName + "\"");
+	}
+	struct stat fileStatus;
+	if (fstat(fileDescriptor, &fileStatus) != 0) {
+		close(fileDescriptor);
+		throw Exception("MappedFile failed to read the size of \"" + fileName + "\"");
+	}
+	numBytes = fileStatus.st_size;
+	//the magic number of a compressed file is at its beginning, which is not part of a range behind it
+	char magic[4];
+	ssize_t numMagicBytes = pread(fileDescriptor, magic, sizeof(magic), 0);
+	bool isCompressedFile = numMagicBytes > 0 && Decompressor::detectFormat(magic, numMagicBytes) != Decompressor::NONE;
+	//a compressed file is mapped completely, since its range refers to the decompressed text
+	size_t mapOffset = 0;
+	if (!isCompressedFile) {
+		try {
+			numBytes = rangeLength(offset, length, numBytes, fileName);
+		} catch (...) {
+			close(fileDescriptor);
+			throw;
+		}
+		mapOffset = offset;
+	}
+	if (numBytes == 0) {
+		//an empty file can not be mapped
+		return;
+	}
+	//the offset of a mapping has to be a multiple of the page size
+	size_t pageOffset = mapOffset % sysconf(_SC_PAGESIZE);
+	mappingBytes = numBytes + pageOffset;
+	mapping = mmap(nullptr, mappingBytes, PROT_READ, MAP_PRIVATE, fileDescriptor, mapOffset - pageOffset);
+	if (mapping == MAP_FAILED) {
+		mapping = nullptr;
+		close(fileDescriptor);
+		throw Exception("MappedFile failed to map \"" + fileName + "\"");
+	}
+	//the file is read front to back once, this lets the kernel read ahead aggressively
+	madvise(mapping, mappingBytes, MADV_SEQUENTIAL);
+	text = static_cast<const char *>(mapping) + pageOffset;
+	try {
+		decompress();
+		if (compressed) selectRange(offset, length);
+	} catch (...) {
+		unmap();
+		close(fileDescriptor);
+		throw;
+	}
+}
+
+void MappedFile::unmap() {
+	if (mapping != nullptr) munmap(mapping, mappingBytes);
+	mapping = nullptr;
+	text = nullptr;
+}
+
+MappedFile::~MappedFile() {
+	unmap();
+	close(fileDescriptor);
+}
+#else
+#include <fstream>
+
+MappedFile::MappedFile(const std::string & inFileName, long long offset, long long length) {
+	fileName = inFileName;
+	std::ifstream stream(fileName.c_str(), std::ios::binary | std::ios::ate);
+	if (stream.fail()) {
+		throw Exception("MappedFile failed to open \"" + fileName + "\"");
+	}
+	numBytes = stream.tellg();
+	//the magic number of a compressed file is at its beginning, which is not part of a range behind it
+	char magic[4];
+	stream.seekg(0);
+	stream.read(magic, sizeof(magic));
+	bool isCompressedFile = stream.gcount() > 0 && Decompressor::detectFormat(magic, stream.gcount()) != Decompressor::NONE;
+	stream.clear();
+	//a compressed file is read completely, since its range refers to the decompressed text
+	size_t readOffset = 0;
+	if (!isCompressedFile) {
+		numBytes = rangeLength(offset, length, numBytes, fileName);
+		readOffset = offset;
+	}
+	buffer.resize(numBytes);
+	stream.seekg(readOffset);
+	if (numBytes > 0 && !stream.read(buffer.data(), numBytes)) {
+		throw Exception("MappedFile failed to read \"" + fileName + "\"");
+	}
+	text = buffer.data();
+	decompress();
+	if (compressed) selectRange(offset, length);
+}
+
+void MappedFile::unmap() {
+	text = nullptr;
+}
+
+MappedFile::~MappedFile() {
+}
+#endif
@@ -0,0 +1,67 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IO_MAPPEDFILE_H_
+#define IO_MAPPEDFILE_H_
+#include "../GradeA_Defs.h"
+
+//!\brief Read-only view of the whole content of a file.
+//! The file is memory-mapped, so its text can be tokenized in place without copying it into line buffers.
+//! On systems without mmap the file is read into one buffer instead.
+//! Files compressed with gzip or zstd are recognized by their magic number and decompressed into a buffer,
+//! so that the text of compressed and plain files is the same.
+//! A byte range of the file can be mapped instead of the whole file, e.g. one frame of a file with several frames.
+class MappedFile {
+public:
+	//!\brief Maps the file \c inFileName. Throws an \c Exception if the file cannot be opened, mapped or decompressed.
+	//!\param[in] offset First byte of the mapped range.
+	//!\param[in] length Size of the mapped range in bytes, -1 for the rest of the file.
+	//! The range refers to the decompressed text of a compressed file, which is decompressed completely.
+	MappedFile(const std::string & inFileName, long long offset = 0, long long length = -1);
+	virtual ~MappedFile();
+	//!\return The first character of the file, \c nullptr for an empty file.
+	const char * begin() const { return text;};
+	//!\return The position behind the last character of the file.
+	const char * end() const { return text + numBytes;};
+	//!\return The size of the (decompressed) text in bytes.
+	size_t size() const { return numBytes;};
+	//!\return Whether the file has been decompressed.
+	bool isCompressed() const { return compressed;};
+private:
+	MappedFile(const MappedFile &);
+	MappedFile & operator=(const MappedFile &);
+	//!\brief Decompresses the text, if it is compressed, and replaces it by the decompressed text.
+	void decompress();
+	//!\brief Restricts the text to the given range of it.
+	void selectRange(long long offset, long long length);
+	//!\brief Releases the mapping (or the buffer) of the raw file content.
+	void unmap();
+	std::string fileName;
+	const char * text = nullptr;
+	size_t numBytes = 0;
+	bool compressed = false;
+#if !defined(WINDOWS) || defined(CYGWIN)
+	int fileDescriptor = -1;
+	//mapped pages, which begin at a page boundary in front of the text of a range
+	void * mapping = nullptr;
+	size_t mappingBytes = 0;
+#endif
+	std::vector<char> buffer;
+};
+
+#endif /* IO_MAPPEDFILE_H_ */
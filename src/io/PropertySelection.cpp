@@ -0,0 +1,66 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PropertySelection.h"
+
+bool PropertySelection::parse(const std::string & inList) {
+	list = inList;
+	names.clear();
+	types.clear();
+	selectsAll = false;
+	size_t begin = 0;
+	while (begin <= list.length()) {
+		size_t end = list.find(',', begin);
+		if (end == std::string::npos) end = list.length();
+		std::string entry = list.substr(begin, end - begin);
+		begin = end + 1;
+		size_t colonPos = entry.find(':');
+		std::string name = entry.substr(0, colonPos);
+		PropertyType type = inferredProperty;
+		if (colonPos != std::string::npos) {
+			std::string typeName = entry.substr(colonPos + 1);
+			if (typeName == "int") type = intProperty;
+			else if (typeName == "float") type = floatProperty;
+			else return false;
+		}
+		if (name.empty()) return false;
+		if (name == "*") {
+			selectsAll = true;
+			continue;
+		}
+		names.push_back(name);
+		types.push_back(type);
+	}
+	return true;
+}
+
+int PropertySelection::find(const std::string & name) const {
+	for (int i = 0; i < names.size(); i++) {
+		if (names[i] == name) return i;
+	}
+	return -1;
+}
+
+bool PropertySelection::isSelected(const std::string & name) const {
+	return selectsAll || find(name) >= 0;
+}
+
+PropertyType PropertySelection::getType(const std::string & name) const {
+	int i = find(name);
+	return i < 0 ? inferredProperty : types[i];
+}
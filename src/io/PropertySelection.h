@@ -0,0 +1,65 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IO_PROPERTYSELECTION_H_
+#define IO_PROPERTYSELECTION_H_
+#include "../GradeA_Defs.h"
+#include "TextTokenizer.h"
+
+//!\brief Type of an atom property, either given by the user or inferred from the values of the property.
+enum PropertyType {inferredProperty, intProperty, floatProperty};
+
+//!\brief Selection of the per-atom columns of the input files, which are stored as atom properties, and their types.
+//! Columns, which are not selected, are skipped by the importers without converting their values.
+//! Without a selection all columns are stored and their types are inferred from their values.
+class PropertySelection {
+public:
+	PropertySelection(){};
+	~PropertySelection(){};
+	//!\brief Parses a comma-separated list of column names, each optionally followed by ":int" or ":float",
+	//! e.g. "id:int,c_pe". The name "*" selects all other columns with inferred types.
+	//!\return false if the list contains an empty name or an unknown type.
+	bool parse(const std::string & inList);
+	//!\return Whether the column \c name is stored as atom property.
+	bool isSelected(const std::string & name) const;
+	//!\return The type of the column \c name.
+	PropertyType getType(const std::string & name) const;
+	//!\return The list as given to parse, "*" if all columns are selected.
+	const std::string & getList() const { return list;};
+private:
+	//!\return The position of \c name in the list, -1 if it is not listed.
+	int find(const std::string & name) const;
+	std::vector<std::string> names;
+	std::vector<PropertyType> types;
+	bool selectsAll = true;
+	std::string list = "*";
+};
+
+//!\brief Converts the field of a property of the given type.
+//! An integer field of an inferred property is converted exactly, a floating point field sets \c isFloat.
+inline double parsePropertyField(const char * begin, const char * end, PropertyType type, bool & isFloat) {
+	if (type == floatProperty) return tok::parseDouble(begin, end);
+	if (type == intProperty) return tok::parseLong(begin, end);
+	if (tok::isFloatField(begin, end)) {
+		isFloat = true;
+		return tok::parseDouble(begin, end);
+	}
+	return tok::parseLong(begin, end);
+}
+
+#endif /* IO_PROPERTYSELECTION_H_ */
@@ -0,0 +1,78 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ShardImporter.h"
+
+ShardImporter::ShardImporter(const std::vector<std::string> & inFileNames, AtomContainer * inData, const PropertySelection & inSelection) {
+	fileNames = inFileNames;
+	data = inData;
+	selection = inSelection;
+}
+
+void ShardImporter::parseFiles() {
+	long nShards = fileNames.size();
+	if (nShards == 0) throw Exception("ShardImporter has no shards to parse");
+	std::vector<ParsedShard> shards(nShards);
+	//the message of the first failure of each shard, empty if the shard has been parsed
+	std::vector<std::string> errors(nShards);
+#pragma omp parallel for schedule(dynamic,1)
+	for (long iS = 0; iS < nShards; iS++) {
+		FileImporter * import = nullptr;
+		try {
+			import = FileImporter::create(fileNames[iS], data);
+			if (import == nullptr) {
+				errors[iS] = "has wrong format";
+			} else {
+				import->setPropertySelection(selection);
+				import->setShard(&shards[iS]);
+				import->parseFile();
+			}
+		} catch (...) {
+			errors[iS] = "could not be parsed";
+		}
+		delete import;
+	}
+	long nAtoms = 0;
+	std::vector<bool> propertyIsFloat(shards[0].propertyNames.size(), false);
+	for (long iS = 0; iS < nShards; iS++) {
+		if (errors[iS].empty() && shards[iS].propertyNames != shards[0].propertyNames) {
+			errors[iS] = "has other columns than shard \"" + fileNames[0] + "\"";
+		}
+		if (!errors[iS].empty()) {
+			throw Exception("Shard \"" + fileNames[iS] + "\" " + errors[iS]);
+		}
+		nAtoms += shards[iS].numAtoms;
+		//a property is a float property, if it is one in any shard, so that no column is converted while adding the shards
+		for (int iP = 0; iP < propertyIsFloat.size(); iP++) {
+			if (shards[iS].propertyIsFloat[iP]) propertyIsFloat[iP] = true;
+		}
+	}
+	for (int iP = 0; iP < shards[0].propertyNames.size(); iP++) {
+		data->addAtomProperty(shards[0].propertyNames[iP]);
+	}
+	data->setSize(shards[0].size);
+	data->setOrigin(shards[0].origin);
+	data->generate(nAtoms);
+	for (long iS = 0; iS < nShards; iS++) {
+		data->addAtoms(shards[iS].positions.data(), shards[iS].numAtoms, shards[iS].propertyValues.data(), propertyIsFloat);
+		//the memory of a shard is released as soon as it has been added
+		std::vector<double>().swap(shards[iS].positions);
+		std::vector<double>().swap(shards[iS].propertyValues);
+	}
+	data->sortAtoms();
+}
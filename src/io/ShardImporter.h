@@ -0,0 +1,40 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IO_SHARDIMPORTER_H_
+#define IO_SHARDIMPORTER_H_
+#include "FileImporter.h"
+
+//!\brief Importer of a frame, which has been written as several shards (one file per rank).
+//! The shards are parsed in parallel by the importers of their formats into separate arrays,
+//! which are added to the container one after another. All shards share the box of the first shard.
+class ShardImporter {
+public:
+	ShardImporter(const std::vector<std::string> & inFileNames, AtomContainer * inData, const PropertySelection & inSelection);
+	~ShardImporter(){};
+	//!\brief Parses all shards and adds their atoms to the container in the order of the shards.
+	//! Throws an \c Exception if a shard cannot be read or parsed, has an unsupported format
+	//! or other properties than the first shard.
+	void parseFiles();
+private:
+	std::vector<std::string> fileNames;
+	AtomContainer * data;
+	PropertySelection selection;
+};
+
+#endif /* IO_SHARDIMPORTER_H_ */
@@ -0,0 +1,219 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SnapshotCache.h"
+#include "MappedFile.h"
+#include "FileImporter.h"
+#include <sys/stat.h>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+//magic string and version of the format of the cache files
+#define SNAPSHOTCACHE_MAGIC "GraDe-A snapshot 1"
+
+namespace {
+//sequential reader of a cache file, all values are 8 bytes and all strings are padded to 8 bytes,
+//so that the position and property arrays are aligned inside the mapped file
+class CacheReader {
+public:
+	CacheReader(const char * inPos, const char * inEnd) : pos(inPos), end(inEnd){};
+	int64_t readInt() {
+		int64_t value;
+		memcpy(&value, advance(sizeof(int64_t)), sizeof(int64_t));
+		return value;
+	}
+	double readDouble() {
+		double value;
+		memcpy(&value, advance(sizeof(double)), sizeof(double));
+		return value;
+	}
+	std::string readString() {
+		int64_t length = readInt();
+		if (length < 0) throw EndOfFile();
+		const char * begin = advance(paddedLength(length));
+		return std::string(begin, begin + length);
+	}
+	const double * readDoubles(int64_t numValues) {
+		if (numValues < 0) throw EndOfFile();
+		return reinterpret_cast<const double *>(advance(numValues * sizeof(double)));
+	}
+	static size_t paddedLength(size_t length) {
+		return (length + 7) / 8 * 8;
+	}
+private:
+	const char * advance(size_t numBytes) {
+		if (size_t(end - pos) < numBytes) throw EndOfFile();
+		const char * begin = pos;
+		pos += numBytes;
+		return begin;
+	}
+	const char * pos;
+	const char * end;
+};
+
+void writeInt(std::ofstream & stream, int64_t value) {
+	stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void writeDouble(std::ofstream & stream, double value) {
+	stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void writeString(std::ofstream & stream, const std::string & s) {
+	writeInt(stream, s.length());
+	std::string padded = s;
+	padded.resize(CacheReader::paddedLength(s.length()), '\0');
+	stream.write(padded.data(), padded.length());
+}
+
+//64-bit FNV-1a hash
+void addToHash(uint64_t & hash, const char * data, size_t numBytes) {
+	for (size_t i = 0; i < numBytes; i++) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 1099511628211ULL;
+	}
+}
+}
+
+SnapshotCache::SnapshotCache(const std::string & inFileName, const FrameInfo & inFrame, const std::string & inSelectionKey, const std::string & cacheDirectory) {
+	fileName = inFileName;
+	frame = inFrame;
+	selectionKey = inSelectionKey;
+	std::string baseName = fileName;
+	if (!cacheDirectory.empty()) {
+		size_t dirPos = fileName.rfind(DIRCHAR);
+		if (dirPos != std::string::npos) baseName = fileName.substr(dirPos + 1);
+		baseName = cacheDirectory + baseName;
+	}
+	//the frames of a file are cached separately
+	if (frame.length >= 0) {
+		baseName += "." + std::to_string(frame.offset);
+	}
+	cacheFileName = baseName + ".snapshot";
+}
+
+bool SnapshotCache::readKey() {
+	struct stat fileStatus;
+	if (stat(fileName.c_str(), &fileStatus) != 0) return false;
+	fileSize = fileStatus.st_size;
+	modificationTime = fileStatus.st_mtime;
+	//an input file, which has been replaced within the resolution of its modification time, is recognized by its content
+	std::ifstream stream(fileName.c_str(), std::ios::binary);
+	if (stream.fail()) return false;
+	std::vector<char> bytes(SNAPSHOTCACHE_HASHBYTES);
+	hash = 14695981039346656037ULL;
+	stream.read(bytes.data(), bytes.size());
+	addToHash(hash, bytes.data(), stream.gcount());
+	if (fileSize > 2 * SNAPSHOTCACHE_HASHBYTES) {
+		stream.clear();
+		stream.seekg(fileSize - SNAPSHOTCACHE_HASHBYTES);
+		stream.read(bytes.data(), bytes.size());
+		addToHash(hash, bytes.data(), stream.gcount());
+	}
+	return true;
+}
+
+bool SnapshotCache::load(AtomContainer * data) {
+	if (!readKey()) return false;
+	std::ifstream test(cacheFileName.c_str());
+	if (test.fail()) return false;
+	test.close();
+	try {
+		MappedFile file(cacheFileName);
+		CacheReader reader(file.begin(), file.end());
+		//all values are read and checked before the container is changed
+		if (reader.readString() != SNAPSHOTCACHE_MAGIC) return false;
+		if (reader.readInt() != fileSize || reader.readInt() != modificationTime || uint64_t(reader.readInt()) != hash
+				|| reader.readInt() != frame.offset || reader.readInt() != frame.length || reader.readString() != selectionKey) {
+			return false;
+		}
+		int64_t nAtoms = reader.readInt();
+		int64_t nProperties = reader.readInt();
+		if (nAtoms < 0 || nProperties < 0) return false;
+		double size[DIM], origin[DIM];
+		for (int d = 0; d < DIM; d++) size[d] = reader.readDouble();
+		for (int d = 0; d < DIM; d++) origin[d] = reader.readDouble();
+		std::vector<std::string> propertyNames(nProperties);
+		std::vector<bool> propertyIsFloat(nProperties);
+		for (int64_t iP = 0; iP < nProperties; iP++) {
+			propertyNames[iP] = reader.readString();
+			propertyIsFloat[iP] = (reader.readInt() != 0);
+		}
+		const double * positions = reader.readDoubles(DIM * nAtoms);
+		const double * propertyValues = reader.readDoubles(nProperties * nAtoms);
+		for (int64_t iP = 0; iP < nProperties; iP++) {
+			data->addAtomProperty(propertyNames[iP]);
+		}
+		data->setSize(size);
+		data->setOrigin(origin);
+		data->generate(nAtoms);
+		data->addAtoms(positions, nAtoms, propertyValues, propertyIsFloat);
+		data->sortAtoms();
+	} catch (...) {
+		return false;
+	}
+#pragma omp critical
+{
+	std::cout << "Thread " << omp_get_thread_num() << ": Read " << data->getNumAtoms() << " atoms from cache file \"" << cacheFileName << "\"" << std::endl;
+}
+	return true;
+}
+
+void SnapshotCache::save(const AtomContainer * data, const double * positions, long nAtoms, const double * propertyValues,
+		const std::vector<bool> & propertyIsFloat) {
+	if (!readKey()) return;
+	std::vector<std::string> propertyNames;
+	data->getAtomPropertyNames(propertyNames, false);
+	//the file is written under a temporary name and renamed, so that no incomplete cache file is read by another run
+	std::string tempFileName = cacheFileName + ".tmp" + std::to_string(omp_get_thread_num());
+	std::ofstream stream(tempFileName.c_str(), std::ios::binary);
+	if (!stream.fail()) {
+		writeString(stream, SNAPSHOTCACHE_MAGIC);
+		writeInt(stream, fileSize);
+		writeInt(stream, modificationTime);
+		writeInt(stream, hash);
+		writeInt(stream, frame.offset);
+		writeInt(stream, frame.length);
+		writeString(stream, selectionKey);
+		writeInt(stream, nAtoms);
+		writeInt(stream, propertyIsFloat.size());
+		for (int d = 0; d < DIM; d++) writeDouble(stream, data->getSize()[d]);
+		for (int d = 0; d < DIM; d++) writeDouble(stream, data->getOrigin()[d]);
+		for (int iP = 0; iP < propertyIsFloat.size(); iP++) {
+			writeString(stream, propertyNames[iP]);
+			writeInt(stream, propertyIsFloat[iP]);
+		}
+		stream.write(reinterpret_cast<const char *>(positions), DIM * nAtoms * sizeof(double));
+		stream.write(reinterpret_cast<const char *>(propertyValues), propertyIsFloat.size() * nAtoms * sizeof(double));
+		stream.close();
+	}
+	bool isWritten = !stream.fail();
+	if (isWritten) {
+		//the cache file of a former version of the input file is replaced
+		std::remove(cacheFileName.c_str());
+		isWritten = (std::rename(tempFileName.c_str(), cacheFileName.c_str()) == 0);
+	}
+	if (!isWritten) {
+		std::remove(tempFileName.c_str());
+#pragma omp critical
+{
+		std::cerr << "Could not write the cache file \"" << cacheFileName << "\"." << std::endl;
+}
+	}
+}
@@ -0,0 +1,63 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IO_SNAPSHOTCACHE_H_
+#define IO_SNAPSHOTCACHE_H_
+#include "../GradeA_Defs.h"
+#include "../AtomContainer.h"
+#include "FrameIndex.h"
+#include <cstdint>
+
+//! Number of bytes at the beginning and at the end of an input file, which are hashed into the key of its cache file.
+#define SNAPSHOTCACHE_HASHBYTES 4096
+
+//!\brief Binary cache of the parsed atoms of an input file (or of one frame of it).
+//! The first parse writes the container geometry, the positions and the typed property columns into "<file>.snapshot",
+//! next to the input file or in a cache directory. Later runs map the cache file and add its atoms to the container
+//! without parsing the text. A cache file is only used if size, modification time and a hash of the beginning and
+//! the end of the input file, the frame and the selected properties are unchanged.
+class SnapshotCache {
+public:
+	//!\param[in] inFileName The input file.
+	//!\param[in] inFrame The frame of the input file, which is cached.
+	//!\param[in] inSelectionKey Description of the selected properties, see PropertySelection::getList().
+	//!\param[in] cacheDirectory Directory of the cache files, the directory of the input file if empty.
+	SnapshotCache(const std::string & inFileName, const FrameInfo & inFrame, const std::string & inSelectionKey, const std::string & cacheDirectory);
+	~SnapshotCache(){};
+	//!\brief Initializes the container and adds the cached atoms, if a cache file matching the input file exists.
+	//!\return Whether the atoms have been read from the cache file.
+	bool load(AtomContainer * data);
+	//!\brief Writes the parsed atoms into the cache file, the container has to be initialized already.
+	//! The arguments are the ones of AtomContainer::addAtoms().
+	void save(const AtomContainer * data, const double * positions, long nAtoms, const double * propertyValues,
+			const std::vector<bool> & propertyIsFloat);
+	const std::string & getCacheFileName() const { return cacheFileName;};
+private:
+	//!\brief Determines size, modification time and hash of the input file.
+	//!\return false if the input file cannot be read.
+	bool readKey();
+	std::string fileName;
+	std::string cacheFileName;
+	FrameInfo frame;
+	std::string selectionKey;
+	long long fileSize = -1;
+	long long modificationTime = -1;
+	uint64_t hash = 0;
+};
+
+#endif /* IO_SNAPSHOTCACHE_H_ */
@@ -0,0 +1,209 @@
+/*
+GraDe-A: Grain Detection Algorithm.
+Copyright (C) 2016 Paul Hoffrogge
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IO_TEXTTOKENIZER_H_
+#define IO_TEXTTOKENIZER_H_
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//!\brief Conversion of whitespace separated fields of a text buffer in place.
+//! A field is given by its first character and the position behind its last character, it does not need to be null-terminated.
+namespace tok {
+
+//!\return Whether \c c separates two fields of a line.
+inline bool isBlank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+//!\brief Splits the line [\c begin, \c end) into fields.
+//!\param[out] fieldBegins First character of each field, at least \c maxFields elements must be accessible.
+//!\param[out] fieldEnds Position behind the last character of each field, at least \c maxFields elements must be accessible.
+//!\return The number of fields of the line. Only the first \c maxFields fields are stored, but all are counted.
+inline int splitFields(const char * begin, const char * end, const char ** fieldBegins, const char ** fieldEnds, int maxFields) {
+	int nFields = 0;
+	const char * c = begin;
+	while (true) {
+		while (c != end && isBlank(*c)) c++;
+		if (c == end) break;
+		const char * fieldBegin = c;
+		while (c != end && !isBlank(*c)) c++;
+		if (nFields < maxFields) {
+			fieldBegins[nFields] = fieldBegin;
+			fieldEnds[nFields] = c;
+		}
+		nFields++;
+	}
+	return nFields;
+}
+
+//!\return All fields of the line [\c begin, \c end) as strings, meant for header lines.
+inline std::vector<std::string> fieldStrings(const char * begin, const char * end) {
+	std::vector<std::string> fields;
+	const char * c = begin;
+	while (true) {
+		while (c != end && isBlank(*c)) c++;
+		if (c == end) break;
+		const char * fieldBegin = c;
+		while (c != end && !isBlank(*c)) c++;
+		fields.push_back(std::string(fieldBegin, c));
+	}
+	return fields;
+}
+
+//!\return The number of fields of the line [\c begin, \c end), but at most \c maxFields.
+inline int countFields(const char * begin, const char * end, int maxFields) {
+	int nFields = 0;
+	const char * c = begin;
+	while (nFields < maxFields) {
+		while (c != end && isBlank(*c)) c++;
+		if (c == end) break;
+		while (c != end && !isBlank(*c)) c++;
+		nFields++;
+	}
+	return nFields;
+}
+
+//!\return The end of the line beginning at \c lineBegin, i.e. the position of its newline character or \c textEnd.
+inline const char * lineEnd(const char * lineBegin, const char * textEnd) {
+	const char * newLine = static_cast<const char *>(memchr(lineBegin, '\n', textEnd - lineBegin));
+	return (newLine == nullptr) ? textEnd : newLine;
+}
+
+//!\return The beginning of the line behind the line ending at \c lineEnd.
+inline const char * nextLine(const char * lineEnd, const char * textEnd) {
+	return (lineEnd == textEnd) ? textEnd : lineEnd + 1;
+}
+
+//!\brief Splits the text [\c text, \c textEnd) into \c nChunks ranges of about equal size, which begin at the beginning of a line.
+//!\param[out] chunkBegins nChunks + 1 positions, chunk i is [chunkBegins[i], chunkBegins[i + 1]). A chunk may be empty.
+inline void splitChunks(const char * text, const char * textEnd, long nChunks, std::vector<const char *> & chunkBegins) {
+	chunkBegins.resize(nChunks + 1);
+	chunkBegins[0] = text;
+	for (long iC = 1; iC < nChunks; iC++) {
+		//a split position at the beginning of a line is kept, otherwise the chunk begins with the next line
+		const char * splitPos = text + (textEnd - text) * iC / nChunks;
+		const char * chunkBegin = (splitPos == text) ? text : nextLine(lineEnd(splitPos - 1, textEnd), textEnd);
+		chunkBegins[iC] = (chunkBegin < chunkBegins[iC - 1]) ? chunkBegins[iC - 1] : chunkBegin;
+	}
+	chunkBegins[nChunks] = textEnd;
+}
+
+//!\return Whether the field is a floating point number, i.e. it contains one of '.', 'e' or 'E'.
+inline bool isFloatField(const char * begin, const char * end) {
+	for (const char * c = begin; c != end; c++) {
+		if (*c == '.' || *c == 'e' || *c == 'E') return true;
+	}
+	return false;
+}
+
+//!\brief Converts a field by \c strtod(), used for all fields that are not covered by the fast conversion.
+inline double parseDoubleSlow(const char * begin, const char * end) {
+	char buffer[64];
+	size_t length = end - begin;
+	if (length < sizeof(buffer)) {
+		memcpy(buffer, begin, length);
+		buffer[length] = '\0';
+		return strtod(buffer, nullptr);
+	}
+	return strtod(std::string(begin, end).c_str(), nullptr);
+}
+
+//!\brief Converts a decimal field to a double, the result is equal to the one of \c atof().
+//! A plain decimal number ([sign] digits [. digits] [e [sign] digits]) with a significand below 2^53
+//! and a decimal exponent of at most 22 is converted by one multiplication or division of two exact doubles,
+//! which is correctly rounded (Clinger's fast path). All other fields are passed to \c strtod().
+inline double parseDouble(const char * begin, const char * end) {
+	static const double exactPowersOf10[23] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	const char * c = begin;
+	bool negative = false;
+	if (c != end && (*c == '-' || *c == '+')) {
+		negative = (*c == '-');
+		c++;
+	}
+	uint64_t significand = 0;
+	int nSignificantDigits = 0;
+	int nDigits = 0;
+	int exponent = 0;
+	for (; c != end && *c >= '0' && *c <= '9'; c++, nDigits++) {
+		if (significand == 0 && *c == '0') continue;
+		significand = 10 * significand + (*c - '0');
+		nSignificantDigits++;
+	}
+	if (c != end && *c == '.') {
+		c++;
+		for (; c != end && *c >= '0' && *c <= '9'; c++, nDigits++) {
+			exponent--;
+			if (significand == 0 && *c == '0') continue;
+			significand = 10 * significand + (*c - '0');
+			nSignificantDigits++;
+		}
+	}
+	if (nDigits == 0 || nSignificantDigits > 19) {
+		return parseDoubleSlow(begin, end);
+	}
+	if (c != end && (*c == 'e' || *c == 'E')) {
+		c++;
+		bool negativeExponent = false;
+		if (c != end && (*c == '-' || *c == '+')) {
+			negativeExponent = (*c == '-');
+			c++;
+		}
+		if (c == end) {
+			return parseDoubleSlow(begin, end);
+		}
+		int exponentValue = 0;
+		for (; c != end && *c >= '0' && *c <= '9'; c++) {
+			if (exponentValue < 10000) exponentValue = 10 * exponentValue + (*c - '0');
+		}
+		exponent += negativeExponent ? -exponentValue : exponentValue;
+	}
+	if (c != end || significand > (uint64_t(1) << 53) || exponent < -22 || exponent > 22) {
+		return parseDoubleSlow(begin, end);
+	}
+	double value = static_cast<double>(significand);
+	if (exponent < 0) {
+		value /= exactPowersOf10[-exponent];
+	} else {
+		value *= exactPowersOf10[exponent];
+	}
+	return negative ? -value : value;
+}
+
+//!\brief Converts an integer field, the result is equal to the one of \c atol().
+inline long parseLong(const char * begin, const char * end) {
+	const char * c = begin;
+	bool negative = false;
+	if (c != end && (*c == '-' || *c == '+')) {
+		negative = (*c == '-');
+		c++;
+	}
+	long value = 0;
+	for (; c != end && *c >= '0' && *c <= '9'; c++) {
+		value = 10 * value + (*c - '0');
+	}
+	return negative ? -value : value;
+}
+
+}
+
+#endif /* IO_TEXTTOKENIZER_H_ */
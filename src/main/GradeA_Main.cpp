@@ -51,15 +51,154 @@ int writeProgramInfo(){
 	std::cout << "latticeconstant: in Angstrom" << std::endl;
 	std::cout << "angularthreshold: in degree" << std::endl;
 	std::cout << "printorientations: ON: print, else: no print" << std::endl;
+	std::cout << "Options (--name=value, may be placed anywhere):" << std::endl;
+	std::cout << "--engine=recursive|unionfind: grain identification algorithm, unionfind runs in parallel (default: recursive)" << std::endl;
+	std::cout << "--neighborlist=on|off: share one neighbor list per file between all steps, off saves memory (default: on)" << std::endl;
+	std::cout << "--cells=dense|sparse: cell grid of the neighbor search, sparse stores only the cells holding atoms, e.g. for samples with vacuum (default: dense)" << std::endl;
+	std::cout << "--order=grid|morton: memory order of the cells and of the atoms inside each cell, morton stores atoms close in space close together (default: grid)" << std::endl;
+	std::cout << "--halo=on|off: copy the periodic images into a ghost halo once per frame, from which the neighbor searches read without shifting positions (default: off)" << std::endl;
+	std::cout << "--frames=on|off: compute each frame of input files with several frames, the frames are indexed in \"<file>.frames\" (default: off)" << std::endl;
+	std::cout << "--columns=name[:int|:float],...: per-atom columns stored as atom properties, all others are skipped, \"*\" keeps all columns (default: *)" << std::endl;
+	std::cout << "--cache=off|on|directory: write the parsed atoms of each input into \"<file>.snapshot\" (next to the input or in the directory) and read them from there in later runs (default: off)" << std::endl;
+	std::cout << "--shards=on|off: merge the files of a frame written per rank, e.g. dump.1000.0.cfg ... dump.1000.255.cfg, into one computation (default: off)" << std::endl;
+	std::cout << "--dryrun=on|off: print the plan of the run (atoms, box and estimated memory of each file) read from the file headers and stop without computing (default: off)" << std::endl;
 	std::cout << "Example: grade-A \"input*.cfg\" p 4.05 1.0" << std::endl;
 	std::cout << "Example with restart-file: grade-A \"input*.cfg\" p 4.05 1.0 0 10 \"restart.csv\" " << std::endl;
 	std::cout << "Example with orientation output: grade-A \"input*.cfg\" p 4.05 1.0 0 10 \"\" Al ON" << std::endl;
+	std::cout << "Example with parallel grain identification: grade-A \"input*.cfg\" p 4.05 1.0 --engine=unionfind" << std::endl;
+	std::cout << "Example with LAMMPS dumps: grade-A \"dump*.lammpstrj\" p 4.05 1.0" << std::endl;
+	std::cout << "Example keeping only two columns of a LAMMPS dump: grade-A \"dump*.lammpstrj\" p 4.05 1.0 --columns=id:int,c_pe:float" << std::endl;
+	std::cout << "Example with one file per rank: grade-A \"dump.*.cfg\" p 4.05 1.0 --shards=on" << std::endl;
+	std::cout << "Example reading the frames of a stream from stdin: lmp -in in.lmp | grade-A - p 4.05 1.0" << std::endl;
+	std::cout << "Example with a trajectory of several frames: grade-A \"trajectory.lammpstrj\" p 4.05 1.0 --frames=on" << std::endl;
 	//
 	return -1;
 }
 
-void run(std::string& inputFileNamesWildCard,std::string restartFilename,  double a, double angularThreshold, bool periodic, std::string chemElementName, int startFileNum = 0, int endFileNum = INT_MAX, bool printOrientations = false){
-	ComputationManager manager(periodic, a, angularThreshold, chemElementName, printOrientations);
+//!\brief Parses an option of the form --name=value into \c options.
+//!\return false if the option is unknown or has an invalid value.
+bool parseOption(const std::string & arg, ComputationOptions & options){
+	size_t eqPos = arg.find('=');
+	std::string name = arg.substr(2, eqPos == std::string::npos ? std::string::npos : eqPos - 2);
+	std::string value = eqPos == std::string::npos ? "" : arg.substr(eqPos + 1);
+	if (name == "engine") {
+		if (value == "recursive") {
+			options.grainEngine = recursiveEngine;
+		} else if (value == "unionfind") {
+			options.grainEngine = unionFindEngine;
+		} else {
+			std::cerr << "Unknown grain identification engine \"" << value << "\" specified." << std::endl;
+			std::cerr << "Supported engines are \"recursive\" or \"unionfind\"." << std::endl;
+			return false;
+		}
+		return true;
+	}
+	if (name == "neighborlist") {
+		if (value == "on") {
+			options.useNeighborList = true;
+		} else if (value == "off") {
+			options.useNeighborList = false;
+		} else {
+			std::cerr << "Wrong value \"" << value << "\" given for option \"neighborlist\", use \"on\" or \"off\"." << std::endl;
+			return false;
+		}
+		return true;
+	}
+	if (name == "cells") {
+		if (value == "dense") {
+			options.sparseCells = false;
+		} else if (value == "sparse") {
+			options.sparseCells = true;
+		} else {
+			std::cerr << "Wrong value \"" << value << "\" given for option \"cells\", use \"dense\" or \"sparse\"." << std::endl;
+			return false;
+		}
+		return true;
+	}
+	if (name == "order") {
+		if (value == "grid") {
+			options.mortonOrder = false;
+		} else if (value == "morton") {
+			options.mortonOrder = true;
+		} else {
+			std::cerr << "Wrong value \"" << value << "\" given for option \"order\", use \"grid\" or \"morton\"." << std::endl;
+			return false;
+		}
+		return true;
+	}
+	if (name == "halo") {
+		if (value == "on") {
+			options.ghostHalo = true;
+		} else if (value == "off") {
+			options.ghostHalo = false;
+		} else {
+			std::cerr << "Wrong value \"" << value << "\" given for option \"halo\", use \"on\" or \"off\"." << std::endl;
+			return false;
+		}
+		return true;
+	}
+	if (name == "frames") {
+		if (value == "on") {
+			options.multiFrameFiles = true;
+		} else if (value == "off") {
+			options.multiFrameFiles = false;
+		} else {
+			std::cerr << "Wrong value \"" << value << "\" given for option \"frames\", use \"on\" or \"off\"." << std::endl;
+			return false;
+		}
+		return true;
+	}
+	if (name == "shards") {
+		if (value == "on") {
+			options.groupShards = true;
+		} else if (value == "off") {
+			options.groupShards = false;
+		} else {
+			std::cerr << "Wrong value \"" << value << "\" given for option \"shards\", use \"on\" or \"off\"." << std::endl;
+			return false;
+		}
+		return true;
+	}
+	if (name == "dryrun") {
+		if (value == "on") {
+			options.dryRun = true;
+		} else if (value == "off") {
+			options.dryRun = false;
+		} else {
+			std::cerr << "Wrong value \"" << value << "\" given for option \"dryrun\", use \"on\" or \"off\"." << std::endl;
+			return false;
+		}
+		return true;
+	}
+	if (name == "columns") {
+		if (!options.properties.parse(value)) {
+			std::cerr << "Wrong value \"" << value << "\" given for option \"columns\", use a comma-separated list of names with an optional type \":int\" or \":float\"." << std::endl;
+			return false;
+		}
+		return true;
+	}
+	if (name == "cache") {
+		if (value == "off") {
+			options.useSnapshotCache = false;
+		} else if (value == "on") {
+			options.useSnapshotCache = true;
+			options.cacheDirectory = "";
+		} else if (!value.empty()) {
+			options.useSnapshotCache = true;
+			options.cacheDirectory = value;
+			if (options.cacheDirectory.back() != DIRCHAR) options.cacheDirectory += DIRCHAR;
+		} else {
+			std::cerr << "No value given for option \"cache\", use \"on\", \"off\" or a directory." << std::endl;
+			return false;
+		}
+		return true;
+	}
+	std::cerr << "Unknown option \"" << arg << "\" specified." << std::endl;
+	return false;
+}
+
+void run(std::string& inputFileNamesWildCard,std::string restartFilename,  double a, double angularThreshold, bool periodic, std::string chemElementName, int startFileNum = 0, int endFileNum = INT_MAX, bool printOrientations = false, const ComputationOptions & options = ComputationOptions()){
+	ComputationManager manager(periodic, a, angularThreshold, chemElementName, printOrientations, options);
 	manager.run(inputFileNamesWildCard, restartFilename, startFileNum, endFileNum);
 }
 
@@ -69,6 +208,20 @@ int main(int argc, char** argv){
 	std::cout << "This is GraDe-A " << version.getString() <<"\n"<< FANCYLINE << std::endl;
 //----BEGIN
 {
+	//options are given as --name=value and are removed from the positional parameters
+	ComputationOptions options;
+	int argcPos = 1;
+	for (int i = 1; i < argc; i++){
+		if (0 == strncmp(argv[i], "--", 2)){
+			if (!parseOption(argv[i], options)){
+				std::cerr << "Exited." << std::endl;
+				return -1;
+			}
+			continue;
+		}
+		argv[argcPos++] = argv[i];
+	}
+	argc = argcPos;
 	int numParameter = argc-1;
 	std::cout << "Input " << numParameter << " parameters, 4 necessary." <<  std::endl;
 	if (numParameter < 4 || numParameter > 9){
@@ -122,8 +275,11 @@ int main(int argc, char** argv){
 	if(printOrientations){
 		std::cout << "Atom-Orientation printing ON" << std::endl;
 	}
+	if(options.grainEngine == unionFindEngine){
+		std::cout << "Using the parallel union-find grain identification" << std::endl;
+	}
 	std::cout << "Grain-Volume is given in " << VOLUMEUNIT << std::endl;
-	run(inputWildCard,initFileName, latticeParameter,angularThreshold, isPeriodic, chemElementName, startFileNum, endFileNum, printOrientations);
+	run(inputWildCard,initFileName, latticeParameter,angularThreshold, isPeriodic, chemElementName, startFileNum, endFileNum, printOrientations, options);
 }
 //----END
 	watch.trigger();